@@ -29,285 +29,311 @@
 *********************************************************************************/
 #include "SystemConfiguration.h"
 #include "AddressMapping.h"
+#include "PrintMacros.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <sstream>
 
 namespace DRAMSim
 {
+	using namespace std;
 
-	void addressMapping(uint64_t physicalAddress, unsigned &newTransactionChan, unsigned &newTransactionRank, unsigned &newTransactionBank, unsigned &newTransactionRow, unsigned &newTransactionColumn)
+	const char *AddressMapper::presetLayout(AddressMappingScheme scheme)
 	{
-		uint64_t tempA, tempB;
-		unsigned transactionSize = (JEDEC_DATA_BUS_BITS/8)*BL;
-		uint64_t transactionMask =  transactionSize - 1; //ex: (64 bit bus width) x (8 Burst Length) - 1 = 64 bytes - 1 = 63 = 0x3f mask
-		unsigned channelBitWidth = dramsim_log2(NUM_CHANS);
-		unsigned	rankBitWidth = dramsim_log2(NUM_RANKS);
-		unsigned	bankBitWidth = dramsim_log2(NUM_BANKS);
-		unsigned	rowBitWidth = dramsim_log2(NUM_ROWS);
-		unsigned	colBitWidth = dramsim_log2(NUM_COLS);
-		// this forces the alignment to the width of a single burst (64 bits = 8 bytes = 3 address bits for DDR parts)
-		unsigned	byteOffsetWidth = dramsim_log2((JEDEC_DATA_BUS_BITS/8));
-		// Since we're assuming that a request is for BL*BUS_WIDTH, the bottom bits
-		// of this address *should* be all zeros if it's not, issue a warning
+		static const char *layouts[] = {
+			"ch:ra:ro:co:ba",  // scheme1
+			"ch:ro:co:ba:ra",  // scheme2
+			"ch:ra:ba:co:ro",  // scheme3
+			"ch:ra:ba:ro:co",  // scheme4
+			"ch:ro:co:ra:ba",  // scheme5
+			"ch:ro:ba:ra:co",  // scheme6
+			"ro:co:ra:ba:ch"   // scheme7
+		};
+		return layouts[scheme];
+	}
+
 
-		if ((physicalAddress & transactionMask) != 0)
+	AddressMapper::AddressMapper(const string &layout, const string &hash, unsigned channels) : layout(layout)
+	{
+		static const char *names[] = {"ch", "ra", "ba", "ro", "co"};
+
+		// a transaction covers the byte offset and the low column bits, the column field is what is left above them
+		offsetBits = dramsim_log2(TRANS_DATA_BYTES);
+		unsigned counts[NUM_FIELDS];
+		counts[Channel] = channels;
+		counts[Rank] = NUM_RANKS;
+		counts[Bank] = NUM_BANKS;
+		counts[Row] = NUM_ROWS;
+		counts[Column] = NUM_COLS / (TRANS_DATA_BYTES / (JEDEC_DATA_BUS_BITS / 8));
+		modulo = false;
+		for (unsigned f=0; f<NUM_FIELDS; f++)
 		{
-			DEBUG("WARNING: address 0x"<<std::hex<<physicalAddress<<std::dec<<" is not aligned to the request size of "<<transactionSize);
+			// rounded up for a count that is not a power of two
+			widths[f] = dramsim_log2(counts[f]);
+			modulo = modulo || !isPowerOfTwo(counts[f]);
 		}
 
-		// each burst will contain JEDEC_DATA_BUS_BITS/8 bytes of data, so the bottom bits (3 bits for a single channel DDR system) are
-		// 	thrown away before mapping the other bits
-		physicalAddress >>= byteOffsetWidth;
-
-		// The next thing we have to consider is that when a request is made for a
-		// we've taken into account the granulaity of a single burst by shifting
-		// off the bottom 3 bits, but a transaction has to take into account the
-		// burst length (i.e. the requests will be aligned to cache line sizes which
-		// should be equal to transactionSize above).
-		//
-		// Since the column address increments internally on bursts, the bottom n
-		// bits of the column (colLow) have to be zero in order to account for the
-		// total size of the transaction. These n bits should be shifted off the
-		// address and also subtracted from the total column width.
-		//
-		// I am having a hard time explaining the reasoning here, but it comes down
-		// this: for a 64 byte transaction, the bottom 6 bits of the address must be
-		// zero. These zero bits must be made up of the byte offset (3 bits) and also
-		// from the bottom bits of the column
-		//
-		// For example: cowLowBits = log2(64bytes) - 3 bits = 3 bits
-		unsigned colLowBitWidth = dramsim_log2(transactionSize) - byteOffsetWidth;
-
-		physicalAddress >>= colLowBitWidth;
-		unsigned colHighBitWidth = colBitWidth - colLowBitWidth;
-		if (DEBUG_ADDR_MAP)
+		// split the layout into its pieces, a width of 0 stands for "the rest of the field"
+		vector<Field> tokenFields;
+		vector<unsigned> tokenWidths;
+		unsigned explicitBits[NUM_FIELDS] = {0};
+		unsigned restPieces[NUM_FIELDS] = {0};
+		istringstream in(layout);
+		string token;
+		while (getline(in, token, ':'))
 		{
-			DEBUG("Bit widths: ch:"<<channelBitWidth<<" r:"<<rankBitWidth<<" b:"<<bankBitWidth
-					<<" row:"<<rowBitWidth<<" colLow:"<<colLowBitWidth
-					<< " colHigh:"<<colHighBitWidth<<" off:"<<byteOffsetWidth
-					<< " Total:"<< (channelBitWidth + rankBitWidth + bankBitWidth + rowBitWidth + colLowBitWidth + colHighBitWidth + byteOffsetWidth));
+			unsigned f;
+			for (f=0; f<NUM_FIELDS; f++)
+			{
+				if (token.compare(0, 2, names[f]) == 0)
+				{
+					break;
+				}
+			}
+			char *end = NULL;
+			unsigned width = token.length() > 2 ? strtoul(token.c_str() + 2, &end, 10) : 0;
+			if (f == NUM_FIELDS || (end != NULL && (*end != '\0' || width == 0)))
+			{
+				ERROR("Bad field '"<<token<<"' in address mapping '"<<layout<<"'; fields are ch, ra, ba, ro and co, optionally followed by a bit count");
+				exit(-1);
+			}
+			if (width == 0)
+			{
+				restPieces[f]++;
+			}
+			explicitBits[f] += width;
+			tokenFields.push_back((Field)f);
+			tokenWidths.push_back(width);
 		}
 
-		//perform various address mapping schemes
-		if (addressMappingScheme == Scheme1)
+		for (unsigned f=0; f<NUM_FIELDS; f++)
 		{
-			//chan:rank:row:col:bank
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
-
+			if (explicitBits[f] > widths[f] || restPieces[f] > 1 || (restPieces[f] == 0 && explicitBits[f] != widths[f]))
+			{
+				ERROR("Address mapping '"<<layout<<"' gives "<<names[f]<<" the wrong number of bits, it has "<<widths[f]
+						<<" (at most one piece of a field can leave out its bit count)");
+				exit(-1);
+			}
+			if (!isPowerOfTwo(counts[f]) && explicitBits[f] > 0)
+			{
+				ERROR("Address mapping '"<<layout<<"' splits "<<names[f]<<", its count of "<<counts[f]<<" is not a power of two");
+				exit(-1);
+			}
 		}
-		else if (addressMappingScheme == Scheme2)
-		{
-			//chan:row:col:bank:rank
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
 
+		// lay the pieces out from the least significant bit up
+		unsigned shift = offsetBits;
+		unsigned filled[NUM_FIELDS] = {0};
+		for (unsigned f=0; f<NUM_FIELDS; f++)
+		{
+			fieldMask[f] = 0;
 		}
-		else if (addressMappingScheme == Scheme3)
+		for (size_t i=tokenFields.size(); i>0; i--)
 		{
-			//chan:rank:bank:col:row
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
-
+			Field f = tokenFields[i - 1];
+			Piece piece;
+			piece.shift = shift;
+			piece.width = tokenWidths[i - 1] ? tokenWidths[i - 1] : widths[f] - explicitBits[f];
+			piece.to = filled[f];
+			if (piece.width == 0)
+			{
+				continue;
+			}
+			pieces[f].push_back(piece);
+			fieldMask[f] |= ((1UL << piece.width) - 1) << shift;
+			filled[f] += piece.width;
+			shift += piece.width;
+
+			Digit digit;
+			digit.field = f;
+			digit.radix = isPowerOfTwo(counts[f]) ? 1U << piece.width : counts[f];
+			digit.to = piece.to;
+			digits.push_back(digit);
 		}
-		else if (addressMappingScheme == Scheme4)
+		if (shift > 64)
 		{
-			//chan:rank:bank:row:col
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
+			ERROR("Address mapping '"<<layout<<"' needs "<<shift<<" address bits");
+			exit(-1);
+		}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
+		istringstream hashes(hash);
+		while (getline(hashes, token, '+'))
+		{
+			vector<uint64_t> masks;
+			if (token == "none")
+			{
+				continue;
+			}
+			else if (token == "bank_xor")
+			{
+				for (unsigned i=0; i<widths[Bank]; i++)
+				{
+					masks.push_back(fieldBit(Bank, i) | (i < widths[Row] ? fieldBit(Row, i) : 0));
+				}
+				setXorMasks(Bank, masks);
+			}
+			else if (token == "channel_xor" || token == "rank_xor")
+			{
+				Field f = token == "channel_xor" ? Channel : Rank;
+				for (unsigned i=0; i<widths[f]; i++)
+				{
+					masks.push_back(fieldBit(f, i) | foldRow(i, widths[f]));
+				}
+				setXorMasks(f, masks);
+			}
+			else
+			{
+				ERROR("Unknown address hash '"<<token<<"'; valid values are 'none' or 'bank_xor', 'channel_xor' and 'rank_xor' joined with '+'");
+				exit(-1);
+			}
+		}
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
 
+	void AddressMapper::divide(uint64_t address, unsigned *values) const
+	{
+		address >>= offsetBits;
+		for (unsigned f=0; f<NUM_FIELDS; f++)
+		{
+			values[f] = 0;
 		}
-		else if (addressMappingScheme == Scheme5)
+		for (size_t i=0; i<digits.size(); i++)
 		{
-			//chan:row:col:rank:bank
+			values[digits[i].field] |= (unsigned)(address % digits[i].radix) << digits[i].to;
+			address /= digits[i].radix;
+		}
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
+	uint64_t AddressMapper::fieldBit(Field field, unsigned i) const
+	{
+		for (size_t p=0; p<pieces[field].size(); p++)
+		{
+			const Piece &piece = pieces[field][p];
+			if (i >= piece.to && i < piece.to + piece.width)
+			{
+				return 1UL << (piece.shift + i - piece.to);
+			}
+		}
+		return 0;
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
+	uint64_t AddressMapper::foldRow(unsigned i, unsigned width) const
+	{
+		uint64_t mask = 0;
+		for (unsigned r=i; r<widths[Row]; r+=width)
+		{
+			mask |= fieldBit(Row, r);
+		}
+		return mask;
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
 
+	void AddressMapper::setXorMasks(Field field, const vector<uint64_t> &masks)
+	{
+		static const char *names[] = {"channel", "rank", "bank"};
 
+		if (modulo)
+		{
+			ERROR("Address hashing needs power of two channel, rank, bank, row and column counts");
+			exit(-1);
 		}
-		else if (addressMappingScheme == Scheme6)
+		if (field > Bank || masks.size() != widths[field])
 		{
-			//chan:row:bank:rank:col
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
-
+			ERROR("The "<<(field <= Bank ? names[field] : "row/column")<<" hash needs one XOR mask per field bit, "<<widths[field]<<", got "<<masks.size());
+			exit(-1);
+		}
 
+		// for every value of the other address bits the hash is a linear map of the field's own bits,
+		// one to one when that matrix (bit j of row i: mask i holds the field's bit j) is invertible over GF(2)
+		vector<uint64_t> rows(masks.size(), 0);
+		for (size_t i=0; i<masks.size(); i++)
+		{
+			for (unsigned j=0; j<widths[field]; j++)
+			{
+				if (masks[i] & fieldBit(field, j))
+				{
+					rows[i] |= 1UL << j;
+				}
+			}
 		}
-		// clone of scheme 5, but channel moved to lower bits
-		else if (addressMappingScheme == Scheme7)
+		for (unsigned j=0; j<widths[field]; j++)
 		{
-			//row:col:rank:bank:chan
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			newTransactionChan = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			newTransactionBank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			newTransactionRank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			newTransactionColumn = tempA ^ tempB;
+			size_t pivot = j;
+			while (pivot < rows.size() && !(rows[pivot] & (1UL << j)))
+			{
+				pivot++;
+			}
+			if (pivot == rows.size())
+			{
+				ERROR("The "<<names[field]<<" XOR masks, on the bits the layout puts the "<<names[field]<<" on, are linearly dependent; "
+						<<"the mapping would not be one to one");
+				exit(-1);
+			}
+			swap(rows[j], rows[pivot]);
+			for (size_t i=0; i<rows.size(); i++)
+			{
+				if (i != j && (rows[i] & (1UL << j)))
+				{
+					rows[i] ^= rows[j];
+				}
+			}
+		}
+		xorMasks[field] = masks;
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			newTransactionRow = tempA ^ tempB;
 
+	void AddressMapper::setXorMasks(Field field, const string &masks)
+	{
+		vector<uint64_t> parsed;
+		istringstream in(masks);
+		string token;
+		while (getline(in, token, ':'))
+		{
+			char *end;
+			parsed.push_back(strtoull(token.c_str(), &end, 16));
+			if (token.empty() || *end != '\0')
+			{
+				ERROR("Bad XOR mask '"<<token<<"' in '"<<masks<<"', expected hex masks separated by ':'");
+				exit(-1);
+			}
 		}
+		setXorMasks(field, parsed);
+	}
 
-		else
+
+	uint64_t AddressMapper::interleaveBytes(Field field) const
+	{
+		uint64_t bytes = 1UL << offsetBits;
+		for (size_t i=0; i<digits.size() && digits[i].field != field; i++)
 		{
-			ERROR("== Error - Unknown Address Mapping Scheme");
-			exit(-1);
+			bytes *= digits[i].radix;
 		}
-		if (DEBUG_ADDR_MAP)
+		return bytes;
+	}
+
+
+	string AddressMapper::describe() const
+	{
+		static const char *names[] = {"ch", "ra", "ba"};
+		ostringstream out;
+
+		out << layout;
+		for (unsigned f=Channel; f<=Bank; f++)
 		{
-			DEBUG("Mapped Ch="<<newTransactionChan<<" Rank="<<newTransactionRank
-					<<" Bank="<<newTransactionBank<<" Row="<<newTransactionRow
-					<<" Col="<<newTransactionColumn<<"\n");
+			if (xorMasks[f].empty())
+			{
+				continue;
+			}
+			out << " " << names[f] << "=" << hex;
+			for (size_t i=0; i<xorMasks[f].size(); i++)
+			{
+				out << (i ? ":" : "") << "0x" << xorMasks[f][i];
+			}
+			out << dec;
 		}
-
+		return out.str();
 	}
-
-} // end of DRAMSim
+}
@@ -29,9 +29,180 @@
 *********************************************************************************/
 #ifndef ADDRESS_MAPPING_H
 #define ADDRESS_MAPPING_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "SystemConfiguration.h"
+
 namespace DRAMSim
 {
-	void addressMapping(uint64_t physicalAddress, unsigned &channel, unsigned &rank, unsigned &bank, unsigned &row, unsigned &col);
+	using std::string;
+	using std::vector;
+
+	/*
+	 * Physical address to channel/rank/bank/row/column decoding, compiled once
+	 * from a layout of ':' separated fields, the most significant first:
+	 *   ch ra ba ro co
+	 * "ch:ro:co:ba:ra" is scheme2, the seven schemes are presets of this. A
+	 * field can be split by giving its pieces a bit count: in "ro:co4:ba:co"
+	 * the column's top 4 bits sit above the bank and the rest below it. The
+	 * piece without a count gets the bits the others leave, and the pieces
+	 * nearer the bottom of the address hold the field's low bits. The byte
+	 * offset and the column bits a burst covers are below the layout.
+	 *
+	 * Each field becomes a mask over the address, so decoding a field is one
+	 * PEXT when the build targets BMI2 (-mbmi2 or -march=native) and one
+	 * shift and mask per piece otherwise.
+	 *
+	 * A channel, rank, bank, row or column count that is not a power of two
+	 * (6 or 12 channels, say) makes the layout a mixed radix number instead:
+	 * from the bottom up every field takes the address modulo its count and
+	 * leaves the quotient to the fields above it. Every address below the
+	 * capacity then maps to its own location. Such a field cannot be split,
+	 * and the hashes below need the bit layout.
+	 *
+	 * The channel, rank and bank can be hashed instead: bit i of the field
+	 * is then the parity of the address bits in its i-th XOR mask. The masks,
+	 * restricted to the field's own bits, have to be linearly independent
+	 * (over GF(2)) so the mapping stays one to one. The hash presets, joined
+	 * with '+':
+	 *   bank_xor     permutation interleaving, bank bit i ^= row bit i
+	 *   channel_xor  every channel bit folds in the row bits at its position
+	 *                modulo the channel bits, like the Intel channel hash
+	 *   rank_xor     the same fold for the rank
+	 * or masks of their own through setXorMasks.
+	 */
+	class AddressMapper
+	{
+	public:
+		typedef enum
+		{
+			Channel,
+			Rank,
+			Bank,
+			Row,
+			Column,
+			NUM_FIELDS
+		} Field;
+
+		// the field widths come from the current configuration, the channel count can be given instead
+		AddressMapper(const string &layout, const string &hash = "none", unsigned channels = NUM_CHANS);
+
+		// ':' separated hex masks over the physical address, bit 0 of the field first
+		void setXorMasks(Field field, const string &masks);
+
+		// the layout of a fixed scheme
+		static const char *presetLayout(AddressMappingScheme scheme);
+
+		void map(uint64_t address, unsigned &chan, unsigned &rank, unsigned &bank, unsigned &row, unsigned &col) const
+		{
+			if (modulo)
+			{
+				unsigned values[NUM_FIELDS];
+				divide(address, values);
+				chan = values[Channel];
+				rank = values[Rank];
+				bank = values[Bank];
+				row = values[Row];
+				col = values[Column];
+				return;
+			}
+			chan = decode(address, Channel);
+			rank = decode(address, Rank);
+			bank = decode(address, Bank);
+			row = extract(address, Row);
+			col = extract(address, Column);
+		}
+
+		unsigned channel(uint64_t address) const
+		{
+			if (modulo)
+			{
+				unsigned values[NUM_FIELDS];
+				divide(address, values);
+				return values[Channel];
+			}
+			return decode(address, Channel);
+		}
+
+		// the layout and any hashing
+		string describe() const;
+
+		// bytes of address space the layout puts below the field, before hashing
+		uint64_t interleaveBytes(Field field) const;
+
+	private:
+		struct Piece
+		{
+			unsigned shift;  // of the piece in the address
+			unsigned width;
+			unsigned to;     // of the piece in the field
+		};
+
+		// one place of the mixed radix layout
+		struct Digit
+		{
+			Field field;
+			unsigned radix;
+			unsigned to;     // of the digit in the field, a split field's pieces are power of two digits
+		};
+
+		string layout;
+		unsigned offsetBits;
+		unsigned widths[NUM_FIELDS];
+		uint64_t fieldMask[NUM_FIELDS];
+		vector<Piece> pieces[NUM_FIELDS];  // from the least significant up
+		vector<uint64_t> xorMasks[NUM_FIELDS];  // empty for a field that is not hashed
+		bool modulo;                       // a count is not a power of two, decode with digits
+		vector<Digit> digits;              // from the least significant up
+
+		void divide(uint64_t address, unsigned *values) const;
+
+		// the address bit that holds bit i of the field in the layout
+		uint64_t fieldBit(Field field, unsigned i) const;
+		void setXorMasks(Field field, const vector<uint64_t> &masks);
+		// the bits of the row that fall on bit i of a width bits wide field
+		uint64_t foldRow(unsigned i, unsigned width) const;
+
+		unsigned decode(uint64_t address, Field field) const
+		{
+			if (xorMasks[field].empty())
+			{
+				return extract(address, field);
+			}
+			unsigned value = 0;
+			for (size_t i=0; i<xorMasks[field].size(); i++)
+			{
+				value |= (unsigned)__builtin_parityll(address & xorMasks[field][i]) << i;
+			}
+			return value;
+		}
+
+		unsigned extract(uint64_t address, Field field) const
+		{
+#ifdef __BMI2__
+			return (unsigned)_pext_u64(address, fieldMask[field]);
+#else
+			const vector<Piece> &fieldPieces = pieces[field];
+			if (fieldPieces.size() == 1)
+			{
+				return (unsigned)((address & fieldMask[field]) >> fieldPieces[0].shift);
+			}
+			unsigned value = 0;
+			for (size_t i=0; i<fieldPieces.size(); i++)
+			{
+				value |= (unsigned)((address >> fieldPieces[i].shift) & ((1UL << fieldPieces[i].width) - 1)) << fieldPieces[i].to;
+			}
+			return value;
+#endif
+		}
+	};
 }
 
 #endif
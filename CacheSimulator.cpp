@@ -1,9 +1,14 @@
 #include "CacheSimulator.h"
+#include <stdint.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <assert.h>
@@ -19,7 +24,6 @@ FILE * trace;
 //FILE *mtrace;
 FILE *mtrace_gra;
 
-uint64_t evicted_LLC_count = 0;
 
 unsigned int non_mem_ins_count = 0;
 unsigned long total_ins_count = 0;
@@ -29,27 +33,33 @@ unsigned long total_mem_ins_count = 0;
 unsigned long mem_read_requests = 0;
 unsigned long mem_write_requests = 0;
 
-BlSim::CacheBlock::CacheBlock(uint32_t block_size)
+void BlSim::CacheBlock::invalidate()
 {
-    m_block_size = block_size;
     m_block_addr = INVALID_BLOCK;
-    m_next_lru = NULL;
-    m_prev_lru = NULL;
-    m_parent_block_in_lower = NULL;
+    m_block_tag = 0;
+    m_next_lru = INVALID_WAY;
+    m_prev_lru = INVALID_WAY;
     m_block_in_upper_cache = 0;
     m_dirty = 0;
+    m_prefetched = 0;
+    m_state = MESI_INVALID;
+    m_sector_valid = 0;
+    m_owner = 0;
+    m_sharers = 0;
 }
 
 void BlSim::CacheBlock::reset_block_access_distribution()
 {
 	m_dirty = 0;
+	m_prefetched = 0;
 }
 
-void BlSim::CacheBlock::hit_access(uint32_t mem_rw)
+void BlSim::CacheBlock::hit_access(uint32_t mem_rw, uint8_t sectors)
 {
 	if(mem_rw == MEM_WRITE)
 	{
-		m_dirty = 1;
+		m_dirty |= sectors;
+		m_state = MESI_MODIFIED;
 	}
 }
 
@@ -59,7 +69,6 @@ void BlSim::CacheBlock::get_data_from_evicted(CacheBlock *p_evicted_block)
 	assert(m_block_in_upper_cache == 1);
 	//this block not in upper cache any more
 	m_block_in_upper_cache = 0;
-	p_evicted_block->m_parent_block_in_lower = NULL;
 	m_dirty = p_evicted_block->m_dirty;
 }
 
@@ -69,108 +78,87 @@ void BlSim::CacheBlock::push_data_into_upper_block(CacheBlock *p_upper_block)
 
         //And, we just want to the access distribution info,
 
-	p_upper_block->m_parent_block_in_lower = this;
-
 	p_upper_block->m_dirty = m_dirty;
 }
 
 void BlSim::CacheBlock::print_cache_block()
 {
-	cout<<dec<<"size="<<m_block_size<<", block_addr=0x"<<hex<<m_block_addr<<dec<<endl;
+	cout<<dec<<"block_addr=0x"<<hex<<m_block_addr<<dec<<endl;
 }
 
 
 
-BlSim::CacheSet::CacheSet(uint32_t way_count, uint32_t block_size):
-	m_way_count(way_count)
+void BlSim::CacheSet::init(uint32_t way_count, CacheBlock *p_blocks)
 {
 	uint32_t i;
-	CacheBlock *p_block = NULL;
-	CacheBlock *p_next_block = NULL;
-	p_block = new CacheBlock(block_size);
-	m_p_mru_block = p_block;
 
-	for(i = 1; i < way_count; i++)
+	assert(way_count > 1 && way_count < INVALID_WAY);
+	m_way_count = way_count;
+	m_blocks = p_blocks;
+	m_evicted_count = 0;
+	m_evicted_unused_prefetch = 0;
+	m_capacity_hits = 0;
+
+	//link the ways in index order, way 0 is the mru block
+	for(i = 0; i < way_count; i++)
 	{
-		p_next_block = new CacheBlock(block_size);
-		p_block->m_next_lru = p_next_block;
-		p_next_block->m_prev_lru = p_block;
-		p_block = p_next_block;		
+		m_blocks[i].invalidate();
+		m_blocks[i].m_prev_lru = (i == 0) ? INVALID_WAY : i - 1;
+		m_blocks[i].m_next_lru = (i + 1 == way_count) ? INVALID_WAY : i + 1;
 	}
-	m_p_lru_block = p_next_block;
-
+	m_mru_way = 0;
+	m_lru_way = way_count - 1;
 }
 
-BlSim::CacheSet::~CacheSet()
+void BlSim::CacheSet::unlink_block(uint16_t way)
 {
-	CacheBlock *p_block;
-	CacheBlock *p_next_block;
+	CacheBlock *p_block = &m_blocks[way];
 
-	p_block = m_p_mru_block;
-
-	while(p_block)
+	if(p_block->m_prev_lru != INVALID_WAY)
+	{
+		m_blocks[p_block->m_prev_lru].m_next_lru = p_block->m_next_lru;
+	}
+	else
 	{
-		p_next_block = p_block->m_next_lru;
-		delete p_block;
-		p_block = p_next_block;
+		m_mru_way = p_block->m_next_lru;
 	}
+	if(p_block->m_next_lru != INVALID_WAY)
+	{
+		m_blocks[p_block->m_next_lru].m_prev_lru = p_block->m_prev_lru;
+	}
+	else
+	{
+		m_lru_way = p_block->m_prev_lru;
+	}
+	p_block->m_prev_lru = INVALID_WAY;
+	p_block->m_next_lru = INVALID_WAY;
 }
 
 void BlSim::CacheSet::hit_access(CacheBlock **pp_block)
 {
-    CacheBlock *p_block = *pp_block;
-    assert(m_p_mru_block->m_prev_lru == NULL);
-    assert(m_p_lru_block->m_next_lru == NULL);
+	CacheBlock *p_block = *pp_block;
+	uint16_t way = (uint16_t)(p_block - m_blocks);
 
-	if(!p_block->m_prev_lru)
-	{
-		//it is the mru block, we do not need to move the block position
-		assert(p_block->m_block_tag == m_p_mru_block->m_block_tag);
-	}
-	else
+	if(way != m_mru_way)
 	{
 		//get this block out of the link, and then put it in the mru position
-		p_block->m_prev_lru->m_next_lru = p_block->m_next_lru;
-		if(p_block->m_next_lru)
-		{
-			//this block is not the lru block
-			p_block->m_next_lru->m_prev_lru = p_block->m_prev_lru;
-		}
-        	else
-        	{
-            		//this is the lru block
-            		//Note: we need to update the lru pointer to its prev block, cause we move this block into mru
-            		assert(p_block->m_block_tag == m_p_lru_block->m_block_tag);
-            		m_p_lru_block = p_block->m_prev_lru;
-        	}
-
-		p_block->m_next_lru = m_p_mru_block;
-		m_p_mru_block->m_prev_lru = p_block;
-
-		p_block->m_prev_lru = NULL;  //now the p_block becomes the new mru block
-
-		m_p_mru_block = p_block;
+		unlink_block(way);
+		put_accessed_block_in_mru(p_block);
 	}
-
-	//p_block->hit_access(sub_block_index);
 }
 
 void BlSim::CacheSet::print_cache_set()
 {
 	uint32_t i;
+	uint16_t way;
 
 	cout<<"Set status: way_count="<<m_way_count<<endl;
 	
-	CacheBlock *p_block;
-        CacheBlock *p_next_block;
-	p_block = m_p_mru_block;
 	i = 0;
-	while(p_block)
+	for(way = m_mru_way; way != INVALID_WAY; way = m_blocks[way].m_next_lru)
 	{
-		p_next_block = p_block->m_next_lru;
 		cout<<"Cache Block "<<i<<": ";
-		p_block->print_cache_block();
-		p_block = p_next_block;
+		m_blocks[way].print_cache_block();
 		i++;
 	}
 	assert(i == m_way_count);
@@ -178,125 +166,337 @@ void BlSim::CacheSet::print_cache_set()
 
 BlSim::CacheBlock* BlSim::CacheSet::find_block(uint64_t mem_tag)
 {
-	CacheBlock *p_block;
-    //cout << "input tag: " << mem_tag << endl;;
-    //cout << "exist tag: \n" << m_p_mru_block->m_block_tag;
-	p_block = m_p_mru_block;
-	while(p_block)
+	uint32_t i;
+
+	//the tags are unique in a set, so scan the ways in memory order rather than lru order
+	for(i = 0; i < m_way_count; i++)
 	{
-		if(mem_tag == p_block->m_block_tag)
+		if(mem_tag == m_blocks[i].m_block_tag && !m_blocks[i].is_invalid_cache())
 		{
 			//find the cache block
-			return p_block;
+			return &m_blocks[i];
 		}
-		p_block = p_block->m_next_lru;
 	}
 	return NULL;  //not find cache block in the set
 }
 
-BlSim::CacheBlock* BlSim::CacheSet::evict_lru_block()
+BlSim::CacheBlock* BlSim::CacheSet::evict_lru_block(uint32_t way_mask)
 {
-	//Just evict the lru block, out of list
-        //Add 06/12/2012: can not evict the lru block with it is in the upper cache
-    
-	CacheBlock *p_block = m_p_lru_block;
-    	assert(p_block != NULL);
-    	if(!p_block->m_block_in_upper_cache)
-    	{
-        	//Well, the lru block is not in the upper cache, just evict
-        	//cout<<"## evicted lru block:"<<p_block->m_block_addr<<endl;
-	    	assert(p_block != NULL && p_block->m_prev_lru != NULL);
-
-	    	m_p_lru_block = p_block->m_prev_lru;
-	    	m_p_lru_block->m_next_lru = NULL;
-	    	p_block->m_prev_lru = NULL;
-    	}
-    	else
-    	{
-        	//we need to find the first block not in the upper cache
-#ifdef DEBUG_CACHE_SIMULATOR
-        	//cout<<"## In evict lru block, the lru block is in upper cache";
-#endif
-        	uint32_t block_num = 0;
-        	while(p_block != NULL && p_block->m_block_in_upper_cache)
-        	{
-            		p_block = p_block->m_prev_lru;
-            		block_num++;
-            		//assert(p_block != NULL);
-        	}
-#ifdef DEBUG_CACHE_SIMULATOR
-        	//cout<<":"<<block_num<<endl;
-#endif
-        	//Got the block, evict it
-        	//Is it possible the mru block, no way
-        	assert(p_block->m_block_tag != m_p_mru_block->m_block_tag);
-        	p_block->m_prev_lru->m_next_lru = p_block->m_next_lru;
-        	p_block->m_next_lru->m_prev_lru = p_block->m_prev_lru;
-        
-        	p_block->m_prev_lru = NULL;
-        	p_block->m_next_lru = NULL;
-    	}
-	
-	return p_block;
+	//Just evict the lru block, out of list; the inclusion policy of the level decides
+	//what happens to the copies in the upper caches (see Caches::evict_to_lower)
+	uint16_t way = m_lru_way;
+
+	if(way_mask != ALL_WAYS)
+	{
+		//a partitioned core walks up from the lru end to the first of its own ways
+		while(way != INVALID_WAY && !((way_mask >> way) & 1))
+		{
+			way = m_blocks[way].m_prev_lru;
+		}
+	}
+	assert(way != INVALID_WAY && (way != m_mru_way || way_mask != ALL_WAYS));
+	unlink_block(way);
+	return &m_blocks[way];
 }
 
-void BlSim::CacheSet::put_accessed_block_in_mru(CacheBlock *p_new_block)
+void BlSim::CacheSet::park_at_lru(uint16_t way)
 {
-	p_new_block->m_next_lru = m_p_mru_block;
-	m_p_mru_block->m_prev_lru = p_new_block;
-	
-	p_new_block->m_prev_lru = NULL;
+	//put an unlinked way at the lru end, so it is the next one refilled
+	m_blocks[way].m_prev_lru = m_lru_way;
+	m_blocks[m_lru_way].m_next_lru = way;
+	m_lru_way = way;
+}
 
-	m_p_mru_block = p_new_block;
-	
+void BlSim::CacheSet::invalidate_block(CacheBlock *p_block)
+{
+	uint16_t way = (uint16_t)(p_block - m_blocks);
+
+	unlink_block(way);
+	p_block->invalidate();
+	park_at_lru(way);
 }
 
-uint32_t BlSim::CacheSet::load_new_block_in_LLC(uint64_t maddr, uint64_t mem_tag)
+void BlSim::CacheSet::coherence_invalidate(CacheBlock *p_block)
 {
-#ifdef DEBUG_CACHE_SIMULATOR
-    	//cout<<"## Evicted lru at level LLC"<<endl; 
-#endif
-	uint32_t accessed_sub_block = INVALID_SUB_BLOCK_DIS;
-	CacheBlock *p_evicted_block = evict_lru_block();
+	uint16_t way = (uint16_t)(p_block - m_blocks);
+
+	unlink_block(way);
+	p_block->m_state = MESI_INVALID;
+	p_block->m_dirty = 0;
+	p_block->m_prefetched = 0;
+	p_block->m_block_in_upper_cache = 0;
+	park_at_lru(way);
+}
 
-	//uint32_t 
-	//write_back_mem_trace = 0;
+bool BlSim::CacheSet::find_coherence_invalid(uint64_t mem_tag)
+{
+	uint32_t i;
 
-	//To DO: print this evicted block as the output trace
-    	evicted_LLC_count++;
-	//update the num of accessed sub block
-	if(!p_evicted_block->is_invalid_cache() ) 
+	for(i = 0; i < m_way_count; i++)
 	{
+		if(mem_tag == m_blocks[i].m_block_tag && m_blocks[i].m_block_addr != INVALID_BLOCK
+		   && m_blocks[i].m_state == MESI_INVALID)
+		{
+			return true;
+		}
+	}
+	return false;
+}
 
-#ifdef CACHE_WRITE_BACK_SIM
-		if(p_evicted_block->m_dirty)
+bool BlSim::CacheSet::is_near_lru(CacheBlock *p_block, uint32_t ways)
+{
+	uint16_t way;
+	uint32_t i = 0;
+
+	for(way = m_lru_way; way != INVALID_WAY && i < ways; way = m_blocks[way].m_prev_lru, i++)
+	{
+		if(&m_blocks[way] == p_block)
 		{
-			//the cache block is dirty, write back it into the memory
-			write_back_mem_trace = 1;
-			//issue to the memory libing 
-			
+			return true;
 		}
-		else
-			{
-			write_back_mem_trace=0;
-			}
-#endif
 	}
+	return false;
+}
+
+BlSim::CacheBlock *BlSim::CacheSet::find_dirty_near_lru(uint32_t ways)
+{
+	uint16_t way;
+	uint32_t i = 0;
+
+	for(way = m_lru_way; way != INVALID_WAY && i < ways; way = m_blocks[way].m_prev_lru, i++)
+	{
+		if(m_blocks[way].m_dirty && !m_blocks[way].is_invalid_cache())
+		{
+			return &m_blocks[way];
+		}
+	}
+	return NULL;
+}
+
+uint32_t BlSim::CacheSet::mru_depth(CacheBlock *p_block)
+{
+	uint16_t way;
+	uint32_t depth = 0;
+
+	for(way = m_mru_way; way != INVALID_WAY && &m_blocks[way] != p_block; way = m_blocks[way].m_next_lru)
+	{
+		if(!m_blocks[way].is_invalid_cache())
+		{
+			depth++;
+		}
+	}
+	return depth;
+}
+
+uint32_t BlSim::CacheSet::used_segments()
+{
+	uint32_t segments = 0;
+	uint32_t i;
+
+	for(i = 0; i < m_way_count; i++)
+	{
+		if(!m_blocks[i].is_invalid_cache())
+		{
+			segments += m_blocks[i].m_segments;
+		}
+	}
+	return segments;
+}
+
+BlSim::CacheBlock *BlSim::CacheSet::find_lru_valid(CacheBlock *p_keep)
+{
+	uint16_t way;
+
+	for(way = m_lru_way; way != INVALID_WAY; way = m_blocks[way].m_prev_lru)
+	{
+		if(&m_blocks[way] != p_keep && !m_blocks[way].is_invalid_cache())
+		{
+			return &m_blocks[way];
+		}
+	}
+	return NULL;
+}
+
+void BlSim::CacheSet::put_accessed_block_in_mru(CacheBlock *p_new_block)
+{
+	uint16_t way = (uint16_t)(p_new_block - m_blocks);
+
+	p_new_block->m_prev_lru = INVALID_WAY;
+	p_new_block->m_next_lru = m_mru_way;
+	if(m_mru_way != INVALID_WAY)
+	{
+		m_blocks[m_mru_way].m_prev_lru = way;
+	}
+	else
+	{
+		m_lru_way = way;
+	}
+	m_mru_way = way;
+}
+
+BlSim::CacheBlock *BlSim::CacheSet::load_new_block(uint64_t maddr, uint64_t mem_tag, CacheBlock *p_victim, uint32_t way_mask)
+{
+	CacheBlock *p_evicted_block = evict_lru_block(way_mask);
+
+	//the caller takes care of the victim, hand it a copy before the way is reused
+	*p_victim = *p_evicted_block;
+	m_evicted_count++;
+	if(!p_evicted_block->is_invalid_cache())
+	{
+		if(p_evicted_block->m_prefetched)
+		{
+			m_evicted_unused_prefetch++;
+		}
 
+#ifdef CACHE_WRITE_BACK_SIM
+		//the cache block is dirty, write back it into the lower level or the memory
+		write_back_mem_trace = p_evicted_block->m_dirty ? 1 : 0;
+#endif
+	}
 
 	//construct this evicted as the new mru block
 	p_evicted_block->m_block_addr = maddr;
 	p_evicted_block->m_block_tag = mem_tag;
 	p_evicted_block->reset_block_access_distribution();
-    	p_evicted_block->m_block_in_upper_cache = 0;
-
-
+	p_evicted_block->m_block_in_upper_cache = 0;
+	p_evicted_block->m_state = MESI_EXCLUSIVE;
+	p_evicted_block->m_sharers = 0;
 
 	//ok then, put this new block in the mru location
 	put_accessed_block_in_mru(p_evicted_block);
-	
-	return accessed_sub_block;
+	return p_evicted_block;
+}
+
+namespace BlSim
+{
+    //worker threads for Caches::access_cache_batch: run() calls work(ctx, shard) once for
+    //every shard and returns when all are done, shard 0 runs on the calling thread
+    class ShardPool
+    {
+        protected:
+            struct Worker
+            {
+                ShardPool *m_pool;
+                uint32_t m_shard;
+                pthread_t m_thread;
+            };
+
+            uint32_t m_thread_count;
+            void (*m_work)(void *ctx, uint32_t shard);
+            void *m_ctx;
+            std::vector<Worker> m_workers;
+
+            pthread_mutex_t m_lock;
+            pthread_cond_t m_start;
+            pthread_cond_t m_done;
+            uint64_t m_generation;  //bumped for every run
+            uint32_t m_running;     //workers still busy with the current run
+            bool m_exit;
+
+            static void *worker_main(void *p_arg);
+
+        public:
+            ShardPool(uint32_t thread_count, void (*work)(void *ctx, uint32_t shard), void *ctx);
+            ~ShardPool();
+
+            void run();
+    };
+}
+
+BlSim::ShardPool::ShardPool(uint32_t thread_count, void (*work)(void *ctx, uint32_t shard), void *ctx):
+	m_thread_count(thread_count), m_work(work), m_ctx(ctx)
+{
+	uint32_t i;
+
+	pthread_mutex_init(&m_lock, NULL);
+	pthread_cond_init(&m_start, NULL);
+	pthread_cond_init(&m_done, NULL);
+	m_generation = 0;
+	m_running = 0;
+	m_exit = false;
+
+	//the workers keep pointers into m_workers, size it before starting any thread
+	m_workers.resize(thread_count);
+	for(i = 1; i < thread_count; i++)
+	{
+		m_workers[i].m_pool = this;
+		m_workers[i].m_shard = i;
+		if(pthread_create(&m_workers[i].m_thread, NULL, worker_main, &m_workers[i]) != 0)
+		{
+			cerr<<"Could not start cache shard thread "<<i<<endl;
+			exit(-8);
+		}
+	}
+}
+
+BlSim::ShardPool::~ShardPool()
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&m_lock);
+	m_exit = true;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_lock);
+
+	for(i = 1; i < m_thread_count; i++)
+	{
+		pthread_join(m_workers[i].m_thread, NULL);
+	}
+
+	pthread_cond_destroy(&m_done);
+	pthread_cond_destroy(&m_start);
+	pthread_mutex_destroy(&m_lock);
+}
+
+void *BlSim::ShardPool::worker_main(void *p_arg)
+{
+	Worker *p_worker = (Worker *)p_arg;
+	ShardPool *p_pool = p_worker->m_pool;
+	uint64_t seen = 0;
+
+	pthread_mutex_lock(&p_pool->m_lock);
+	while(true)
+	{
+		while(p_pool->m_generation == seen && !p_pool->m_exit)
+		{
+			pthread_cond_wait(&p_pool->m_start, &p_pool->m_lock);
+		}
+		if(p_pool->m_exit)
+		{
+			break;
+		}
+		seen = p_pool->m_generation;
+		pthread_mutex_unlock(&p_pool->m_lock);
+
+		p_pool->m_work(p_pool->m_ctx, p_worker->m_shard);
+
+		pthread_mutex_lock(&p_pool->m_lock);
+		p_pool->m_running--;
+		if(p_pool->m_running == 0)
+		{
+			pthread_cond_signal(&p_pool->m_done);
+		}
+	}
+	pthread_mutex_unlock(&p_pool->m_lock);
+	return NULL;
+}
+
+void BlSim::ShardPool::run()
+{
+	pthread_mutex_lock(&m_lock);
+	m_running = m_thread_count - 1;
+	m_generation++;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_lock);
+
+	m_work(m_ctx, 0);
 
+	pthread_mutex_lock(&m_lock);
+	while(m_running > 0)
+	{
+		pthread_cond_wait(&m_done, &m_lock);
+	}
+	pthread_mutex_unlock(&m_lock);
 }
 
 BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
@@ -304,7 +504,6 @@ BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
 	if(cache_config_fname == NULL)
 	{
 		uint32_t i;
-		uint32_t j;
 		//we use the default cache config of core i7
 		m_level = 1;
 		if(m_level > MAX_CACHE_LEVEL)
@@ -330,6 +529,16 @@ BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
 		m_block_size[1] = 64;
 		m_block_size[2] = 64;
 
+		m_tag_latency[0] = 1;   //L1 4 cycles load to use
+		m_tag_latency[1] = 2;   //L2 12 cycles
+		m_tag_latency[2] = 6;   //L3 ~40 cycles
+		m_data_latency[0] = 3;
+		m_data_latency[1] = 10;
+		m_data_latency[2] = 34;
+		m_port_count[0] = 2;    //two loads per cycle
+		m_port_count[1] = 1;
+		m_port_count[2] = 1;
+
 
 
 		for(i = 0; i < m_level; i++)
@@ -337,13 +546,8 @@ BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
 			m_cache_set_capacity[i] = m_block_size[i] * m_cache_way_count[i];
 			m_cache_set_count[i] = m_cache_capacity[i] / m_cache_set_capacity[i];
 
-			m_mem_reads[i] = 0;
-			m_mem_reads_hit[i] = 0;
-			m_mem_reads_miss[i] = 0;
-
-			m_mem_writes[i] = 0;
-			m_mem_writes_hit[i] = 0;
-			m_mem_writes_miss[i] = 0;
+			reset_ports(i);
+			m_port_stall_cycles[i] = 0;
 		}
 
 		for(i = 0; i < m_level; i++)
@@ -360,19 +564,64 @@ BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
 		
 		m_cache_config_fname = NULL;
 
-		//alloc memoryu for real cache sets
+		m_counters.reset();
+		m_prefetcher = NULL;
+		m_reuse_profiler = NULL;
+		m_stack_simulator = NULL;
+		m_miss_trace = NULL;
+		m_trace_gap = 0;
+		m_last_access_level = m_level;
+		for(i = 0; i < MAX_CACHE_LEVEL; i++)
+		{
+			m_inclusion[i] = INCLUSIVE;
+			m_slice_count[i] = 1;
+		}
+		m_core_count = 1;
+		m_coherence_latency = 0;
+		m_current_core = 0;
+		m_way_partitioned = false;
+		for(i = 0; i < MAX_CORE_COUNT; i++)
+		{
+			m_way_masks[i] = ALL_WAYS;
+		}
+		m_partitioner = NULL;
+		m_sector_count = 1;
+		m_sector_bits = m_block_low_bits[m_level-1];
+		m_all_sectors = 1;
+		m_access_sectors = 1;
+		m_last_fetch_sectors = 0;
+		m_queue_writebacks = false;
+		m_row_column_mask = 0;
+		m_clean_ways = 0;
+		m_clean_set = 0;
+		m_compressor = NULL;
+		m_data_ways = m_cache_way_count[m_level-1];
+		m_segment_budget = 0;
+		m_access_data = NULL;
+		m_access_data_offset = 0;
+		m_access_data_bytes = 0;
+
+		m_thread_count = 1;
+		m_shard_set_mask = 0;
+		m_shard_pool = NULL;
+		m_batch_maddrs = NULL;
+		m_batch_mem_rws = NULL;
+		m_batch_cores = NULL;
+		m_batch_sectors = NULL;
+		m_batch_hits = NULL;
+
+		//alloc memoryu for real cache sets, one slab per level; the sets are set up on their first access
 		for(i = 0; i < MAX_CACHE_LEVEL; i++)
 		{
 			m_cache_sets[i] = NULL;
+			m_cache_blocks[i] = NULL;
+			m_set_slab_bytes[i] = 0;
+			m_block_slab_bytes[i] = 0;
 		}
 
 		for(i = 0; i < m_level; i++)
 		{
-			m_cache_sets[i] = new CacheSet *[m_cache_set_count[i]];
-			for(j = 0; j < m_cache_set_count[i]; j++)
-			{
-				m_cache_sets[i][j] = new CacheSet(m_cache_way_count[i], m_block_size[i]);
-			}
+			alloc_level(i);
 		}
 
 	
@@ -391,26 +640,118 @@ BlSim::Caches::Caches(char *cache_config_fname, unsigned int numCores)
 BlSim::Caches::~Caches()
 {
 	uint32_t i;
-	uint32_t j;
     	cout<<"in ~Caches()"<<endl;
 
 	for(i = 0; i < m_level; i++)
-        {
-        	for(j = 0; j < m_cache_set_count[i]; j++)
-                {
-			if(m_cache_sets[i][j])
-			{
-				delete m_cache_sets[i][j];
-				m_cache_sets[i][j] = NULL;
-			}
-                }
-		delete []m_cache_sets[i];
+	{
+		free_slab(m_cache_sets[i], m_set_slab_bytes[i]);
+		free_slab(m_cache_blocks[i], m_block_slab_bytes[i]);
 		m_cache_sets[i] = NULL;
-       	}
+		m_cache_blocks[i] = NULL;
+	}
+
+	if(m_prefetcher)
+	{
+		delete m_prefetcher;
+		m_prefetcher = NULL;
+	}
+	if(m_shard_pool)
+	{
+		delete m_shard_pool;
+		m_shard_pool = NULL;
+	}
+	if(m_reuse_profiler)
+	{
+		delete m_reuse_profiler;
+		m_reuse_profiler = NULL;
+	}
+	if(m_stack_simulator)
+	{
+		delete m_stack_simulator;
+		m_stack_simulator = NULL;
+	}
+	if(m_partitioner)
+	{
+		delete m_partitioner;
+		m_partitioner = NULL;
+	}
+	if(m_compressor)
+	{
+		delete m_compressor;
+		m_compressor = NULL;
+	}
+	close_miss_trace();
+}
+
+void *BlSim::Caches::alloc_slab(size_t bytes)
+{
+	//anonymous pages are zero filled and only backed when touched, a zero set is an uninitialized one
+	void *p_slab = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(p_slab == MAP_FAILED)
+	{
+		cerr<<"Could not allocate "<<bytes<<" bytes for the cache"<<endl;
+		exit(-8);
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(p_slab, bytes, MADV_HUGEPAGE);
+#endif
+	return p_slab;
+}
+
+void BlSim::Caches::free_slab(void *p_slab, size_t bytes)
+{
+	if(p_slab)
+	{
+		munmap(p_slab, bytes);
+	}
+}
+
+void BlSim::Caches::alloc_level(uint32_t level)
+{
+	size_t set_count = (size_t)m_cache_set_count[level] * m_slice_count[level];
+
+	free_slab(m_cache_sets[level], m_set_slab_bytes[level]);
+	free_slab(m_cache_blocks[level], m_block_slab_bytes[level]);
+
+	m_set_slab_bytes[level] = set_count * sizeof(CacheSet);
+	m_block_slab_bytes[level] = set_count * m_cache_way_count[level] * sizeof(CacheBlock);
+	m_cache_sets[level] = (CacheSet *)alloc_slab(m_set_slab_bytes[level]);
+	m_cache_blocks[level] = (CacheBlock *)alloc_slab(m_block_slab_bytes[level]);
+
+	//pick the lookup once here rather than looping over a runtime way count on every access
+	switch(m_cache_way_count[level])
+	{
+		case 2:  m_find_block[level] = &CacheSet::find_block_ways<2>; break;
+		case 4:  m_find_block[level] = &CacheSet::find_block_ways<4>; break;
+		case 8:  m_find_block[level] = &CacheSet::find_block_ways<8>; break;
+		case 16: m_find_block[level] = &CacheSet::find_block_ways<16>; break;
+		case 32: m_find_block[level] = &CacheSet::find_block_ways<32>; break;
+		default: m_find_block[level] = &CacheSet::find_block; break;
+	}
+}
+
+BlSim::CacheSet *BlSim::Caches::get_set(uint32_t level, uint32_t set_index, uint32_t core)
+{
+	assert(level < m_level && set_index < m_cache_set_count[level]);
+
+	size_t index = set_index;
+	if(m_slice_count[level] > 1)
+	{
+		assert(core < m_slice_count[level]);
+		index += (size_t)core * m_cache_set_count[level];
+	}
+
+	CacheSet *p_set = &m_cache_sets[level][index];
+	if(!p_set->is_initialized())
+	{
+		p_set->init(m_cache_way_count[level], &m_cache_blocks[level][index * m_cache_way_count[level]]);
+	}
+	return p_set;
 }
 
 BlSim::CacheSet* BlSim::Caches::access_cache_at_level(uint64_t maddr,
                                                           uint32_t level,
+                                                          uint32_t core,
                                                           uint64_t *mtag,
                                                           bool* hit)
 {
@@ -421,21 +762,26 @@ BlSim::CacheSet* BlSim::Caches::access_cache_at_level(uint64_t maddr,
 
 	get_cache_addr_parts(maddr, mtag, &set_index, level);
     
-    	assert(set_index >= 0 && set_index < m_cache_set_count[level] && (m_cache_sets[level][set_index] != NULL));
+	CacheSet *p_set = get_set(level, set_index, core);
 
-	CacheBlock *p_block = m_cache_sets[level][set_index]->find_block(*mtag);
+	CacheBlock *p_block = lookup(p_set, level, *mtag);
 	if(p_block)
 	{
 	    //cout << "find block" << endl;
 		//Yeah, we find the cache block in this set. Hit it in the mru
-		m_cache_sets[level][set_index]->hit_access(&p_block);
-        	assert(m_cache_sets[level][set_index]->get_mru_block()->m_block_tag == *mtag);
+		if(m_compressor && level == m_level-1 && p_set->mru_depth(p_block) >= m_data_ways)
+		{
+			//an uncompressed LLC would have evicted the block by now
+			p_set->m_capacity_hits++;
+		}
+		p_set->hit_access(&p_block);
+        	assert(p_set->get_mru_block()->m_block_tag == *mtag);
 		*hit = true;
 #ifdef DEBUG_CACHE_SIMULATOR
 		//cout<<"Cache Hit at Level "<<level <<": addr=0x"<<hex<<maddr<<", mtag="<<*mtag<<dec<<", set_index="<<set_index<<", sb_index="<<*sub_block_index<<endl;
 #endif
 	}
-	return m_cache_sets[level][set_index];
+	return p_set;
 }
 
 /*void BlSim::Caches::output_mem_reqs_statistics()
@@ -444,157 +790,1105 @@ BlSim::CacheSet* BlSim::Caches::access_cache_at_level(uint64_t maddr,
 	cout<<endl<<endl<<"$$$$ Memory Request Cache Statistics:"<<endl;
 	for(i = 0; i < m_level; i++)
 	{
-		cout<<i<<"th level cache:read="<<m_mem_reads[i]<<", read_hit="<<m_mem_reads_hit[i]<<", read_miss="<<m_mem_reads_miss[i]<<endl;
-		cout<<"\t\twrite="<<m_mem_writes[i]<<", write_hit="<<m_mem_writes_hit[i]<<", write_miss="<<m_mem_writes_miss[i]<<endl;
+		cout<<i<<"th level cache:read="<<m_counters.m_mem_reads[i]<<", read_hit="<<m_counters.m_mem_reads_hit[i]<<", read_miss="<<m_counters.m_mem_reads_miss[i]<<endl;
+		cout<<"\t\twrite="<<m_counters.m_mem_writes[i]<<", write_hit="<<m_counters.m_mem_writes_hit[i]<<", write_miss="<<m_counters.m_mem_writes_miss[i]<<endl;
 	}
 
 }*/
 
 
-bool BlSim::Caches::access_cache(uint64_t maddr, uint32_t memop)
+bool BlSim::Caches::access_levels(uint64_t maddr, uint32_t memop, uint32_t core, uint8_t sectors,
+                                  CacheCounters &counters, uint32_t *p_level)
 {
 	uint32_t i;
 	CacheSet *access_cache_sets[MAX_CACHE_LEVEL];
+	CacheBlock *partial_blocks[MAX_CACHE_LEVEL];  //blocks that miss some sectors of the access
 	uint64_t mtags[MAX_CACHE_LEVEL];
    	 bool hit = false;
-   	 m_total_count++;
+	bool coherent = m_core_count > 1 && m_level > 1;
+	uint8_t state = MESI_INVALID;
+	uint8_t present = 0;  //sectors of the access found in partial blocks on the way down
+
+	if(core >= m_core_count)
+	{
+		if(m_core_count > 1)
+		{
+			cerr<<"Access of core "<<core<<", the caches are set up for "<<m_core_count<<" cores"<<endl;
+			exit(-8);
+		}
+		core = 0;  //one core: everybody shares every level
+	}
+
+   	 counters.m_total_count++;
+	*p_level = m_level;
 	for(i = 0; i < m_level; i++)
 	{
-        access_cache_sets[i] = access_cache_at_level(maddr, i, &mtags[i], &hit);
+        access_cache_sets[i] = access_cache_at_level(maddr, i, core, &mtags[i], &hit);
         assert(access_cache_sets[i] != NULL);
+		partial_blocks[i] = NULL;
+		if(hit && (access_cache_sets[i]->get_mru_block()->m_sector_valid & sectors) != sectors)
+		{
+			//the block is here but some sectors are not, look further down for them
+			partial_blocks[i] = access_cache_sets[i]->get_mru_block();
+			present |= partial_blocks[i]->m_sector_valid & sectors;
+			counters.m_sector_misses[i]++;
+			hit = false;
+		}
         if(memop == MEM_READ)
 		{
-			m_mem_reads[i]++;
+			counters.m_mem_reads[i]++;
 			if(hit)
 			{
-				m_mem_reads_hit[i]++;
+				counters.m_mem_reads_hit[i]++;
 			}
 			else
 			{
-				m_mem_reads_miss[i]++;
+				counters.m_mem_reads_miss[i]++;
 			}
 		}
 		else if(memop == MEM_WRITE)
 		{
-			m_mem_writes[i]++;
+			counters.m_mem_writes[i]++;
 			if(hit)
 			{
-				m_mem_writes_hit[i]++;
+				counters.m_mem_writes_hit[i]++;
 			}
 			else
 			{
-				m_mem_writes_miss[i]++;
+				counters.m_mem_writes_miss[i]++;
 			}
 		}
 		if(hit)
 		{
 		    //cout << "hit" << endl;
 			//we got the cache block hit in this cache level
-			m_hit_count++;
+			counters.m_hit_count++;
+			*p_level = i;
 			break;
 		}
 		
 	}
-	
+
+	if(!hit && present == sectors)
+	{
+		//the levels have every sector between them, the deepest partial block serves the access
+		for(i = m_level; partial_blocks[i-1] == NULL; i--)
+		{
+		}
+		i--;
+		partial_blocks[i] = NULL;
+		counters.m_hit_count++;
+		*p_level = i;
+		hit = true;
+	}
+
+	if(coherent)
+	{
+		if(memop == MEM_READ && i + 1 < m_level)
+		{
+			//a read hit in the private levels keeps its state
+			state = access_cache_sets[i]->get_mru_block()->m_state;
+		}
+		else
+		{
+			state = coherence_request(maddr, memop, core, i, counters);
+		}
+	}
+
+	uint8_t dirty = 0;
+	uint8_t prefetched = 0;
+	uint8_t valid = sectors;  //what the new upper copies get
 	if(!hit)
 	{
 	   //cout << "miss" << endl;
-	   m_miss_count++;
-		//the cache block miss in all level of caches, we put it in the 
+	   counters.m_miss_count++;
+		//the cache block miss in all level of caches, it comes clean from the memory
 		assert(i == m_level);
-		uint32_t accessed_sub_block;
-
-		//for memory write request, first send read, write when the cache block is written back
-		accessed_sub_block = access_cache_sets[m_level-1]->load_new_block_in_LLC(maddr, mtags[m_level-1]);
-		i--;
-		/*if(write_back_mem_trace){
-			hit=false;
-		}*/
+		counters.m_core_misses[core]++;
+		counters.m_fetches++;
+		counters.m_fetched_sectors += __builtin_popcount(sectors & ~present);
+	}
+	else if(i > 0)
+	{
+		CacheBlock *p_hit_block = access_cache_sets[i]->get_mru_block();
+		if(m_inclusion[i] == EXCLUSIVE)
+		{
+			//the block moves up, an exclusive level does not keep a copy
+			dirty = p_hit_block->m_dirty;
+			prefetched = p_hit_block->m_prefetched;
+			valid |= p_hit_block->m_sector_valid;
+			access_cache_sets[i]->invalidate_block(p_hit_block);
+		}
+		else
+		{
+			p_hit_block->m_block_in_upper_cache = 1;
+		}
 	}
 
-#ifdef DEBUG_CACHE_SIMULATOR
-    	//cout<<"## Enter in Cache replaced: "<<i<<endl;
-#endif
-
-	//Now we need to put this new block into the upper cache until to the L1 cache
+	//Now we need to put this new block into the upper cache until to the L1 cache,
+	//the L1 copy owns the dirty data handed up by an exclusive level
+	uint32_t hit_level = i;
 	while(i > 0)
 	{
-		//replace the upper lru block with the lower new mru block
-        	assert(i > 0);
-        	assert(access_cache_sets[i] && access_cache_sets[i-1]);
-        	assert(access_cache_sets[i]->get_mru_block()->m_block_tag == mtags[i]);
-#ifdef DEBUG_CACHE_SIMULATOR
-        	//cout<<"## Before cache replaced at level " << i <<endl;
-#endif
-		cache_replaced(access_cache_sets[i], access_cache_sets[i-1], i, mtags[i-1], maddr);
 		i--;
+		CacheBlock *p_partial = partial_blocks[i];
+		if(p_partial && i > 0 && m_inclusion[i] == EXCLUSIVE)
+		{
+			//an exclusive level hands its sectors up as well
+			dirty |= p_partial->m_dirty;
+			valid |= p_partial->m_sector_valid;
+			access_cache_sets[i]->invalidate_block(p_partial);
+		}
+		else if(p_partial)
+		{
+			//the block stays, it only gains the sectors
+			p_partial->m_sector_valid |= valid;
+			if(i == 0)
+			{
+				p_partial->m_dirty |= dirty;
+				p_partial->m_prefetched |= prefetched;
+			}
+		}
+		else if(i == 0)
+		{
+			install_block(maddr, 0, core, dirty, prefetched, 0, counters)->m_sector_valid = valid;
+		}
+		else if(m_inclusion[i] != EXCLUSIVE)
+		{
+			install_block(maddr, i, core, 0, 0, 1, counters)->m_sector_valid = valid;
+		}
+	}
+
+	assert(access_cache_sets[0]->get_mru_block()->m_block_tag == mtags[0]);
+	access_cache_sets[0]->get_mru_block()->hit_access(memop, sectors);
+
+	if(coherent && (hit_level > 0 || memop == MEM_WRITE))
+	{
+		//the new copies take the state of the core, the directory records the core as a sharer
+		CacheBlock *p_llc_block = find_block_in_LLC(maddr);
+		if(p_llc_block)
+		{
+			p_llc_block->m_sharers |= 1U << core;
+			p_llc_block->m_block_in_upper_cache = 1;
+		}
+		set_private_state(maddr, core, memop == MEM_WRITE ? (uint8_t)MESI_MODIFIED : state);
+	}
+	return hit;
+}
+
+uint8_t BlSim::Caches::coherence_request(uint64_t maddr, uint32_t memop, uint32_t core, uint32_t hit_level,
+                                         CacheCounters &counters)
+{
+	uint32_t i;
+
+	if(hit_level + 1 >= m_level)
+	{
+		//missed the private levels, count it as a coherence miss if another core took the block away
+		for(i = 0; i + 1 < m_level; i++)
+		{
+			uint64_t mem_tag;
+			uint32_t set_index;
+
+			get_cache_addr_parts(maddr, &mem_tag, &set_index, i);
+			if(get_set(i, set_index, core)->find_coherence_invalid(mem_tag))
+			{
+				counters.m_coherence_misses++;
+				break;
+			}
+		}
+	}
+
+	if(hit_level == m_level)
+	{
+		//not in the inclusive LLC, so no other core has it either
+		return memop == MEM_WRITE ? MESI_MODIFIED : MESI_EXCLUSIVE;
+	}
+
+	CacheBlock *p_llc_block = find_block_in_LLC(maddr);
+	assert(p_llc_block != NULL);
+	uint32_t others = p_llc_block->m_sharers & ~(1U << core);
+
+	if(hit_level + 1 < m_level)
+	{
+		//a write hit in the private levels, only a shared copy has to ask the directory
+		if(private_state(maddr, core) != MESI_SHARED)
+		{
+			return MESI_MODIFIED;
+		}
+		counters.m_upgrades++;
+	}
+
+	uint8_t state = memop == MEM_WRITE ? MESI_MODIFIED : MESI_EXCLUSIVE;
+	for(i = 0; others != 0; i++, others >>= 1)
+	{
+		if((others & 1) == 0)
+		{
+			continue;
+		}
+
+		uint8_t other_state = private_state(maddr, i);
+		if(other_state == MESI_INVALID)
+		{
+			//the core dropped its clean copy without telling the directory
+			p_llc_block->m_sharers &= ~(1U << i);
+		}
+		else if(memop == MEM_WRITE)
+		{
+			counters.m_invalidations++;
+			uint8_t dirty = invalidate_private(maddr, i);
+			if(dirty)
+			{
+				p_llc_block->m_dirty |= dirty;
+				p_llc_block->m_sector_valid |= dirty;
+				counters.m_coherence_writebacks++;
+			}
+			p_llc_block->m_sharers &= ~(1U << i);
+		}
+		else
+		{
+			if(other_state != MESI_SHARED)
+			{
+				//the owner keeps a shared copy, its modified data goes to the LLC
+				counters.m_downgrades++;
+				uint8_t dirty = set_private_state(maddr, i, MESI_SHARED);
+				if(dirty)
+				{
+					p_llc_block->m_dirty |= dirty;
+					p_llc_block->m_sector_valid |= dirty;
+					counters.m_coherence_writebacks++;
+				}
+			}
+			state = MESI_SHARED;
+		}
+	}
+	return state;
+}
+
+uint8_t BlSim::Caches::private_state(uint64_t maddr, uint32_t core)
+{
+	uint32_t i;
+
+	for(i = 0; i + 1 < m_level; i++)
+	{
+		CacheBlock *p_block = find_block_at_level(maddr, i, core);
+		if(p_block)
+		{
+			return p_block->m_state;
+		}
+	}
+	return MESI_INVALID;
+}
+
+uint8_t BlSim::Caches::set_private_state(uint64_t maddr, uint32_t core, uint8_t state)
+{
+	uint8_t dirty = 0;
+	uint32_t i;
+
+	for(i = 0; i + 1 < m_level; i++)
+	{
+		CacheBlock *p_block = find_block_at_level(maddr, i, core);
+		if(p_block)
+		{
+			p_block->m_state = state;
+			if(state == MESI_SHARED)
+			{
+				//a shared copy is clean, the LLC holds the data
+				dirty |= p_block->m_dirty;
+				p_block->m_dirty = 0;
+			}
+		}
+	}
+	return dirty;
+}
+
+uint8_t BlSim::Caches::invalidate_private(uint64_t maddr, uint32_t core)
+{
+	uint8_t dirty = 0;
+	uint32_t i;
+
+	for(i = 0; i + 1 < m_level; i++)
+	{
+		uint64_t mem_tag;
+		uint32_t set_index;
+
+		get_cache_addr_parts(maddr, &mem_tag, &set_index, i);
+		CacheSet *p_set = get_set(i, set_index, core);
+		CacheBlock *p_block = lookup(p_set, i, mem_tag);
+		if(p_block)
+		{
+			dirty |= p_block->m_dirty;
+			p_set->coherence_invalidate(p_block);
+		}
+	}
+	return dirty;
+}
+
+BlSim::CacheBlock *BlSim::Caches::install_block(uint64_t maddr, uint32_t level, uint32_t core, uint8_t dirty,
+                                                uint8_t prefetched, uint8_t in_upper, CacheCounters &counters)
+{
+	uint64_t mem_tag;
+	uint32_t set_index;
+	CacheBlock victim;
+
+	//only the LLC is partitioned
+	uint32_t way_mask = (m_way_partitioned && level + 1 == m_level) ? m_way_masks[core] : ALL_WAYS;
+
+	get_cache_addr_parts(maddr, &mem_tag, &set_index, level);
+	CacheSet *p_set = get_set(level, set_index, core);
+	CacheBlock *p_block = p_set->load_new_block(maddr, mem_tag, &victim, way_mask);
+	p_block->m_owner = (uint8_t)core;
+	p_block->m_dirty = dirty;
+	p_block->m_prefetched = prefetched;
+	p_block->m_block_in_upper_cache = in_upper;
+	p_block->m_sector_valid = m_all_sectors;
+
+	if(!victim.is_invalid_cache())
+	{
+		evict_to_lower(victim, level, core, counters);
+	}
+	if(m_compressor && level + 1 == m_level)
+	{
+		//a free tag is not enough, the compressed block needs room in the data ways as well
+		p_block->m_segments = (uint8_t)m_compressor->get_segments(maddr);
+		counters.m_llc_fills++;
+		counters.m_fill_segments += p_block->m_segments;
+		fit_segments(p_set, p_block, core, counters);
+	}
+	return p_block;
+}
+
+uint8_t BlSim::Caches::back_invalidate(uint64_t maddr, uint32_t level, uint32_t core, bool *p_found)
+{
+	uint8_t dirty = 0;
+	uint32_t i;
+
+	*p_found = false;
+	for(i = 0; i < level; i++)
+	{
+		CacheBlock *p_block = find_block_at_level(maddr, i, core);
+		if(p_block)
+		{
+			uint64_t mem_tag;
+			uint32_t set_index;
+
+			dirty |= p_block->m_dirty;
+			get_cache_addr_parts(maddr, &mem_tag, &set_index, i);
+			get_set(i, set_index, core)->invalidate_block(p_block);
+			*p_found = true;
+		}
+	}
+	return dirty;
+}
+
+void BlSim::Caches::evict_to_lower(const CacheBlock &victim, uint32_t level, uint32_t core, CacheCounters &counters)
+{
+	uint64_t maddr = victim.m_block_addr;
+	uint8_t dirty = victim.m_dirty;
+	uint8_t in_upper = victim.m_block_in_upper_cache;
+	bool coherent = m_core_count > 1 && m_level > 1;
+
+	if(level > 0 && m_inclusion[level] == INCLUSIVE && in_upper)
+	{
+		//keep the upper levels inside this one, their dirty data leaves with the victim
+		bool found = false;
+		if(coherent && level + 1 == m_level)
+		{
+			//the directory knows which cores may have a copy
+			uint32_t c;
+			for(c = 0; c < m_core_count; c++)
+			{
+				bool core_found;
+				if(victim.m_sharers & (1U << c))
+				{
+					dirty |= back_invalidate(maddr, level, c, &core_found);
+					found = found || core_found;
+				}
+			}
+		}
+		else
+		{
+			dirty |= back_invalidate(maddr, level, core, &found);
+		}
+		if(found)
+		{
+			counters.m_inclusion_victims[level]++;
+		}
+		in_upper = 0;
+	}
+
+	if(level + 1 == m_level)
+	{
+		if(dirty)
+		{
+			//the LLC writes the dirty sectors back to the memory
+			counters.m_writebacks[level]++;
+			counters.m_core_writebacks[victim.m_owner]++;
+			counters.m_writeback_sectors += __builtin_popcount(dirty);
+			if(m_queue_writebacks)
+			{
+				m_writeback_queue.push_back(std::make_pair(maddr, dirty));
+				if(m_row_column_mask)
+				{
+					//the rest of the row goes right behind it, while the row is open
+					clean_row(maddr, counters);
+				}
+			}
+		}
+		return;
+	}
+
+	CacheBlock *p_lower_block = find_block_at_level(maddr, level + 1, core);
+	if(p_lower_block)
+	{
+		//the lower level still has it, just merge the dirty data
+		if(dirty)
+		{
+			p_lower_block->m_dirty |= dirty;
+			counters.m_writebacks[level]++;
+			if(m_compressor && level + 2 == m_level)
+			{
+				recompress_llc_block(maddr, core, counters);
+			}
+		}
+		p_lower_block->m_sector_valid |= victim.m_sector_valid;
+		p_lower_block->m_block_in_upper_cache = in_upper;
+		if(coherent && level + 2 == m_level && private_state(maddr, core) == MESI_INVALID)
+		{
+			//the block left the last private level of the core
+			p_lower_block->m_sharers &= ~(1U << core);
+			p_lower_block->m_block_in_upper_cache = p_lower_block->m_sharers != 0;
+		}
+	}
+	else if(m_inclusion[level + 1] == EXCLUSIVE || dirty)
+	{
+		//victim fill: an exclusive level takes every victim, the others only dirty data they do not hold
+		if(dirty)
+		{
+			counters.m_writebacks[level]++;
+		}
+		counters.m_victim_fills[level + 1]++;
+		CacheBlock *p_block = install_block(maddr, level + 1, core, dirty, victim.m_prefetched, in_upper, counters);
+		p_block->m_state = victim.m_state;
+		p_block->m_sector_valid = victim.m_sector_valid | dirty;
+	}
+}
+
+void BlSim::Caches::fit_segments(CacheSet *p_set, CacheBlock *p_keep, uint32_t core, CacheCounters &counters)
+{
+	while(p_set->used_segments() > m_segment_budget)
+	{
+		CacheBlock *p_victim = p_set->find_lru_valid(p_keep);
+		assert(p_victim != NULL);
+
+		CacheBlock victim = *p_victim;
+		p_set->invalidate_block(p_victim);
+		counters.m_compression_evictions++;
+		evict_to_lower(victim, m_level-1, core, counters);
+	}
+}
+
+void BlSim::Caches::recompress_llc_block(uint64_t maddr, uint32_t core, CacheCounters &counters)
+{
+	uint64_t mem_tag;
+	uint32_t set_index;
+
+	get_cache_addr_parts(maddr, &mem_tag, &set_index, m_level-1);
+	CacheSet *p_set = get_set(m_level-1, set_index, core);
+	CacheBlock *p_block = lookup(p_set, m_level-1, mem_tag);
+	if(p_block)
+	{
+		p_block->m_segments = (uint8_t)m_compressor->get_segments(maddr);
+		fit_segments(p_set, p_block, core, counters);
+	}
+}
+
+void BlSim::Caches::set_compressor(LineCompressor *p_compressor)
+{
+	uint32_t level = m_level-1;
+
+	if(m_compressor)
+	{
+		delete m_compressor;
+		m_compressor = NULL;
+	}
+	if(!p_compressor)
+	{
+		return;
+	}
+	if(m_way_partitioned)
+	{
+		cerr<<"The compressed LLC cannot be way partitioned"<<endl;
+		exit(-8);
+	}
+	if(m_block_size[level] / LineCompressor::SEGMENT_BYTES * m_data_ways > 0xffff)
+	{
+		cerr<<"The LLC sets are too big for compression: "<<m_data_ways<<" ways of "<<m_block_size[level]<<" bytes"<<endl;
+		exit(-8);
+	}
+
+	//the same data ways with more tags, the sets start over empty
+	m_compressor = p_compressor;
+	m_segment_budget = m_data_ways * p_compressor->get_block_segments();
+	m_cache_way_count[level] = m_data_ways * COMPRESSED_TAG_FACTOR;
+	alloc_level(level);
+}
+
+void BlSim::Caches::set_access_data(uint32_t offset, const uint8_t *p_data, uint32_t bytes)
+{
+	m_access_data = p_data;
+	m_access_data_offset = offset;
+	m_access_data_bytes = bytes;
+}
+
+void BlSim::Caches::store_data(uint64_t maddr, const uint8_t *p_data, uint32_t bytes)
+{
+	if(m_compressor)
+	{
+		m_compressor->write(maddr, p_data, bytes);
+	}
+}
+
+void BlSim::Caches::set_inclusion(uint32_t level, CacheInclusion inclusion)
+{
+	if(level >= m_level)
+	{
+		cerr<<"Invalid cache level:"<<level<<", the cache has "<<m_level<<" levels"<<endl;
+		exit(-8);
+	}
+	if(m_core_count > 1 && level + 1 == m_level && level > 0 && inclusion != INCLUSIVE)
+	{
+		cerr<<"The LLC keeps the coherence directory of "<<m_core_count<<" cores, it has to be inclusive"<<endl;
+		exit(-8);
+	}
+	m_inclusion[level] = inclusion;
+}
+
+void BlSim::Caches::set_core_count(uint32_t core_count, uint32_t coherence_latency)
+{
+	uint32_t i;
+
+	if(core_count == 0 || core_count > MAX_CORE_COUNT)
+	{
+		cerr<<"Invalid core count:"<<core_count<<", the directory tracks up to "<<MAX_CORE_COUNT<<" cores"<<endl;
+		exit(-8);
+	}
+	if(core_count > 1 && m_level == 1)
+	{
+		cerr<<"Keeping "<<core_count<<" cores coherent needs private levels above the LLC, the cache has only one level"<<endl;
+		exit(-8);
+	}
+	if(core_count > 1 && m_inclusion[m_level-1] != INCLUSIVE)
+	{
+		cerr<<"The LLC keeps the coherence directory of "<<core_count<<" cores, it has to be inclusive"<<endl;
+		exit(-8);
+	}
+
+	m_core_count = core_count;
+	m_coherence_latency = coherence_latency;
+	for(i = 0; i + 1 < m_level; i++)
+	{
+		m_slice_count[i] = core_count;
+		alloc_level(i);
+	}
+}
+
+void BlSim::Caches::set_way_mask(uint32_t core, uint32_t way_mask)
+{
+	uint32_t way_count = m_cache_way_count[m_level-1];
+
+	if(core >= m_core_count || m_core_count == 1)
+	{
+		cerr<<"Invalid core "<<core<<" for a way mask, the LLC is partitioned among "<<m_core_count<<" cores (2 or more)"<<endl;
+		exit(-8);
+	}
+	if(way_count > 32 || way_mask == 0 || (way_count < 32 && (way_mask >> way_count) != 0))
+	{
+		cerr<<"Invalid way mask 0x"<<hex<<way_mask<<dec<<" of core "<<core<<" for a "<<way_count<<"-way LLC"<<endl;
+		exit(-8);
+	}
+	if(m_compressor)
+	{
+		cerr<<"The compressed LLC cannot be way partitioned"<<endl;
+		exit(-8);
+	}
+	m_way_masks[core] = way_mask;
+	m_way_partitioned = true;
+}
+
+void BlSim::Caches::set_way_partitioner(WayPartitioner *p_partitioner)
+{
+	uint32_t c;
+
+	if(m_partitioner)
+	{
+		delete m_partitioner;
+	}
+	m_partitioner = p_partitioner;
+	if(m_partitioner)
+	{
+		for(c = 0; c < m_core_count; c++)
+		{
+			set_way_mask(c, m_partitioner->get_way_mask(c));
+		}
+	}
+}
+
+void BlSim::Caches::set_sector_size(uint32_t sector_bytes)
+{
+	uint32_t i;
+
+	if(sector_bytes == 0)
+	{
+		m_sector_count = 1;
+		m_sector_bits = m_block_low_bits[m_level-1];
+	}
+	else
+	{
+		for(i = 1; i < m_level; i++)
+		{
+			if(m_block_size[i] != m_block_size[0])
+			{
+				cerr<<"Sectored blocks need the same block size at every level"<<endl;
+				exit(-8);
+			}
+		}
+		if((sector_bytes & (sector_bytes - 1)) || sector_bytes > m_block_size[0]
+		   || m_block_size[0] / sector_bytes > MAX_SECTOR_COUNT)
+		{
+			cerr<<"Invalid sector size:"<<sector_bytes<<", it must be a power of two giving at most "
+				<<MAX_SECTOR_COUNT<<" sectors per "<<m_block_size[0]<<" byte block"<<endl;
+			exit(-8);
+		}
+		m_sector_count = m_block_size[0] / sector_bytes;
+		m_sector_bits = FloorLog2(sector_bytes);
+	}
+	m_all_sectors = (uint8_t)((1U << m_sector_count) - 1);
+	m_access_sectors = m_all_sectors;
+}
+
+uint8_t BlSim::Caches::sector_mask(uint32_t offset, uint32_t bytes)
+{
+	uint32_t block_bytes = m_block_size[m_level-1];
+
+	offset &= block_bytes - 1;
+	if(bytes == 0 || offset + bytes > block_bytes)
+	{
+		bytes = bytes == 0 ? block_bytes : block_bytes - offset;
+	}
+	uint32_t first = offset >> m_sector_bits;
+	uint32_t last = (offset + bytes - 1) >> m_sector_bits;
+	return (uint8_t)(((1U << (last + 1)) - 1) & ~((1U << first) - 1));
+}
+
+void BlSim::Caches::set_writeback_queue(bool enable)
+{
+	m_queue_writebacks = enable;
+	m_writeback_queue.clear();
+}
+
+bool BlSim::Caches::get_writeback_request(uint64_t *p_maddr, uint32_t *p_sectors)
+{
+	if(m_writeback_queue.empty())
+	{
+		return false;
+	}
+	*p_maddr = m_writeback_queue.front().first;
+	*p_sectors = __builtin_popcount(m_writeback_queue.front().second);
+	m_writeback_queue.pop_front();
+	return true;
+}
+
+void BlSim::Caches::set_row_writeback(uint64_t column_mask, uint32_t clean_ways)
+{
+	if(column_mask && !m_queue_writebacks)
+	{
+		cerr<<"DRAM-aware writeback needs the LLC writebacks queued (set_writeback_queue)"<<endl;
+		exit(-8);
+	}
+	//the block offset is not part of the row position
+	m_row_column_mask = column_mask & ~(uint64_t)m_block_low_mask[m_level-1];
+	m_clean_ways = clean_ways;
+	m_clean_set = 0;
+}
+
+void BlSim::Caches::clean_block(CacheBlock *p_block, CacheCounters &counters)
+{
+	m_writeback_queue.push_back(std::make_pair(p_block->m_block_addr, p_block->m_dirty));
+	counters.m_writeback_sectors += __builtin_popcount(p_block->m_dirty);
+	counters.m_core_writebacks[p_block->m_owner]++;
+	p_block->m_dirty = 0;
+}
+
+void BlSim::Caches::clean_row(uint64_t maddr, CacheCounters &counters)
+{
+	uint32_t level = m_level - 1;
+	uint64_t block_addr = maddr & ~(uint64_t)m_block_low_mask[level];
+	uint64_t row_base = block_addr & ~m_row_column_mask;
+	uint64_t column = 0;
+
+	//walk every subset of the column bits, i.e. every block of the row
+	do
+	{
+		uint64_t row_mate = row_base | column;
+		if(row_mate != block_addr)
+		{
+			uint64_t mem_tag;
+			uint32_t set_index;
+			get_cache_addr_parts(row_mate, &mem_tag, &set_index, level);
+			CacheSet *p_set = get_set(level, set_index, 0);
+			CacheBlock *p_block = lookup(p_set, level, mem_tag);
+			if(p_block && p_block->m_dirty && p_set->is_near_lru(p_block, m_clean_ways))
+			{
+				clean_block(p_block, counters);
+				counters.m_row_cleans++;
+			}
+		}
+		column = (column - m_row_column_mask) & m_row_column_mask;
+	} while(column != 0);
+}
+
+bool BlSim::Caches::eager_clean()
+{
+	uint32_t level = m_level - 1;
+	uint32_t i;
+
+	if(!m_row_column_mask)
+	{
+		return false;
+	}
+	for(i = 0; i < EAGER_SCAN_SETS && i < m_cache_set_count[level]; i++)
+	{
+		CacheSet *p_set = &m_cache_sets[level][m_clean_set];
+		m_clean_set = (m_clean_set + 1) & m_set_index_mask[level];
+		if(!p_set->is_initialized())
+		{
+			continue;
+		}
+		CacheBlock *p_block = p_set->find_dirty_near_lru(m_clean_ways);
+		if(p_block)
+		{
+			uint64_t maddr = p_block->m_block_addr;
+			clean_block(p_block, m_counters);
+			m_counters.m_eager_cleans++;
+			clean_row(maddr, m_counters);
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlSim::Caches::set_core(uint32_t core)
+{
+	if(m_core_count > 1 && core >= m_core_count)
+	{
+		cerr<<"Access of core "<<core<<", the caches are set up for "<<m_core_count<<" cores"<<endl;
+		exit(-8);
+	}
+	m_current_core = core;
+}
+
+bool BlSim::Caches::access_cache(uint64_t maddr, uint32_t memop)
+{
+	uint64_t fetched_sectors = m_counters.m_fetched_sectors;
+	bool hit = access_levels(maddr, memop, m_current_core, m_access_sectors, m_counters, &m_last_access_level);
+	m_last_fetch_sectors = (uint32_t)(m_counters.m_fetched_sectors - fetched_sectors);
+
+	if(m_compressor && m_access_data)
+	{
+		if(memop == MEM_WRITE)
+		{
+			uint64_t block_addr = (maddr >> m_block_low_bits[0]) << m_block_low_bits[0];
+			m_compressor->write(block_addr + m_access_data_offset, m_access_data, m_access_data_bytes);
+			if(m_level == 1)
+			{
+				//the write landed in the LLC itself, above it the new size shows with the writeback
+				recompress_llc_block(maddr, m_current_core, m_counters);
+			}
+		}
+		m_access_data = NULL;
+	}
+
+	if(m_miss_trace)
+	{
+		trace_access(maddr, memop, m_current_core, hit);
+	}
+	if(m_reuse_profiler)
+	{
+		m_reuse_profiler->access(maddr);
+	}
+	if(m_stack_simulator)
+	{
+		m_stack_simulator->access(maddr, memop == MEM_WRITE);
+	}
+	if(m_partitioner && (!hit || m_last_access_level == m_level-1)
+	   && m_partitioner->access(m_current_core, maddr))
+	{
+		//new epoch, new allocation; blocks outside the new ways stay until they are replaced
+		for(uint32_t c = 0; c < m_core_count; c++)
+		{
+			m_way_masks[c] = m_partitioner->get_way_mask(c);
+		}
+	}
+
+	if(m_prefetcher && hit && m_last_access_level == m_level-1)
+	{
+		//hit in the LLC, a prefetched block is useful on its first demand;
+		//an exclusive LLC has handed the block up to the first level already
+		CacheBlock *p_llc_block = m_inclusion[m_level-1] == EXCLUSIVE ? find_block_at_level(maddr, 0, m_current_core)
+		                                                              : find_block_in_LLC(maddr);
+		bool prefetch_hit = p_llc_block->m_prefetched != 0;
+		if(prefetch_hit)
+		{
+			m_prefetcher->m_useful++;
+			p_llc_block->m_prefetched = 0;
+		}
+		prefetch_access(maddr, false, prefetch_hit);
+	}
+	else if(m_prefetcher && !hit)
+	{
+		uint64_t block_addr = (maddr >> m_block_low_bits[m_level-1]) << m_block_low_bits[m_level-1];
+		if(prefetch_pending(block_addr))
+		{
+			//the prefetch was sent but did not come back in time
+			m_prefetcher->m_late++;
+		}
+		else
+		{
+			m_prefetcher->m_demand_misses++;
+		}
+		m_prefetcher->fill(block_addr, false);
+		prefetch_access(maddr, true, false);
+	}
+	return hit;
+}
+
+bool BlSim::Caches::access_cache(uint64_t maddr, uint32_t memop, uint64_t now, uint64_t *p_ready_cycle)
+{
+	uint64_t messages = m_counters.m_invalidations + m_counters.m_downgrades;
+	bool hit = access_cache(maddr, memop);
+	uint32_t last_level = hit ? m_last_access_level : m_level - 1;
+	uint64_t cycle = now;
+	uint32_t i;
+
+	//walk the levels the access looked up: wait for a free port, then the tag lookup,
+	//plus the data array read at the level that hit
+	for(i = 0; i <= last_level; i++)
+	{
+		std::vector<uint64_t> &ports = m_port_free_cycle[i];
+		uint32_t port = 0;
+		uint32_t p;
+		for(p = 1; p < ports.size(); p++)
+		{
+			if(ports[p] < ports[port])
+			{
+				port = p;
+			}
+		}
+
+		if(ports[port] > cycle)
+		{
+			m_port_stall_cycles[i] += ports[port] - cycle;
+			cycle = ports[port];
+		}
+		//pipelined: the port takes the next lookup a cycle later
+		ports[port] = cycle + 1;
+		cycle += m_tag_latency[i];
+		m_lookup_done[i].insert(cycle);
+
+		if(hit && i == last_level)
+		{
+			cycle += m_data_latency[i];
+		}
+	}
+
+	if(hit && m_compressor && last_level == m_level-1)
+	{
+		CacheBlock *p_llc_block = find_block_in_LLC(maddr);
+		if(p_llc_block && p_llc_block->m_segments < m_compressor->get_block_segments())
+		{
+			cycle += m_compressor->get_decompression_latency();
+			m_counters.m_decompressions++;
+		}
+	}
+
+	if(m_counters.m_invalidations + m_counters.m_downgrades != messages)
+	{
+		//the other cores answer in parallel, one round trip from the directory
+		cycle += m_coherence_latency;
+	}
+
+	*p_ready_cycle = cycle;
+	return hit;
+}
+
+bool BlSim::Caches::port_available(uint64_t now)
+{
+	//a miss looks up every level, each after the tag lookups above it
+	uint64_t arrival = now;
+	for(uint32_t i = 0; i < m_level; i++)
+	{
+		std::multiset<uint64_t> &lookups = m_lookup_done[i];
+		lookups.erase(lookups.begin(), lookups.upper_bound(now));
+
+		std::vector<uint64_t> &ports = m_port_free_cycle[i];
+		bool port_free = false;
+		for(uint32_t p = 0; p < ports.size(); p++)
+		{
+			if(ports[p] <= arrival)
+			{
+				port_free = true;
+				break;
+			}
+		}
+		//the lookups still in the tag array when it gets there
+		uint64_t outstanding = std::distance(lookups.upper_bound(arrival), lookups.end());
+		if(!port_free || outstanding >= (uint64_t)m_port_count[i] * std::max(m_tag_latency[i], 1u))
+		{
+			m_port_stall_cycles[i]++;
+			return false;
+		}
+		arrival += m_tag_latency[i];
+	}
+	return true;
+}
+
+void BlSim::Caches::reset_ports(uint32_t level)
+{
+	m_port_free_cycle[level].assign(m_port_count[level], 0);
+	m_lookup_done[level].clear();
+}
+
+void BlSim::Caches::set_level_timing(uint32_t level, uint32_t tag_latency, uint32_t data_latency, uint32_t port_count)
+{
+	if(level >= m_level)
+	{
+		cerr<<"Invalid cache level:"<<level<<" for timing, there are "<<m_level<<" levels"<<endl;
+		exit(-8);
+	}
+	if(port_count == 0)
+	{
+		cerr<<"Cache level "<<level<<" needs at least one port"<<endl;
+		exit(-8);
+	}
+
+	m_tag_latency[level] = tag_latency;
+	m_data_latency[level] = data_latency;
+	m_port_count[level] = port_count;
+	reset_ports(level);
+}
+
+void BlSim::Caches::set_levels(uint32_t level_count, const uint64_t *capacities, const uint32_t *way_counts)
+{
+	uint32_t i;
+
+	if(level_count == 0 || level_count > MAX_CACHE_LEVEL)
+	{
+		cerr<<"Invalid cache level:"<<level_count<<", max cache level is "<<MAX_CACHE_LEVEL<<endl;
+		exit(-8);
+	}
+	for(i = 0; i < level_count; i++)
+	{
+		//the sets keep an lru list, CacheSet::init needs two ways at least
+		if(way_counts[i] < 2 || way_counts[i] >= INVALID_WAY)
+		{
+			cerr<<"Invalid cache level "<<i<<": "<<way_counts[i]<<" ways, a level needs 2 to "<<INVALID_WAY-1<<" ways"<<endl;
+			exit(-8);
+		}
+		uint64_t set_capacity = (uint64_t)m_block_size[0] * way_counts[i];
+		uint64_t set_count = set_capacity ? capacities[i] / set_capacity : 0;
+		if(set_count == 0 || set_count * set_capacity != capacities[i] || (set_count & (set_count - 1)))
+		{
+			cerr<<"Invalid cache level "<<i<<": "<<capacities[i]<<" bytes in "<<way_counts[i]
+				<<" ways of "<<m_block_size[0]<<" byte blocks is not a power of two number of sets"<<endl;
+			exit(-8);
+		}
+	}
+
+	for(i = 0; i < m_level; i++)
+	{
+		free_slab(m_cache_sets[i], m_set_slab_bytes[i]);
+		free_slab(m_cache_blocks[i], m_block_slab_bytes[i]);
+		m_cache_sets[i] = NULL;
+		m_cache_blocks[i] = NULL;
+		m_set_slab_bytes[i] = 0;
+		m_block_slab_bytes[i] = 0;
 	}
 
-#ifdef DEBUG_CACHE_SIMULATOR
-    	//cout<<"## After Cache replaced"<<endl;
-#endif
-
+	m_level = level_count;
+	for(i = 0; i < m_level; i++)
+	{
+		//levels past the built-in three take the timing of the third
+		if(i >= 3)
+		{
+			m_tag_latency[i] = m_tag_latency[2];
+			m_data_latency[i] = m_data_latency[2];
+			m_port_count[i] = m_port_count[2];
+		}
+		m_block_size[i] = m_block_size[0];
+		m_cache_capacity[i] = capacities[i];
+		m_cache_way_count[i] = way_counts[i];
+		m_cache_set_capacity[i] = m_block_size[i] * m_cache_way_count[i];
+		m_cache_set_count[i] = m_cache_capacity[i] / m_cache_set_capacity[i];
+		reset_ports(i);
+		m_port_stall_cycles[i] = 0;
+
+		m_block_low_bits[i] = FloorLog2(m_block_size[i]);
+		m_set_index_bits[i] = FloorLog2(m_cache_set_count[i]);
+		m_block_low_mask[i] = (1UL << m_block_low_bits[i]) - 1;
+		m_set_index_mask[i] = (1UL << m_set_index_bits[i]) - 1;
+		m_slice_count[i] = 1;
+		alloc_level(i);
+	}
 
-	assert(access_cache_sets[0]->get_mru_block()->m_block_tag == mtags[0]);
-	access_cache_sets[0]->get_mru_block()->hit_access(memop);
-	return hit;
+	m_last_access_level = m_level;
+	m_sector_bits = m_block_low_bits[m_level-1];
+	m_data_ways = m_cache_way_count[m_level-1];
 }
 
-void BlSim::Caches::cache_replaced(CacheSet *p_lower_set, 
-                                     CacheSet *p_upper_set,
-                                     uint32_t lower_level,
-                                     uint64_t upper_mtag,
-                                     uint64_t maddr)
+void BlSim::Caches::trace_access(uint64_t maddr, uint32_t memop, uint32_t core, bool hit)
 {
-	CacheBlock *p_evicted_block;
-	CacheSet *p_wb_set;
-	CacheBlock *p_wb_block;
-
-	CacheBlock *p_new_mru_block;	
-
-	uint64_t wb_maddr;
-	uint64_t wb_mem_tag;
-    	uint32_t wb_set_index;
-
-    	assert(lower_level >= 1 && lower_level < m_level);
-
-#ifdef DEBUG_CACHE_SIMULATOR
-     //cout<<"## Evicted lru at level "<<lower_level-1<<endl;
-#endif
-
-	p_evicted_block = p_upper_set->evict_lru_block();
-    	assert(p_evicted_block);
-	wb_maddr = p_evicted_block->m_block_addr;
-
-
-	if(wb_maddr != INVALID_BLOCK)
+	if(hit)
 	{
-		//we only write back the block with valid addr and tag,
-		//Attention: we can not use the cache tag form upper set, cause it is different with the lower set
-		//Thus, we need to recalculate the tag
-        	get_cache_addr_parts(wb_maddr, &wb_mem_tag, &wb_set_index, lower_level);
-
-		p_wb_set = m_cache_sets[lower_level][wb_set_index];
-        	p_wb_block = p_wb_set->find_block(wb_mem_tag);
+		m_trace_gap++;
+		return;
+	}
+	m_miss_trace->add(maddr, memop, core, m_trace_gap);
+	m_trace_gap = 0;
+}
 
-		assert(p_wb_block != NULL);
-		assert(p_evicted_block->m_parent_block_in_lower->m_block_tag == p_wb_block->m_block_tag);
+void BlSim::Caches::set_miss_trace(MissTraceWriter *p_writer)
+{
+	close_miss_trace();
+	m_miss_trace = p_writer;
+	m_trace_gap = 0;
+}
 
-		//write back the access distribution into the lower wb cache block
-		p_wb_block->get_data_from_evicted(p_evicted_block);
+void BlSim::Caches::close_miss_trace()
+{
+	if(m_miss_trace)
+	{
+		m_miss_trace->print_statistic();
+		delete m_miss_trace;
+		m_miss_trace = NULL;
 	}
+}
 
-	
-	//Now load the new block into upper set mru position
-	p_new_mru_block = p_lower_set->get_mru_block();
-	
-	p_evicted_block->m_block_addr = maddr;
-	p_evicted_block->m_block_tag = upper_mtag;
-	
-	p_new_mru_block->push_data_into_upper_block(p_evicted_block);
+void BlSim::Caches::set_reuse_profiler(ReuseProfiler *p_profiler)
+{
+	if(m_reuse_profiler)
+	{
+		delete m_reuse_profiler;
+	}
+	m_reuse_profiler = p_profiler;
+}
 
-	//Finally, put this new block into the mru position of the upper cache
-	p_upper_set->put_accessed_block_in_mru(p_evicted_block);	
+void BlSim::Caches::set_stack_simulator(StackSimulator *p_simulator)
+{
+	if(m_stack_simulator)
+	{
+		delete m_stack_simulator;
+	}
+	m_stack_simulator = p_simulator;
 }
 
 void BlSim::Caches::get_cache_addr_parts(uint64_t maddr, uint64_t *mem_tag, uint32_t *set_index, uint32_t level)
@@ -613,16 +1907,414 @@ void BlSim::Caches::get_cache_addr_parts(uint64_t maddr, uint64_t *mem_tag, uint
 
 }
 
+void BlSim::Caches::CacheCounters::reset()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+void BlSim::Caches::CacheCounters::add(const CacheCounters &other)
+{
+	uint32_t i;
+	for(i = 0; i < MAX_CACHE_LEVEL; i++)
+	{
+		m_mem_reads[i] += other.m_mem_reads[i];
+		m_mem_reads_hit[i] += other.m_mem_reads_hit[i];
+		m_mem_reads_miss[i] += other.m_mem_reads_miss[i];
+		m_mem_writes[i] += other.m_mem_writes[i];
+		m_mem_writes_hit[i] += other.m_mem_writes_hit[i];
+		m_mem_writes_miss[i] += other.m_mem_writes_miss[i];
+		m_writebacks[i] += other.m_writebacks[i];
+		m_victim_fills[i] += other.m_victim_fills[i];
+		m_inclusion_victims[i] += other.m_inclusion_victims[i];
+		m_sector_misses[i] += other.m_sector_misses[i];
+	}
+	for(i = 0; i < MAX_CORE_COUNT; i++)
+	{
+		m_core_misses[i] += other.m_core_misses[i];
+		m_core_writebacks[i] += other.m_core_writebacks[i];
+	}
+	m_fetches += other.m_fetches;
+	m_fetched_sectors += other.m_fetched_sectors;
+	m_writeback_sectors += other.m_writeback_sectors;
+	m_row_cleans += other.m_row_cleans;
+	m_eager_cleans += other.m_eager_cleans;
+	m_llc_fills += other.m_llc_fills;
+	m_fill_segments += other.m_fill_segments;
+	m_compression_evictions += other.m_compression_evictions;
+	m_decompressions += other.m_decompressions;
+	m_upgrades += other.m_upgrades;
+	m_invalidations += other.m_invalidations;
+	m_downgrades += other.m_downgrades;
+	m_coherence_writebacks += other.m_coherence_writebacks;
+	m_coherence_misses += other.m_coherence_misses;
+	m_hit_count += other.m_hit_count;
+	m_miss_count += other.m_miss_count;
+	m_total_count += other.m_total_count;
+}
+
+void BlSim::Caches::set_thread_count(uint32_t thread_count)
+{
+	uint32_t i;
+	uint32_t min_set_count = m_cache_set_count[0];
+
+	if(thread_count == 0)
+	{
+		thread_count = 1;
+	}
+
+	//shards must not share a set at any level, so split on the set index bits common to all levels;
+	//with equal block sizes those are the index bits of the level with the fewest sets
+	for(i = 1; i < m_level; i++)
+	{
+		if(m_block_size[i] != m_block_size[0])
+		{
+			cerr<<"WARNING: cache levels have different block sizes, batch access runs on one thread"<<endl;
+			thread_count = 1;
+		}
+		if(m_cache_set_count[i] < min_set_count)
+		{
+			min_set_count = m_cache_set_count[i];
+		}
+	}
+	if(thread_count > min_set_count)
+	{
+		thread_count = min_set_count;
+	}
+	m_shard_set_mask = min_set_count - 1;
+
+	if(m_shard_pool)
+	{
+		delete m_shard_pool;
+		m_shard_pool = NULL;
+	}
+	m_thread_count = thread_count;
+	if(m_thread_count > 1)
+	{
+		m_shard_pool = new ShardPool(m_thread_count, run_shard, this);
+	}
+	m_shard_counters.resize(m_thread_count);
+}
+
+uint32_t BlSim::Caches::get_shard(uint64_t maddr)
+{
+	return (uint32_t)(((maddr >> m_block_low_bits[0]) & m_shard_set_mask) % m_thread_count);
+}
+
+void BlSim::Caches::run_shard(void *p_caches, uint32_t shard)
+{
+	((Caches *)p_caches)->access_shard(shard);
+}
+
+void BlSim::Caches::access_shard(uint32_t shard)
+{
+	CacheCounters &counters = m_shard_counters[shard];
+	uint32_t level;
+	size_t i;
+
+	for(i = m_shard_begin[shard]; i < m_shard_begin[shard+1]; i++)
+	{
+		size_t index = m_batch_order[i];
+		uint32_t core = m_batch_cores ? m_batch_cores[index] : m_current_core;
+		uint8_t sectors = m_batch_sectors ? m_batch_sectors[index] : m_all_sectors;
+		bool hit = access_levels(m_batch_maddrs[index], m_batch_mem_rws[index], core, sectors, counters, &level);
+		if(m_batch_hits)
+		{
+			m_batch_hits[index] = hit;
+		}
+	}
+}
+
+void BlSim::Caches::access_cache_batch(const uint64_t *maddrs, const uint32_t *mem_rws, const uint32_t *cores,
+                                      const uint8_t *sectors, size_t count, bool *hits)
+{
+	uint32_t level;
+	size_t i;
+
+	//the profilers need the accesses in trace order, run them before the batch is split
+	if(m_reuse_profiler)
+	{
+		for(i = 0; i < count; i++)
+		{
+			m_reuse_profiler->access(maddrs[i]);
+		}
+	}
+	if(m_stack_simulator)
+	{
+		for(i = 0; i < count; i++)
+		{
+			m_stack_simulator->access(maddrs[i], mem_rws[i] == MEM_WRITE);
+		}
+	}
+
+	//the miss trace is written in batch order once the batch is done, it needs the hit flags
+	bool *p_own_hits = NULL;
+	if(m_miss_trace && hits == NULL)
+	{
+		p_own_hits = new bool[count];
+		hits = p_own_hits;
+	}
+
+	//a warmup has no memory side to write back to
+	bool queue_writebacks = m_queue_writebacks;
+	m_queue_writebacks = false;
+
+	if(m_thread_count <= 1)
+	{
+		for(i = 0; i < count; i++)
+		{
+			bool hit = access_levels(maddrs[i], mem_rws[i], cores ? cores[i] : m_current_core,
+			                         sectors ? sectors[i] : m_all_sectors, m_counters, &level);
+			if(hits)
+			{
+				hits[i] = hit;
+			}
+		}
+	}
+	else
+	{
+		access_batch_sharded(maddrs, mem_rws, cores, sectors, count, hits);
+	}
+	m_queue_writebacks = queue_writebacks;
+
+	if(m_miss_trace)
+	{
+		for(i = 0; i < count; i++)
+		{
+			trace_access(maddrs[i], mem_rws[i], cores ? cores[i] : m_current_core, hits[i]);
+		}
+	}
+	if(p_own_hits)
+	{
+		delete []p_own_hits;
+	}
+}
+
+void BlSim::Caches::access_batch_sharded(const uint64_t *maddrs, const uint32_t *mem_rws, const uint32_t *cores,
+                                        const uint8_t *sectors, size_t count, bool *hits)
+{
+	uint32_t shard;
+	size_t i;
+
+	//stable counting sort of the batch indexes by shard
+	m_shard_begin.assign(m_thread_count + 1, 0);
+	for(i = 0; i < count; i++)
+	{
+		m_shard_begin[get_shard(maddrs[i]) + 1]++;
+	}
+	for(shard = 0; shard < m_thread_count; shard++)
+	{
+		m_shard_begin[shard + 1] += m_shard_begin[shard];
+	}
+	std::vector<size_t> next(m_shard_begin.begin(), m_shard_begin.end() - 1);
+	m_batch_order.resize(count);
+	for(i = 0; i < count; i++)
+	{
+		m_batch_order[next[get_shard(maddrs[i])]++] = i;
+	}
+
+	m_batch_maddrs = maddrs;
+	m_batch_mem_rws = mem_rws;
+	m_batch_cores = cores;
+	m_batch_sectors = sectors;
+	m_batch_hits = hits;
+	for(shard = 0; shard < m_thread_count; shard++)
+	{
+		m_shard_counters[shard].reset();
+	}
+
+	m_shard_pool->run();
+
+	for(shard = 0; shard < m_thread_count; shard++)
+	{
+		m_counters.add(m_shard_counters[shard]);
+	}
+	m_batch_maddrs = NULL;
+	m_batch_mem_rws = NULL;
+	m_batch_cores = NULL;
+	m_batch_sectors = NULL;
+	m_batch_hits = NULL;
+}
+
+void BlSim::Caches::reset_statistic()
+{
+	uint32_t i;
+	uint32_t j;
+
+	m_counters.reset();
+	if(m_compressor)
+	{
+		m_compressor->reset_statistic();
+	}
+	for(i = 0; i < m_level; i++)
+	{
+		m_port_stall_cycles[i] = 0;
+		for(j = 0; j < m_cache_set_count[i] * m_slice_count[i]; j++)
+		{
+			if(m_cache_sets[i][j].is_initialized())
+			{
+				m_cache_sets[i][j].m_evicted_count = 0;
+				m_cache_sets[i][j].m_evicted_unused_prefetch = 0;
+				m_cache_sets[i][j].m_capacity_hits = 0;
+			}
+		}
+	}
+}
+
 void BlSim::Caches::dump_statistic()
 {
-	float hit_rate = (float)(m_hit_count) / m_total_count;
+	float hit_rate = (float)(m_counters.m_hit_count) / m_counters.m_total_count;
+	uint64_t evicted_LLC_count = 0;
+	uint64_t evicted_unused_prefetch_count = 0;
+	uint32_t j;
+
+	for(j = 0; j < m_cache_set_count[m_level-1]; j++)
+	{
+		//untouched sets read as zero
+		evicted_LLC_count += m_cache_sets[m_level-1][j].m_evicted_count;
+		evicted_unused_prefetch_count += m_cache_sets[m_level-1][j].m_evicted_unused_prefetch;
+	}
 
-	cout << "hit: " << m_hit_count
-		<< " miss: " << m_miss_count
-		<< "\t total: " << m_total_count
+	cout << "hit: " << m_counters.m_hit_count
+		<< " miss: " << m_counters.m_miss_count
+		<< "\t total: " << m_counters.m_total_count
  	      << "\t hit rate: " << hit_rate
  	      << "\t evicted LLC count: " << evicted_LLC_count << endl;
 
+	static const char *inclusion_names[] = {"inclusive", "nine", "exclusive"};
+	for(uint32_t i = 0; i < m_level; i++)
+	{
+		cout << "level " << i << " timing: tag " << m_tag_latency[i]
+			<< "\t data " << m_data_latency[i]
+			<< "\t ports " << m_port_count[i]
+			<< "\t port stall cycles: " << m_port_stall_cycles[i] << endl;
+		cout << "level " << i << " (" << (i == 0 ? "first" : inclusion_names[m_inclusion[i]]) << ")"
+			<< ": writebacks: " << m_counters.m_writebacks[i]
+			<< "\t victim fills: " << m_counters.m_victim_fills[i]
+			<< "\t inclusion victims: " << m_counters.m_inclusion_victims[i] << endl;
+	}
+	if(m_core_count > 1)
+	{
+		cout << "coherence (" << m_core_count << " cores): upgrades: " << m_counters.m_upgrades
+			<< "\t invalidations: " << m_counters.m_invalidations
+			<< "\t downgrades: " << m_counters.m_downgrades
+			<< "\t coherence writebacks: " << m_counters.m_coherence_writebacks
+			<< "\t coherence misses: " << m_counters.m_coherence_misses << endl;
+	}
+	if(m_core_count > 1)
+	{
+		//blocks each core filled and still holds in the LLC
+		uint32_t level = m_level - 1;
+		uint32_t way_count = m_cache_way_count[level];
+		uint32_t all_ways = way_count < 32 ? (1U << way_count) - 1 : ALL_WAYS;
+		uint64_t occupancy[MAX_CORE_COUNT] = {0};
+		uint64_t valid_blocks = 0;
+		for(j = 0; j < m_cache_set_count[level]; j++)
+		{
+			if(!m_cache_sets[level][j].is_initialized())
+			{
+				continue;
+			}
+			for(uint32_t w = 0; w < way_count; w++)
+			{
+				CacheBlock *p_block = &m_cache_blocks[level][(size_t)j * way_count + w];
+				if(!p_block->is_invalid_cache())
+				{
+					occupancy[p_block->m_owner]++;
+					valid_blocks++;
+				}
+			}
+		}
+
+		cout << "LLC per core (" << (m_partitioner ? "ucp" : m_way_partitioned ? "way masks" : "shared") << "):" << endl;
+		for(uint32_t c = 0; c < m_core_count; c++)
+		{
+			cout << "    core " << c << ": way mask: 0x" << hex << (m_way_masks[c] & all_ways)
+				<< dec << "\t occupancy: " << occupancy[c] << " blocks ("
+				<< (valid_blocks ? (float)occupancy[c] / valid_blocks : 0) << ")"
+				<< "\t DRAM reads: " << m_counters.m_core_misses[c]
+				<< "\t DRAM writebacks: " << m_counters.m_core_writebacks[c] << endl;
+		}
+	}
+	if(m_partitioner)
+	{
+		m_partitioner->print_statistic();
+	}
+	if(m_sector_count > 1)
+	{
+		uint64_t line_sectors = m_counters.m_fetches * m_sector_count;
+		uint64_t dirty_lines = (m_counters.m_writebacks[m_level-1] + m_counters.m_row_cleans + m_counters.m_eager_cleans)
+		                       * m_sector_count;
+		cout << "sectors (" << m_sector_count << " per block): sector misses:";
+		for(uint32_t i = 0; i < m_level; i++)
+		{
+			cout << " " << m_counters.m_sector_misses[i];
+		}
+		cout << "\t fetched: " << m_counters.m_fetched_sectors << " of " << line_sectors
+			<< " (" << (line_sectors ? (float)m_counters.m_fetched_sectors / line_sectors : 0) << ")"
+			<< "\t written back: " << m_counters.m_writeback_sectors << " of " << dirty_lines
+			<< " (" << (dirty_lines ? (float)m_counters.m_writeback_sectors / dirty_lines : 0) << ")" << endl;
+	}
+	if(m_row_column_mask)
+	{
+		cout << "DRAM-aware writeback: dirty victims: " << m_counters.m_writebacks[m_level-1]
+			<< "\t row cleans: " << m_counters.m_row_cleans
+			<< "\t eager cleans: " << m_counters.m_eager_cleans
+			<< "\t clean ways: " << m_clean_ways << endl;
+	}
+	if(m_compressor)
+	{
+		//what the LLC holds now against what its data ways hold uncompressed
+		uint32_t level = m_level - 1;
+		uint32_t way_count = m_cache_way_count[level];
+		uint64_t valid_blocks = 0;
+		uint64_t used_segments = 0;
+		uint64_t capacity_hits = 0;
+		for(j = 0; j < m_cache_set_count[level]; j++)
+		{
+			if(!m_cache_sets[level][j].is_initialized())
+			{
+				continue;
+			}
+			capacity_hits += m_cache_sets[level][j].m_capacity_hits;
+			for(uint32_t w = 0; w < way_count; w++)
+			{
+				CacheBlock *p_block = &m_cache_blocks[level][(size_t)j * way_count + w];
+				if(!p_block->is_invalid_cache())
+				{
+					valid_blocks++;
+					used_segments += p_block->m_segments;
+				}
+			}
+		}
+
+		uint64_t data_blocks = (uint64_t)m_cache_set_count[level] * m_data_ways;
+		cout << "compressed LLC (" << m_data_ways << " data ways, " << way_count << " tags): blocks: " << valid_blocks
+			<< "\t effective capacity: " << (data_blocks ? (float)valid_blocks / data_blocks : 0)
+			<< "\t compression ratio: "
+			<< (used_segments ? (float)valid_blocks * m_compressor->get_block_segments() / used_segments : 0)
+			<< "\t fill size: " << (m_counters.m_llc_fills ? (float)m_counters.m_fill_segments / m_counters.m_llc_fills : 0)
+			<< " segments" << endl;
+		cout << "    capacity hits: " << capacity_hits
+			<< "\t DRAM read bytes saved: " << capacity_hits * m_block_size[level]
+			<< "\t data victims: " << m_counters.m_compression_evictions
+			<< "\t decompressions: " << m_counters.m_decompressions << endl;
+		m_compressor->print_statistic();
+	}
+
+	if(m_prefetcher)
+	{
+		m_prefetcher->m_useless = evicted_unused_prefetch_count;
+		m_prefetcher->print_statistic();
+	}
+	if(m_reuse_profiler)
+	{
+		m_reuse_profiler->print_statistic();
+	}
+	if(m_stack_simulator)
+	{
+		m_stack_simulator->print_statistic();
+	}
+
 }
 
 
@@ -640,6 +2332,133 @@ bool BlSim::Caches::writebackornot()
 	
 }
 
+BlSim::CacheBlock* BlSim::Caches::find_block_in_LLC(uint64_t maddr)
+{
+	return find_block_at_level(maddr, m_level-1, 0);
+}
+
+BlSim::CacheBlock* BlSim::Caches::find_block_at_level(uint64_t maddr, uint32_t level, uint32_t core)
+{
+	uint64_t mem_tag;
+	uint32_t set_index;
+
+	get_cache_addr_parts(maddr, &mem_tag, &set_index, level);
+	return lookup(get_set(level, set_index, core), level, mem_tag);
+}
+
+void BlSim::Caches::prefetch_access(uint64_t maddr, bool miss, bool prefetch_hit)
+{
+	uint32_t bits = m_block_low_bits[m_level-1];
+	std::vector<uint64_t> candidates;
+	uint32_t i;
+
+	m_prefetcher->access((maddr >> bits) << bits, miss, prefetch_hit, candidates);
+
+	for(i = 0; i < candidates.size(); i++)
+	{
+		uint64_t block_addr = candidates[i];
+		bool queued = false;
+		for(size_t j = 0; j < m_prefetch_queue.size(); j++)
+		{
+			if(m_prefetch_queue[j].first == block_addr)
+			{
+				queued = true;
+				break;
+			}
+		}
+
+		if(queued || prefetch_pending(block_addr) || find_block_in_LLC(block_addr)
+		   || m_prefetch_queue.size() >= PREFETCH_QUEUE_DEPTH)
+		{
+			m_prefetcher->m_dropped++;
+			continue;
+		}
+		m_prefetch_queue.push_back(std::make_pair(block_addr, m_current_core));
+	}
+}
+
+void BlSim::Caches::set_prefetcher(Prefetcher *p_prefetcher)
+{
+	if(m_prefetcher)
+	{
+		delete m_prefetcher;
+	}
+	m_prefetcher = p_prefetcher;
+}
+
+bool BlSim::Caches::get_prefetch_request(uint64_t *p_maddr, uint32_t *p_core)
+{
+	while(!m_prefetch_queue.empty())
+	{
+		uint64_t block_addr = m_prefetch_queue.front().first;
+		uint32_t core = m_prefetch_queue.front().second;
+		m_prefetch_queue.pop_front();
+
+		//a demand miss may have brought the block in while it was queued
+		if(find_block_in_LLC(block_addr))
+		{
+			m_prefetcher->m_dropped++;
+			continue;
+		}
+		*p_maddr = block_addr;
+		*p_core = core;
+		return true;
+	}
+	return false;
+}
+
+void BlSim::Caches::prefetch_issued(uint64_t maddr, uint32_t core)
+{
+	m_prefetch_inflight[maddr] = core;
+	m_prefetcher->m_issued++;
+}
+
+void BlSim::Caches::prefetch_dropped(uint64_t /*maddr*/)
+{
+	m_prefetcher->m_dropped++;
+}
+
+bool BlSim::Caches::prefetch_pending(uint64_t maddr)
+{
+	if(m_prefetch_inflight.empty())
+	{
+		return false;
+	}
+	uint32_t bits = m_block_low_bits[m_level-1];
+	return m_prefetch_inflight.count((maddr >> bits) << bits) != 0;
+}
+
+bool BlSim::Caches::prefetch_fill(uint64_t maddr)
+{
+	uint32_t bits = m_block_low_bits[m_level-1];
+	uint64_t block_addr = (maddr >> bits) << bits;
+	bool cached = false;
+	uint32_t i;
+
+	std::map<uint64_t, uint32_t>::iterator it = m_prefetch_inflight.find(block_addr);
+	if(it == m_prefetch_inflight.end())
+	{
+		return false;
+	}
+	uint32_t core = it->second;
+	m_prefetch_inflight.erase(it);
+
+	//the block may be cached already if a demand miss got there first,
+	//above an exclusive LLC that can be in any level (only of one core, several need an inclusive LLC)
+	for(i = 0; i < m_level && !cached; i++)
+	{
+		cached = find_block_at_level(block_addr, i, core) != NULL;
+	}
+	if(!cached)
+	{
+		//prefetched blocks go to the LLC only, as the block of the core that asked for them
+		install_block(block_addr, m_level-1, core, 0, 1, 0, m_counters);
+		m_prefetcher->m_filled++;
+		m_prefetcher->fill(block_addr, true);
+	}
+	return true;
+}
+
 void BlSim::Caches::print_cache_config()
 {
 	uint32_t i;
@@ -665,12 +2484,12 @@ void BlSim::Caches::print_cache_config()
 	cout<<endl<<endl<<"Cache Sets status:"<<endl;
 	for(i = 0; i < m_level; i++)
         {
-                for(j = 0; j < m_cache_set_count[i]; j++)
+                for(j = 0; j < m_cache_set_count[i] * m_slice_count[i]; j++)
                 {
-                        if(m_cache_sets[i][j])
+                        if(m_cache_sets[i][j].is_initialized())
                         {
 				cout<<"Cache Level "<<i<<", Set "<<j<<": ";
-                                m_cache_sets[i][j]->print_cache_set();
+                                m_cache_sets[i][j].print_cache_set();
                         }
                 }
                 
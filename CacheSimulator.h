@@ -7,6 +7,21 @@
 
 #define INVALID_SUB_BLOCK_DIS 65
 
+#define INVALID_WAY 0xffff
+
+#define ALL_WAYS 0xffffffffU
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include "Prefetcher.h"
+#include "ReuseProfiler.h"
+#include "StackSimulator.h"
+#include "MissTrace.h"
+#include "WayPartitioner.h"
+#include "Compressor.h"
+
 namespace BlSim
 {
     typedef unsigned int uint32_t;
@@ -35,6 +50,21 @@ namespace BlSim
         MEM_WRITE = 0,
         MEM_READ
     };
+
+    //how a cache level holds the blocks of the levels above it
+    enum CacheInclusion {
+        INCLUSIVE = 0,  //holds every upper block, its victims are back-invalidated upstream
+        NINE,           //non-inclusive non-exclusive: filled on misses, evicts without touching the upper levels
+        EXCLUSIVE       //only holds upper victims, hands a block up on a hit
+    };
+
+    //MESI state of a block in the private levels of a core; every valid LLC block reads as exclusive
+    enum CoherenceState {
+        MESI_INVALID = 0,  //a coherence invalidation keeps the tag, so the next miss on it counts as a coherence miss
+        MESI_SHARED,
+        MESI_EXCLUSIVE,
+        MESI_MODIFIED
+    };
     /*
 
        class Transaction {
@@ -52,31 +82,33 @@ namespace BlSim
        Type m_type;
        };*/
 
+    //blocks live in a per-level slab (see Caches), so keep them small: the block size is a
+    //per-level setting and the lru links are way indexes inside the set
     class CacheBlock
     {
         public:
-            uint32_t m_block_size; //it is usual 64B
             uint64_t m_block_addr; //it is full addr, do not filter for it
             uint64_t m_block_tag;  //filter the inner-set addr and the set index
-            uint32_t m_block_in_upper_cache;
-
 
+            uint16_t m_next_lru;   //way index, INVALID_WAY at the lru end
+            uint16_t m_prev_lru;   //way index, INVALID_WAY at the mru end
 
+            uint8_t m_block_in_upper_cache;
+            uint8_t m_dirty; //the written sectors, bit 0 only when blocks are not sectored
+            uint8_t m_prefetched; //brought in by the prefetcher and not demanded yet
+            uint8_t m_state;      //CoherenceState
+            uint8_t m_sector_valid; //sectors present in this level
+            uint8_t m_owner;      //core whose access filled the block
+            uint8_t m_segments;   //data segments the block takes in a compressed LLC
 
-            uint32_t m_dirty; //to mark if this block is written
-        public:
-            class CacheBlock* m_next_lru;
-            class CacheBlock* m_prev_lru;
-
-            //Add this to quick find its parent block in the lower level cache, Inclusive
-            class CacheBlock *m_parent_block_in_lower;
+            uint32_t m_sharers;   //LLC directory: cores whose private levels may hold the block
 
         public:
-            CacheBlock(uint32_t block_size);
+            void invalidate();
 
             void Replaced(uint32_t block_addr);  //Note: this only for lru cache block
 
-            void hit_access(uint32_t mem_rw);
+            void hit_access(uint32_t mem_rw, uint8_t sectors);
             void print_cache_block();
             void reset_block_access_distribution();
             void get_data_from_evicted(CacheBlock *p_evicted_block);
@@ -86,32 +118,70 @@ namespace BlSim
 
             uint32_t get_sub_block_distribution();
 
-            int is_invalid_cache(){return m_block_addr == INVALID_BLOCK;}
+            int is_invalid_cache(){return m_block_addr == INVALID_BLOCK || m_state == MESI_INVALID;}
     };
 
+    //sets are not constructed: they sit in zero-filled slabs and init() runs on the first access
     class CacheSet
     {
 	int write_back_mem_trace;
 
 protected:
-            uint32_t m_way_count;  //the cache associaticity
-            class CacheBlock *m_p_mru_block;
-            class CacheBlock *m_p_lru_block;
+            class CacheBlock *m_blocks;  //m_way_count blocks in the level's block slab, NULL until init()
+            uint16_t m_way_count;  //the cache associaticity
+            uint16_t m_mru_way;
+            uint16_t m_lru_way;
+
+            void unlink_block(uint16_t way);
+            void park_at_lru(uint16_t way);
 
         public:
-            CacheSet(uint32_t way_count, uint32_t block_size);
-            ~CacheSet();
+            //eviction counts, kept per set so disjoint sets can be updated from different threads
+            uint64_t m_evicted_count;
+            uint64_t m_evicted_unused_prefetch;
+            uint64_t m_capacity_hits;  //compressed LLC: hits behind more valid blocks than the set has data ways
+
+            void init(uint32_t way_count, CacheBlock *p_blocks);
+            bool is_initialized(){return m_blocks != NULL;}
 
             CacheBlock *find_block(uint64_t mem_tag); //if not in set, return NULL		
+            //find_block for sets of exactly WAYS ways, the compiler unrolls the tag compares
+            template<uint32_t WAYS> CacheBlock *find_block_ways(uint64_t mem_tag)
+            {
+                for(uint32_t i = 0; i < WAYS; i++)
+                {
+                    if(mem_tag == m_blocks[i].m_block_tag && !m_blocks[i].is_invalid_cache())
+                    {
+                        return &m_blocks[i];
+                    }
+                }
+                return NULL;
+            }
             void hit_access(CacheBlock **p_block);
 
-            CacheBlock* evict_lru_block();
+            //the lru block among the ways of way_mask (ALL_WAYS for any), out of the lru list
+            CacheBlock* evict_lru_block(uint32_t way_mask);
             void write_back_evicted_lru_block(CacheBlock *evicted_lru_block);
             void put_accessed_block_in_mru(CacheBlock *p_new_block);
-
-            uint32_t load_new_block_in_LLC(uint64_t maddr, uint64_t mem_tag);
-            CacheBlock *get_mru_block(){return m_p_mru_block;}
-            CacheBlock *get_lru_block(){return m_p_lru_block;}
+            void invalidate_block(CacheBlock *p_block);
+            //drops the block on a request of another core, the tag stays to spot the coherence miss
+            void coherence_invalidate(CacheBlock *p_block);
+            bool find_coherence_invalid(uint64_t mem_tag);
+
+            //replaces the lru block of way_mask with maddr at the mru position, *p_victim gets the evicted block
+            CacheBlock *load_new_block(uint64_t maddr, uint64_t mem_tag, CacheBlock *p_victim, uint32_t way_mask);
+            CacheBlock *get_mru_block(){return &m_blocks[m_mru_way];}
+            CacheBlock *get_lru_block(){return &m_blocks[m_lru_way];}
+            //whether the block is among the 'ways' blocks at the lru end
+            bool is_near_lru(CacheBlock *p_block, uint32_t ways);
+            //the dirty block closest to the lru end among the last 'ways', NULL if they are all clean
+            CacheBlock *find_dirty_near_lru(uint32_t ways);
+            //valid blocks between the mru end and the block
+            uint32_t mru_depth(CacheBlock *p_block);
+            //data segments of the valid blocks
+            uint32_t used_segments();
+            //the valid block closest to the lru end other than p_keep, NULL if there is none
+            CacheBlock *find_lru_valid(CacheBlock *p_keep);
 
             void print_cache_set();
     };
@@ -119,7 +189,8 @@ protected:
     class Caches
     {
         protected:
-            enum Cache_Config{MAX_CACHE_LEVEL=8};
+            enum Cache_Config{MAX_CACHE_LEVEL=8, PREFETCH_QUEUE_DEPTH=32, MAX_CORE_COUNT=32, MAX_SECTOR_COUNT=8,
+                              EAGER_SCAN_SETS=64, COMPRESSED_TAG_FACTOR=2};
 
             uint32_t m_level; //3 level cache
             uint64_t m_cache_capacity[MAX_CACHE_LEVEL]; //the capacity of each level cahce
@@ -137,17 +208,117 @@ protected:
             uint32_t m_set_index_mask[MAX_CACHE_LEVEL];
             //uint64_t m_tag_mask[MASK_CACHE_LEVEL];
 
-            //some cache access statistics
-            uint64_t m_mem_reads[MAX_CACHE_LEVEL];
-            uint64_t m_mem_reads_hit[MAX_CACHE_LEVEL];
-            uint64_t m_mem_reads_miss[MAX_CACHE_LEVEL];
-
-            uint64_t m_mem_writes[MAX_CACHE_LEVEL];
-            uint64_t m_mem_writes_hit[MAX_CACHE_LEVEL];
-            uint64_t m_mem_writes_miss[MAX_CACHE_LEVEL];
-            uint64_t m_hit_count;
-			uint64_t m_miss_count;
-            uint64_t m_total_count;
+            //some cache access statistics, the batch api keeps one copy per shard
+            struct CacheCounters
+            {
+                uint64_t m_mem_reads[MAX_CACHE_LEVEL];
+                uint64_t m_mem_reads_hit[MAX_CACHE_LEVEL];
+                uint64_t m_mem_reads_miss[MAX_CACHE_LEVEL];
+
+                uint64_t m_mem_writes[MAX_CACHE_LEVEL];
+                uint64_t m_mem_writes_hit[MAX_CACHE_LEVEL];
+                uint64_t m_mem_writes_miss[MAX_CACHE_LEVEL];
+
+                uint64_t m_writebacks[MAX_CACHE_LEVEL];         //dirty victims sent to the next level (memory for the LLC)
+                uint64_t m_victim_fills[MAX_CACHE_LEVEL];       //upper victims installed in this level
+                uint64_t m_inclusion_victims[MAX_CACHE_LEVEL];  //victims of this level back-invalidated in the upper levels
+                uint64_t m_sector_misses[MAX_CACHE_LEVEL];      //the block was there but not all the sectors of the access
+
+                //memory traffic of the LLC in sectors
+                uint64_t m_fetches;
+                uint64_t m_fetched_sectors;
+                uint64_t m_writeback_sectors;
+                //dirty LLC blocks written back early and kept clean (DRAM-aware writeback)
+                uint64_t m_row_cleans;     //in the row of a dirty victim
+                uint64_t m_eager_cleans;   //found while the memory was idle
+                //compressed LLC
+                uint64_t m_llc_fills;
+                uint64_t m_fill_segments;          //segments of the blocks filled into the LLC
+                uint64_t m_compression_evictions;  //victims evicted for room in the data ways rather than for a tag
+                uint64_t m_decompressions;         //timed LLC hits that paid the decompression latency
+
+                //MESI traffic between the private levels of the cores
+                uint64_t m_upgrades;               //writes to a shared copy
+                uint64_t m_invalidations;          //invalidations sent to the other sharers
+                uint64_t m_downgrades;             //exclusive or modified copies of another core turned shared
+                uint64_t m_coherence_writebacks;   //modified data a downgrade or invalidation put into the LLC
+                uint64_t m_coherence_misses;       //private misses on a block another core invalidated
+
+                //DRAM traffic of each core in blocks: its LLC misses and the dirty LLC victims it filled
+                uint64_t m_core_misses[MAX_CORE_COUNT];
+                uint64_t m_core_writebacks[MAX_CORE_COUNT];
+
+                uint64_t m_hit_count;
+                uint64_t m_miss_count;
+                uint64_t m_total_count;
+
+                void reset();
+                void add(const CacheCounters &other);
+            };
+            CacheCounters m_counters;
+            //lookup timing in cpu cycles, each level has m_port_count ports into a pipelined tag array:
+            //a port starts one lookup per cycle, and a level has at most m_port_count * m_tag_latency
+            //lookups started or waiting for a port (m_lookup_done holds when each is done)
+            uint32_t m_tag_latency[MAX_CACHE_LEVEL];
+            uint32_t m_data_latency[MAX_CACHE_LEVEL];
+            uint32_t m_port_count[MAX_CACHE_LEVEL];
+            std::vector<uint64_t> m_port_free_cycle[MAX_CACHE_LEVEL];
+            std::multiset<uint64_t> m_lookup_done[MAX_CACHE_LEVEL];
+            uint64_t m_port_stall_cycles[MAX_CACHE_LEVEL];
+            void reset_ports(uint32_t level);
+            uint32_t m_last_access_level; //level the last access hit in, m_level for a miss
+            CacheInclusion m_inclusion[MAX_CACHE_LEVEL];  //meaningless for the first level
+
+            //with more than one core every level but the LLC is private: its slab holds one slice of
+            //sets per core, and the LLC blocks keep a sharer vector as the directory of a MESI protocol
+            uint32_t m_core_count;
+            uint32_t m_slice_count[MAX_CACHE_LEVEL];  //m_core_count for the private levels, 1 for the LLC
+            uint32_t m_coherence_latency;  //cycles an access waits for the invalidations or downgrades it sent
+            uint32_t m_current_core;       //core of the accesses made through access_cache
+
+            //LLC way partitioning: a core only replaces blocks in the ways of its mask but hits anywhere,
+            //like CAT; the masks are fixed (set_way_mask) or follow the UCP partitioner
+            bool m_way_partitioned;
+            uint32_t m_way_masks[MAX_CORE_COUNT];
+            WayPartitioner *m_partitioner;  //NULL unless UCP is on
+
+            //sectored blocks: only the touched sectors are fetched and only the dirty ones written back;
+            //without sectors every block is one sector and the masks are a single bit
+            uint32_t m_sector_count;   //sectors per block
+            uint32_t m_sector_bits;    //log2 of the sector size
+            uint8_t m_all_sectors;
+            uint8_t m_access_sectors;  //sectors of the accesses made through access_cache
+            uint32_t m_last_fetch_sectors;
+
+            //dirty LLC victims waiting to be written to memory, only kept when the caller drains them
+            bool m_queue_writebacks;
+            std::deque<std::pair<uint64_t, uint8_t> > m_writeback_queue;
+
+            //DRAM-aware writeback: a dirty LLC victim takes the dirty blocks of its DRAM row along,
+            //as long as they sit in the m_clean_ways ways at the lru end of their sets
+            uint64_t m_row_column_mask;  //address bits that pick the block inside its DRAM row, 0 for off
+            uint32_t m_clean_ways;
+            uint32_t m_clean_set;        //next LLC set eager_clean looks at
+
+            //queues the dirty LLC block for writeback and keeps it as a clean copy
+            void clean_block(CacheBlock *p_block, CacheCounters &counters);
+            //cleans the dirty lru-side blocks in the DRAM row of maddr
+            void clean_row(uint64_t maddr, CacheCounters &counters);
+
+            //compressed LLC: every set has twice the tags of its data ways, and holds blocks as long as
+            //their compressed segments fit in the data ways
+            LineCompressor *m_compressor;  //NULL unless compression is on
+            uint32_t m_data_ways;          //LLC ways of data, the tags are COMPRESSED_TAG_FACTOR times as many
+            uint32_t m_segment_budget;     //data segments of an LLC set
+            const uint8_t *m_access_data;  //payload of the next access_cache write, NULL for none
+            uint32_t m_access_data_offset;
+            uint32_t m_access_data_bytes;
+
+            //evicts lru blocks other than p_keep until the set's blocks fit in its segment budget
+            void fit_segments(CacheSet *p_set, CacheBlock *p_keep, uint32_t core, CacheCounters &counters);
+            //the LLC copy of maddr got new data: resizes it and makes room for it
+            void recompress_llc_block(uint64_t maddr, uint32_t core, CacheCounters &counters);
+
             uint32_t write_back_mem_trace ;
 
 
@@ -155,30 +326,183 @@ protected:
 
             char *m_cache_config_fname;
 
-            CacheSet **m_cache_sets[MAX_CACHE_LEVEL];
+            //tag lookup of each level, specialized on its associativity when the level is allocated
+            typedef CacheBlock *(CacheSet::*FindBlockFn)(uint64_t mem_tag);
+            FindBlockFn m_find_block[MAX_CACHE_LEVEL];
+            CacheBlock *lookup(CacheSet *p_set, uint32_t level, uint64_t mem_tag){return (p_set->*m_find_block[level])(mem_tag);}
+
+            //one slab of sets and one of blocks per level, mapped anonymous so untouched sets cost nothing
+            CacheSet *m_cache_sets[MAX_CACHE_LEVEL];
+            CacheBlock *m_cache_blocks[MAX_CACHE_LEVEL];
+            size_t m_set_slab_bytes[MAX_CACHE_LEVEL];
+            size_t m_block_slab_bytes[MAX_CACHE_LEVEL];
+
+            static void *alloc_slab(size_t bytes);
+            static void free_slab(void *p_slab, size_t bytes);
+            void alloc_level(uint32_t level);
+            //the set of the core's slice, initialized on its first access; the core is ignored for shared levels
+            CacheSet *get_set(uint32_t level, uint32_t set_index, uint32_t core);
+
+            //set-sharded batch access, see access_cache_batch
+            uint32_t m_thread_count;
+            uint64_t m_shard_set_mask;  //set index bits shared by every level
+            class ShardPool *m_shard_pool;
+            const uint64_t *m_batch_maddrs;
+            const uint32_t *m_batch_mem_rws;
+            const uint32_t *m_batch_cores;
+            const uint8_t *m_batch_sectors;
+            bool *m_batch_hits;
+            std::vector<size_t> m_batch_order;  //batch indexes grouped by shard, in batch order inside a shard
+            std::vector<size_t> m_shard_begin;  //shard s owns m_batch_order[m_shard_begin[s], m_shard_begin[s+1])
+            std::vector<CacheCounters> m_shard_counters;
+
+            uint32_t get_shard(uint64_t maddr);
+            void access_shard(uint32_t shard);
+            static void run_shard(void *p_caches, uint32_t shard);
+            void access_batch_sharded(const uint64_t *maddrs, const uint32_t *mem_rws, const uint32_t *cores,
+                                      const uint8_t *sectors, size_t count, bool *hits);
+
+            //LLC prefetcher, NULL when prefetching is off
+            Prefetcher *m_prefetcher;
+            //candidates waiting to be sent to memory and prefetch reads sent but not filled yet, with the
+            //core whose access made them: the block goes into that core's partition of the LLC
+            std::deque<std::pair<uint64_t, uint32_t> > m_prefetch_queue;
+            std::map<uint64_t, uint32_t> m_prefetch_inflight;
+
+            //reuse distance profiler, sees every access; NULL when off
+            ReuseProfiler *m_reuse_profiler;
+            //all-associativity stack simulation of the same trace; NULL when off
+            StackSimulator *m_stack_simulator;
+
+            //binary trace of the LLC misses, written by its own thread; NULL when off
+            MissTraceWriter *m_miss_trace;
+            uint32_t m_trace_gap;  //accesses that hit since the last traced miss
+
+            void trace_access(uint64_t maddr, uint32_t memop, uint32_t core, bool hit);
+
+            CacheBlock *find_block_in_LLC(uint64_t maddr);
+            CacheBlock *find_block_at_level(uint64_t maddr, uint32_t level, uint32_t core);
+            void prefetch_access(uint64_t block_addr, bool miss, bool prefetch_hit);
 
             void get_cache_addr_parts(uint64_t maddr, uint64_t *mem_tag,
                                       uint32_t *set_index, uint32_t level);
 
+            //looks the access up in every level and fills the block on a miss, no prefetch or timing side effects;
+            //*p_level is the level that hit, m_level on a miss
+            bool access_levels(uint64_t maddr, uint32_t mem_rw, uint32_t core, uint8_t sectors,
+                               CacheCounters &counters, uint32_t *p_level);
+
             CacheSet* access_cache_at_level(uint64_t maddr,
                                             uint32_t level,
+                                            uint32_t core,
                                             uint64_t *mtag,
                                             bool* hit);
 
-            void cache_replaced(CacheSet *p_lower_set, CacheSet *p_upper_set,
-                                uint32_t lower_level, uint64_t upper_mtag,
-                                uint64_t maddr);
+            //puts maddr in the mru position of the level with all sectors valid and sends the victim down
+            CacheBlock *install_block(uint64_t maddr, uint32_t level, uint32_t core, uint8_t dirty, uint8_t prefetched,
+                                      uint8_t in_upper, CacheCounters &counters);
+            //a valid block left the level: back-invalidate for inclusive levels, then write back or victim fill below
+            void evict_to_lower(const CacheBlock &victim, uint32_t level, uint32_t core, CacheCounters &counters);
+            //removes maddr from every level of the core above 'level', returns the dirty sectors of the removed copies
+            uint8_t back_invalidate(uint64_t maddr, uint32_t level, uint32_t core, bool *p_found);
+
+            //MESI actions of an access that missed or wrote in the private levels of the core, before the fill;
+            //returns the state the core's copies get, MESI_INVALID to leave them as they are
+            uint8_t coherence_request(uint64_t maddr, uint32_t mem_rw, uint32_t core, uint32_t hit_level,
+                                      CacheCounters &counters);
+            //the state of the core's private copies, MESI_INVALID if it has none
+            uint8_t private_state(uint64_t maddr, uint32_t core);
+            //returns the dirty sectors a downgrade to shared hands to the LLC
+            uint8_t set_private_state(uint64_t maddr, uint32_t core, uint8_t state);
+            //removes the block from the private levels of the core on a request of another core,
+            //returns the dirty sectors of the removed copies
+            uint8_t invalidate_private(uint64_t maddr, uint32_t core);
 
         public:
             Caches(char *cache_config_fname, unsigned int numCores);
             ~Caches();
 
             bool access_cache(uint64_t maddr, uint32_t mem_rw);
+            //same as above, and sets *p_ready_cycle to when the lookup started at 'now' is done:
+            //the data is available for a hit, the request can leave for memory on a miss
+            bool access_cache(uint64_t maddr, uint32_t mem_rw, uint64_t now, uint64_t *p_ready_cycle);
+            //a new access can start at 'now' when every level it may reach has a free port by the time
+            //it gets there and room for one more lookup, otherwise counts a stall cycle at the level that is full
+            bool port_available(uint64_t now);
+            void set_level_timing(uint32_t level, uint32_t tag_latency, uint32_t data_latency, uint32_t port_count);
+            //replaces the built-in single level with level_count levels of the given capacity (bytes) and ways,
+            //the levels above the last are private to a core (see set_core_count); call before anything else
+            void set_levels(uint32_t level_count, const uint64_t *capacities, const uint32_t *way_counts);
+            uint32_t get_level_count(){return m_level;}
+            uint32_t get_llc_way_count(){return m_cache_way_count[m_level-1];}
+            uint32_t get_llc_set_count(){return m_cache_set_count[m_level-1];}
+            uint32_t get_llc_block_size(){return m_block_size[m_level-1];}
+            void set_inclusion(uint32_t level, CacheInclusion inclusion);
+            //gives each core its own copy of the levels above the LLC and keeps them coherent,
+            //call before the first access; the LLC has to be inclusive for more than one core
+            void set_core_count(uint32_t core_count, uint32_t coherence_latency);
+
+            //functional batch access for fast-forward and warmup: the batch is split by set index into
+            //one shard per thread, shards own disjoint sets at every level and keep the batch order of their
+            //accesses, so the result matches a serial run; no prefetching or timing. hits may be NULL
+            //cores may be NULL for accesses of the current core, sectors (see sector_mask) NULL for whole blocks
+            void access_cache_batch(const uint64_t *maddrs, const uint32_t *mem_rws, const uint32_t *cores,
+                                    const uint8_t *sectors, size_t count, bool *hits);
+            void set_thread_count(uint32_t thread_count);
+            void set_reuse_profiler(ReuseProfiler *p_profiler);
+            void set_stack_simulator(StackSimulator *p_simulator);
+            void set_miss_trace(MissTraceWriter *p_writer);
+            void close_miss_trace();  //writes out the rest of the miss trace, call at the end of the run
+            //core of the following access_cache calls, selects its private levels and is recorded in the miss trace
+            void set_core(uint32_t core);
+
+            //splits the blocks into sectors of sector_bytes (at most 8 per block), 0 for whole blocks
+            void set_sector_size(uint32_t sector_bytes);
+            uint32_t get_sector_count(){return m_sector_count;}
+            //the sectors of 'bytes' from 'offset' inside a block, every sector for 0 bytes
+            uint8_t sector_mask(uint32_t offset, uint32_t bytes);
+            //part of the block the following access_cache calls touch
+            void set_access_bytes(uint32_t offset, uint32_t bytes){m_access_sectors = sector_mask(offset, bytes);}
+            //data the next access_cache write stores at 'offset' inside the block, for the compressor
+            void set_access_data(uint32_t offset, const uint8_t *p_data, uint32_t bytes);
+            //data written at maddr outside of access_cache (e.g. by the batch access), for the compressor
+            void store_data(uint64_t maddr, const uint8_t *p_data, uint32_t bytes);
+
+            //stores the LLC blocks compressed, the caches own the compressor; call before the first access,
+            //the LLC cannot be way partitioned as well
+            void set_compressor(LineCompressor *p_compressor);
+            //sectors the last access_cache miss needs from memory
+            uint32_t get_fetch_sectors(){return m_last_fetch_sectors;}
+
+            //restricts the LLC victims of the core to the ways of way_mask, call after set_core_count
+            void set_way_mask(uint32_t core, uint32_t way_mask);
+            //lets the UCP partitioner set the masks of every core from the timed accesses (the batch access
+            //keeps the masks as they are), call after set_core_count
+            void set_way_partitioner(WayPartitioner *p_partitioner);
+
+            //keep the dirty LLC victims for get_writeback_request (the batch access never queues them)
+            void set_writeback_queue(bool enable);
+            bool get_writeback_request(uint64_t *p_maddr, uint32_t *p_sectors);  //false if nothing to write
+            bool writeback_pending(){return !m_writeback_queue.empty();}
+            //batches the writebacks by DRAM row: column_mask has the address bits that select the block
+            //inside its row, clean_ways how far from the lru end a dirty block may be cleaned early
+            void set_row_writeback(uint64_t column_mask, uint32_t clean_ways);
+            //the memory is idle: cleans the next dirty lru-side LLC block and its row, false if none was found
+            bool eager_clean();
+            void reset_statistic();
 
             void print_cache_config();
             void output_mem_reqs_statistics();
             void dump_statistic();
             bool writebackornot();
+
+            //prefetch interface, the caller owns the memory side
+            void set_prefetcher(Prefetcher *p_prefetcher);
+            bool get_prefetch_request(uint64_t *p_maddr, uint32_t *p_core);  //false if nothing to send
+            void prefetch_issued(uint64_t maddr, uint32_t core);
+            void prefetch_dropped(uint64_t maddr);
+            bool prefetch_pending(uint64_t maddr);         //a prefetch read for this block is in flight
+            bool prefetch_fill(uint64_t maddr);            //false if maddr is not a prefetch read
     };
 
 }
@@ -0,0 +1,293 @@
+#include "Compressor.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+using namespace std;
+
+BlSim::LineCompressor::LineCompressor(uint32_t block_size, uint32_t decompression_latency)
+{
+	if(block_size < SEGMENT_BYTES || block_size % SEGMENT_BYTES || block_size / SEGMENT_BYTES > 255)
+	{
+		cerr<<"ERROR: compressed blocks are stored in "<<SEGMENT_BYTES<<" byte segments, invalid block size "<<block_size<<endl;
+		exit(-8);
+	}
+	m_block_size = block_size;
+	m_decompression_latency = decompression_latency;
+	memset(m_encodings, 0, sizeof(m_encodings));
+	m_compressed_bytes = 0;
+	m_compressions = 0;
+}
+
+void BlSim::LineCompressor::write(uint64_t maddr, const uint8_t *p_data, uint32_t bytes)
+{
+	uint64_t block_addr = maddr - maddr % m_block_size;
+	uint32_t offset = (uint32_t)(maddr - block_addr);
+	uint32_t encoding;
+
+	std::map<uint64_t, Line>::iterator it = m_image.find(block_addr);
+	if(it == m_image.end())
+	{
+		//the rest of a line the trace never wrote reads as zero
+		it = m_image.insert(std::make_pair(block_addr, Line())).first;
+		it->second.m_bytes.assign(m_block_size, 0);
+	}
+	if(bytes > m_block_size - offset)
+	{
+		bytes = m_block_size - offset;
+	}
+	memcpy(&it->second.m_bytes[offset], p_data, bytes);
+
+	uint32_t size = compress(&it->second.m_bytes[0], &encoding);
+	if(size > m_block_size)
+	{
+		size = m_block_size;
+	}
+	it->second.m_segments = (uint8_t)((size + SEGMENT_BYTES - 1) / SEGMENT_BYTES);
+	m_encodings[encoding]++;
+	m_compressed_bytes += size;
+	m_compressions++;
+}
+
+uint32_t BlSim::LineCompressor::get_segments(uint64_t maddr)
+{
+	std::map<uint64_t, Line>::const_iterator it = m_image.find(maddr - maddr % m_block_size);
+	return it == m_image.end() ? get_block_segments() : it->second.m_segments;
+}
+
+void BlSim::LineCompressor::reset_statistic()
+{
+	memset(m_encodings, 0, sizeof(m_encodings));
+	m_compressed_bytes = 0;
+	m_compressions = 0;
+}
+
+void BlSim::LineCompressor::print_statistic()
+{
+	uint32_t i;
+
+	cout<<"compression ("<<get_name()<<"): lines written: "<<m_compressions<<"\t distinct: "<<m_image.size()
+		<<"\t average size: "<<(m_compressions ? (float)m_compressed_bytes / m_compressions : 0)<<" of "<<m_block_size<<" bytes"
+		<<"\t decompression latency: "<<m_decompression_latency<<endl;
+	cout<<"    encodings:";
+	for(i = 0; i < get_encoding_count(); i++)
+	{
+		cout<<" "<<get_encoding_name(i)<<": "<<m_encodings[i];
+	}
+	cout<<endl;
+}
+
+//BDI encodings from the smallest to the uncompressed line
+enum Bdi_Encoding{BDI_ZEROS = 0, BDI_REPEATED, BDI_B8D1, BDI_B8D2, BDI_B8D4, BDI_B4D1, BDI_B4D2, BDI_B2D1,
+                  BDI_UNCOMPRESSED, BDI_ENCODINGS};
+
+static uint64_t read_value(const uint8_t *p_bytes, uint32_t bytes)
+{
+	uint64_t value = 0;
+	uint32_t i;
+
+	//little endian, like the x86 traces
+	for(i = bytes; i > 0; i--)
+	{
+		value = (value << 8) | p_bytes[i - 1];
+	}
+	return value;
+}
+
+//whether value - base, taken as a value_bytes wide signed number, fits in delta_bytes
+static bool fits_delta(uint64_t value, uint64_t base, uint32_t value_bytes, uint32_t delta_bytes)
+{
+	uint32_t shift = 64 - 8 * value_bytes;
+	int64_t delta = (int64_t)((value - base) << shift) >> shift;
+	int64_t limit = 1L << (8 * delta_bytes - 1);
+
+	return delta >= -limit && delta < limit;
+}
+
+uint32_t BlSim::BdiCompressor::base_delta_size(const uint8_t *p_line, uint32_t base_bytes, uint32_t delta_bytes)
+{
+	uint32_t count = m_block_size / base_bytes;
+	uint64_t base = 0;
+	bool have_base = false;
+	uint32_t i;
+
+	for(i = 0; i < count; i++)
+	{
+		uint64_t value = read_value(p_line + i * base_bytes, base_bytes);
+		if(fits_delta(value, 0, base_bytes, delta_bytes))
+		{
+			continue;  //a delta from the implicit zero base
+		}
+		if(!have_base)
+		{
+			base = value;
+			have_base = true;
+		}
+		else if(!fits_delta(value, base, base_bytes, delta_bytes))
+		{
+			return 0;
+		}
+	}
+	//the base, the deltas and one bit per value to pick the base
+	return base_bytes + count * delta_bytes + (count + 7) / 8;
+}
+
+uint32_t BlSim::BdiCompressor::compress(const uint8_t *p_line, uint32_t *p_encoding)
+{
+	static const uint32_t base_delta[][3] = {{BDI_B8D1, 8, 1}, {BDI_B8D2, 8, 2}, {BDI_B8D4, 8, 4},
+	                                         {BDI_B4D1, 4, 1}, {BDI_B4D2, 4, 2}, {BDI_B2D1, 2, 1}};
+	uint32_t best = m_block_size;
+	uint32_t i;
+
+	*p_encoding = BDI_UNCOMPRESSED;
+	for(i = 0; i < m_block_size && p_line[i] == 0; i++)
+	{
+	}
+	if(i == m_block_size)
+	{
+		*p_encoding = BDI_ZEROS;
+		return 1;
+	}
+	for(i = 8; i < m_block_size && memcmp(p_line, p_line + i, 8) == 0; i += 8)
+	{
+	}
+	if(i >= m_block_size)
+	{
+		*p_encoding = BDI_REPEATED;
+		return 8;
+	}
+
+	//the hardware tries every encoding in parallel and keeps the smallest
+	for(i = 0; i < sizeof(base_delta) / sizeof(base_delta[0]); i++)
+	{
+		uint32_t size = base_delta_size(p_line, base_delta[i][1], base_delta[i][2]);
+		if(size > 0 && size < best)
+		{
+			best = size;
+			*p_encoding = base_delta[i][0];
+		}
+	}
+	return best;
+}
+
+uint32_t BlSim::BdiCompressor::get_encoding_count()
+{
+	return BDI_ENCODINGS;
+}
+
+const char *BlSim::BdiCompressor::get_encoding_name(uint32_t encoding)
+{
+	static const char *names[] = {"zeros", "repeated", "b8d1", "b8d2", "b8d4", "b4d1", "b4d2", "b2d1", "uncompressed"};
+	return names[encoding];
+}
+
+//FPC line outcomes; the words are encoded one by one
+enum Fpc_Encoding{FPC_ZEROS = 0, FPC_COMPRESSED, FPC_UNCOMPRESSED, FPC_ENCODINGS};
+
+static bool fits_signed(int32_t value, uint32_t bits)
+{
+	int32_t limit = 1 << (bits - 1);
+	return value >= -limit && value < limit;
+}
+
+uint32_t BlSim::FpcCompressor::compress(const uint8_t *p_line, uint32_t *p_encoding)
+{
+	uint32_t words = m_block_size / 4;
+	uint32_t bits = 0;
+	uint32_t zero_run = 0;
+	uint32_t zero_words = 0;
+	uint32_t i;
+
+	for(i = 0; i < words; i++)
+	{
+		uint32_t word = (uint32_t)read_value(p_line + i * 4, 4);
+		int32_t value = (int32_t)word;
+		int16_t high = (int16_t)(word >> 16);
+		int16_t low = (int16_t)(word & 0xffff);
+
+		if(word == 0)
+		{
+			//up to 8 zero words share one prefix and a 3 bit count
+			zero_words++;
+			if(zero_run == 0)
+			{
+				bits += 3 + 3;
+			}
+			zero_run = (zero_run + 1) % 8;
+			continue;
+		}
+		zero_run = 0;
+		bits += 3;
+		if(fits_signed(value, 4))
+		{
+			bits += 4;
+		}
+		else if(fits_signed(value, 8))
+		{
+			bits += 8;
+		}
+		else if(fits_signed(value, 16) || low == 0)
+		{
+			bits += 16;  //a sign extended halfword, or a halfword padded with a zero halfword
+		}
+		else if(fits_signed(high, 8) && fits_signed(low, 8))
+		{
+			bits += 16;  //two halfwords, each a sign extended byte
+		}
+		else if((word & 0xff) * 0x01010101U == word)
+		{
+			bits += 8;   //repeated bytes
+		}
+		else
+		{
+			bits += 32;
+		}
+	}
+
+	uint32_t size = (bits + 7) / 8;
+	if(zero_words == words)
+	{
+		*p_encoding = FPC_ZEROS;
+	}
+	else if(size < m_block_size)
+	{
+		*p_encoding = FPC_COMPRESSED;
+	}
+	else
+	{
+		*p_encoding = FPC_UNCOMPRESSED;
+		size = m_block_size;
+	}
+	return size;
+}
+
+uint32_t BlSim::FpcCompressor::get_encoding_count()
+{
+	return FPC_ENCODINGS;
+}
+
+const char *BlSim::FpcCompressor::get_encoding_name(uint32_t encoding)
+{
+	static const char *names[] = {"zeros", "compressed", "uncompressed"};
+	return names[encoding];
+}
+
+BlSim::LineCompressor *BlSim::create_compressor(const std::string &type, uint32_t block_size)
+{
+	if(type.length() == 0 || type == "none")
+	{
+		return NULL;
+	}
+	else if(type == "bdi")
+	{
+		return new BdiCompressor(block_size);
+	}
+	else if(type == "fpc")
+	{
+		return new FpcCompressor(block_size);
+	}
+
+	cerr<<"WARNING: unknown compression '"<<type<<"'; valid values are 'none', 'bdi' or 'fpc'. Compression disabled"<<endl;
+	return NULL;
+}
@@ -0,0 +1,97 @@
+#ifndef COMPRESSOR_H_
+#define COMPRESSOR_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace BlSim
+{
+    /*
+     * Cache line compression for the LLC (see Caches::set_compressor).
+     *
+     * The compressor keeps an image of the lines the trace wrote data to:
+     * every write payload is merged into its line and the line is
+     * recompressed. The LLC stores a line in 8-byte segments, as many as
+     * its compressed size needs; lines the trace never gave data for are
+     * stored uncompressed. A subclass only knows how to size a line:
+     *   bdi  base-delta-immediate: one 8, 4 or 2 byte base plus 1, 2 or 4
+     *        byte deltas, against the base or an implicit zero base
+     *   fpc  frequent pattern compression: a 3 bit prefix and 0 to 32 bits
+     *        of data for every 32 bit word, zero runs share one prefix
+     */
+    class LineCompressor
+    {
+        public:
+            enum Compressor_Config{SEGMENT_BYTES=8, MAX_ENCODINGS=16};
+
+        protected:
+            uint32_t m_block_size;
+            uint32_t m_decompression_latency;  //cycles added to an LLC hit on a compressed line
+
+            struct Line
+            {
+                std::vector<uint8_t> m_bytes;
+                uint8_t m_segments;
+            };
+            std::map<uint64_t, Line> m_image;  //block address -> contents written by the trace
+
+            //lines compressed after a write, by encoding
+            uint64_t m_encodings[MAX_ENCODINGS];
+            uint64_t m_compressed_bytes;
+            uint64_t m_compressions;
+
+            //compressed size in bytes of one block, *p_encoding gets the encoding used
+            virtual uint32_t compress(const uint8_t *p_line, uint32_t *p_encoding) = 0;
+            virtual uint32_t get_encoding_count() = 0;
+            virtual const char *get_encoding_name(uint32_t encoding) = 0;
+            virtual const char *get_name() = 0;
+
+        public:
+            LineCompressor(uint32_t block_size, uint32_t decompression_latency);
+            virtual ~LineCompressor(){}
+
+            //merges the bytes written at maddr into its line and recompresses it
+            void write(uint64_t maddr, const uint8_t *p_data, uint32_t bytes);
+            //segments the line of maddr takes in the LLC
+            uint32_t get_segments(uint64_t maddr);
+            uint32_t get_block_segments(){return m_block_size / SEGMENT_BYTES;}
+            uint32_t get_decompression_latency(){return m_decompression_latency;}
+
+            void print_statistic();
+            void reset_statistic();  //keeps the line image
+    };
+
+    class BdiCompressor : public LineCompressor
+    {
+        protected:
+            uint32_t compress(const uint8_t *p_line, uint32_t *p_encoding);
+            uint32_t get_encoding_count();
+            const char *get_encoding_name(uint32_t encoding);
+            const char *get_name(){return "bdi";}
+
+            //size of the line as base_bytes wide values with delta_bytes wide deltas, 0 if they do not fit
+            uint32_t base_delta_size(const uint8_t *p_line, uint32_t base_bytes, uint32_t delta_bytes);
+
+        public:
+            BdiCompressor(uint32_t block_size) : LineCompressor(block_size, 1) {}
+    };
+
+    class FpcCompressor : public LineCompressor
+    {
+        protected:
+            uint32_t compress(const uint8_t *p_line, uint32_t *p_encoding);
+            uint32_t get_encoding_count();
+            const char *get_encoding_name(uint32_t encoding);
+            const char *get_name(){return "fpc";}
+
+        public:
+            FpcCompressor(uint32_t block_size) : LineCompressor(block_size, 5) {}
+    };
+
+    //returns NULL for "none" or an empty name
+    LineCompressor *create_compressor(const std::string &type, uint32_t block_size);
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "CxlLink.h"
+#include "PrintMacros.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	const unsigned CxlLink::FLIT_BYTES;
+	const unsigned CxlLink::SLOTS_PER_FLIT;
+	const unsigned CxlLink::SLOT_BYTES;
+
+	CxlLink::CxlLink(unsigned credits, double flitCycles, double latencyCycles) :
+		credits(credits), maxCredits(credits), flitCycles(flitCycles), latencyCycles(latencyCycles)
+	{
+		if (credits == 0)
+		{
+			ERROR("CXL_LINK_CREDITS must be at least 1");
+			exit(-1);
+		}
+		dataSlots = (TRANS_DATA_BYTES + SLOT_BYTES - 1) / SLOT_BYTES;
+		cycle = 0;
+		creditStalls = 0;
+
+		Direction *directions[] = {&request, &response};
+		for (unsigned i=0; i<2; i++)
+		{
+			directions[i]->nextFlit = 0;
+			directions[i]->flits = 0;
+			directions[i]->slotsUsed = 0;
+			directions[i]->messages = 0;
+			directions[i]->waitingSum = 0;
+		}
+	}
+
+
+	bool CxlLink::sendRequest(unsigned channel, Transaction *trans)
+	{
+		if (credits == 0)
+		{
+			creditStalls++;
+			return false;
+		}
+		credits--;
+		bool isWrite = trans->transactionType == Transaction::DATA_WRITE;
+		Message message = {channel, trans, trans->address, isWrite, 1 + (isWrite ? dataSlots : 0), 0};
+		send(request, message);
+		return true;
+	}
+
+
+	void CxlLink::sendResponse(unsigned channel, uint64_t address, bool isWrite)
+	{
+		Message message = {channel, NULL, address, isWrite, 1 + (isWrite ? 0 : dataSlots), 0};
+		send(response, message);
+	}
+
+
+	void CxlLink::returnCredit()
+	{
+		creditReturns.push_back(cycle + latencyCycles);
+	}
+
+
+	bool CxlLink::isIdle()
+	{
+		return request.waiting.empty() && request.inFlight.empty() && response.waiting.empty() && response.inFlight.empty();
+	}
+
+
+	void CxlLink::send(Direction &direction, Message &message)
+	{
+		direction.waiting.push_back(message);
+		direction.messages++;
+	}
+
+
+	void CxlLink::update(vector<Message> &requestsArrived, vector<Message> &responsesArrived)
+	{
+		cycle++;
+		while (!creditReturns.empty() && creditReturns.front() <= cycle)
+		{
+			creditReturns.pop_front();
+			credits++;
+		}
+		transmit(request, requestsArrived);
+		transmit(response, responsesArrived);
+	}
+
+
+	// sends the flits that start in this cycle and hands over the messages that arrived
+	void CxlLink::transmit(Direction &direction, vector<Message> &arrived)
+	{
+		direction.waitingSum += direction.waiting.size();
+		while (!direction.waiting.empty() && direction.nextFlit < cycle + 1)
+		{
+			double departure = max(direction.nextFlit, (double)cycle);
+			unsigned slots = 0;
+			while (slots < SLOTS_PER_FLIT && !direction.waiting.empty())
+			{
+				Message &message = direction.waiting.front();
+				unsigned taken = min(message.slotsLeft, SLOTS_PER_FLIT - slots);
+				message.slotsLeft -= taken;
+				slots += taken;
+				if (message.slotsLeft == 0)
+				{
+					message.arrival = departure + flitCycles + latencyCycles;
+					direction.inFlight.push_back(message);
+					direction.waiting.pop_front();
+				}
+			}
+			direction.nextFlit = departure + flitCycles;
+			direction.flits++;
+			direction.slotsUsed += slots;
+		}
+
+		while (!direction.inFlight.empty() && direction.inFlight.front().arrival <= cycle)
+		{
+			arrived.push_back(direction.inFlight.front());
+			direction.inFlight.pop_front();
+		}
+	}
+
+
+	void CxlLink::printDirection(const char *name, const Direction &direction)
+	{
+		cout << "    " << name << ": messages: " << direction.messages
+			<< "\t flits: " << direction.flits
+			<< "\t slots used: " << (direction.flits ? (double)direction.slotsUsed / (direction.flits * SLOTS_PER_FLIT) : 0)
+			<< "\t link busy: " << (cycle ? direction.flits * flitCycles / cycle : 0)
+			<< "\t average queue: " << (cycle ? (double)direction.waitingSum / cycle : 0) << endl;
+	}
+
+
+	void CxlLink::printStats()
+	{
+		cout << "CXL link (" << CXL_LINK_BANDWIDTH << "GB/s and " << CXL_LINK_LATENCY << "ns each way, " << maxCredits << " request credits):"
+			<< " requests turned away for want of a credit: " << creditStalls << endl;
+		printDirection("host to expander", request);
+		printDirection("expander to host", response);
+	}
+}
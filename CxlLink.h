@@ -0,0 +1,105 @@
+#ifndef CXLLINK_H
+#define CXLLINK_H
+
+#include "SystemConfiguration.h"
+#include "Transaction.h"
+
+#include <deque>
+#include <vector>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	/*
+	 * The link to a CXL.mem memory expander (CXL_CHANNELS).
+	 *
+	 * Each direction sends 68 byte flits, CXL_LINK_BANDWIDTH apart, that
+	 * arrive CXL_LINK_LATENCY after they leave. A flit carries four 16 byte
+	 * slots, and messages are packed into them in order: a message may
+	 * start in the flit its predecessor ends in and straddle flits, so a
+	 * flit only goes out part empty when nothing else waits. A message
+	 * takes a header slot, and a line of data takes as many slots more:
+	 *   read request (M2S Req)      header
+	 *   write request (M2S RwD)     header + data
+	 *   read data (S2M DRS)         header + data
+	 *   write completion (S2M NDR)  header
+	 * A message has arrived when the flit with its last slot has.
+	 *
+	 * The host holds CXL_LINK_CREDITS request credits, one for each entry of
+	 * the expander's request queue. Sending a request takes one, and the
+	 * expander returns it over the link once the request has moved on to
+	 * its memory controller; the credit rides back in a response flit, so
+	 * it takes the latency but no slot. Responses need no credit, the host
+	 * always takes them.
+	 *
+	 * The expander's channels are the last CXL_CHANNELS, each with its own
+	 * memory controller and ranks (and device, see CHANNEL_DEVICE_INIS);
+	 * they share the link. With CXL_MAPPING=range their memory comes after
+	 * that of the local channels, with interleave the address mapping
+	 * spreads the lines over all channels alike. The memory system takes a
+	 * transaction for the expander while the host has a credit, and a
+	 * completion reaches the callbacks once its response is over the link.
+	 */
+	class CxlLink
+	{
+	public:
+		static const unsigned FLIT_BYTES = 68;
+		static const unsigned SLOTS_PER_FLIT = 4;
+		static const unsigned SLOT_BYTES = 16;
+
+		struct Message
+		{
+			unsigned channel;
+			Transaction *trans;  // requests
+			uint64_t address;    // responses
+			bool isWrite;
+			unsigned slotsLeft;  // not sent yet
+			double arrival;      // cycle it is through the link
+		};
+
+		// times in memory system cycles
+		CxlLink(unsigned credits, double flitCycles, double latencyCycles);
+
+		// false while the host has no credit
+		bool sendRequest(unsigned channel, Transaction *trans);
+		void sendResponse(unsigned channel, uint64_t address, bool isWrite);
+		// the expander has taken a request off its request queue
+		void returnCredit();
+		unsigned getCredits() {return credits;}
+		bool isIdle();
+
+		// one memory system cycle, appends the messages that made it through
+		void update(vector<Message> &requestsArrived, vector<Message> &responsesArrived);
+		void printStats();
+
+	private:
+		struct Direction
+		{
+			deque<Message> waiting;    // head may be partly sent
+			deque<Message> inFlight;
+			double nextFlit;           // cycle the next flit may leave
+			uint64_t flits;
+			uint64_t slotsUsed;
+			uint64_t messages;
+			uint64_t waitingSum;       // queue length summed over the cycles
+		};
+
+		unsigned credits;
+		unsigned maxCredits;
+		unsigned dataSlots;            // a line of data
+		deque<double> creditReturns;   // cycles returned credits reach the host
+		double flitCycles;
+		double latencyCycles;
+		uint64_t cycle;
+		uint64_t creditStalls;         // requests turned away for want of a credit
+		Direction request;
+		Direction response;
+
+		void send(Direction &direction, Message &message);
+		void transmit(Direction &direction, vector<Message> &arrived);
+		void printDirection(const char *name, const Direction &direction);
+	};
+}
+
+#endif
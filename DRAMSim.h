@@ -50,6 +50,8 @@ namespace DRAMSim
 			void printStats();
 			bool willAcceptTransaction(); 
 			bool willAcceptTransaction(uint64_t addr); 
+			unsigned getFreeSlots();
+			unsigned getFreeSlots(uint64_t addr);
 			std::ostream &getLogFile();
 
 			void registerCallbacks( 
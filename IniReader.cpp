@@ -87,6 +87,8 @@ namespace DRAMSim
 		//Memory Controller related parameters
 		DEFINE_UINT_PARAM(TRANS_QUEUE_DEPTH,SYS_PARAM),
 		DEFINE_UINT_PARAM(CMD_QUEUE_DEPTH,SYS_PARAM),
+		DEFINE_UINT_PARAM(PENDING_QUEUE_DEPTH,SYS_PARAM),
+		DEFINE_UINT_PARAM(MERGE_BUFFER_ENTRIES,SYS_PARAM),
 
 		DEFINE_UINT64_PARAM(EPOCH_LENGTH,SYS_PARAM),
 		DEFINE_UINT_PARAM(HISTOGRAM_BIN_SIZE,SYS_PARAM),
@@ -97,7 +99,55 @@ namespace DRAMSim
 		DEFINE_STRING_PARAM(ROW_BUFFER_POLICY,SYS_PARAM),
 		DEFINE_STRING_PARAM(SCHEDULING_POLICY,SYS_PARAM),
 		DEFINE_STRING_PARAM(ADDRESS_MAPPING_SCHEME,SYS_PARAM),
+		DEFINE_STRING_PARAM(ADDRESS_HASH,SYS_PARAM),
+		DEFINE_STRING_PARAM(CHANNEL_XOR_MASKS,SYS_PARAM),
+		DEFINE_STRING_PARAM(RANK_XOR_MASKS,SYS_PARAM),
+		DEFINE_STRING_PARAM(BANK_XOR_MASKS,SYS_PARAM),
 		DEFINE_STRING_PARAM(QUEUING_STRUCTURE,SYS_PARAM),
+		DEFINE_STRING_PARAM(CHANNEL_DEVICE_INIS,SYS_PARAM),
+		DEFINE_UINT_PARAM(NVM_CHANNELS,SYS_PARAM),
+		DEFINE_STRING_PARAM(TIER_PLACEMENT,SYS_PARAM),
+		DEFINE_UINT64_PARAM(MIGRATION_EPOCH,SYS_PARAM),
+		DEFINE_UINT_PARAM(MIGRATION_PAGES,SYS_PARAM),
+		DEFINE_UINT_PARAM(MIGRATION_THRESHOLD,SYS_PARAM),
+		DEFINE_FLOAT_PARAM(NVM_WRITE_ENERGY,SYS_PARAM),
+		DEFINE_UINT64_PARAM(NVM_ENDURANCE,SYS_PARAM),
+		DEFINE_UINT_PARAM(CXL_CHANNELS,SYS_PARAM),
+		DEFINE_STRING_PARAM(CXL_MAPPING,SYS_PARAM),
+		DEFINE_FLOAT_PARAM(CXL_LINK_LATENCY,SYS_PARAM),
+		DEFINE_FLOAT_PARAM(CXL_LINK_BANDWIDTH,SYS_PARAM),
+		DEFINE_UINT_PARAM(CXL_LINK_CREDITS,SYS_PARAM),
+		DEFINE_STRING_PARAM(PREFETCHER,SYS_PARAM),
+		DEFINE_UINT_PARAM(PREFETCH_DEGREE,SYS_PARAM),
+		DEFINE_UINT_PARAM(PREFETCH_DISTANCE,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_SIZES_KB,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_WAYS,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_TAG_LATENCY,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_DATA_LATENCY,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_PORTS,SYS_PARAM),
+		DEFINE_STRING_PARAM(CACHE_INCLUSION,SYS_PARAM),
+		DEFINE_UINT_PARAM(CACHE_CORES,SYS_PARAM),
+		DEFINE_UINT_PARAM(COHERENCE_LATENCY,SYS_PARAM),
+		DEFINE_UINT_PARAM(SECTOR_BYTES,SYS_PARAM),
+		DEFINE_BOOL_PARAM(LLC_WRITEBACKS,SYS_PARAM),
+		DEFINE_BOOL_PARAM(DRAM_AWARE_WRITEBACK,SYS_PARAM),
+		DEFINE_UINT_PARAM(WRITEBACK_CLEAN_WAYS,SYS_PARAM),
+		DEFINE_STRING_PARAM(LLC_WAY_MASKS,SYS_PARAM),
+		DEFINE_UINT64_PARAM(UCP_EPOCH,SYS_PARAM),
+		DEFINE_STRING_PARAM(LLC_COMPRESSION,SYS_PARAM),
+		DEFINE_UINT_PARAM(PAGE_SIZE,SYS_PARAM),
+		DEFINE_STRING_PARAM(PAGE_POLICY,SYS_PARAM),
+		DEFINE_UINT_PARAM(TLB_ENTRIES,SYS_PARAM),
+		DEFINE_UINT64_PARAM(FAST_FORWARD,SYS_PARAM),
+		DEFINE_UINT64_PARAM(AUTO_MAPPING_RECORDS,SYS_PARAM),
+		DEFINE_UINT_PARAM(CACHE_THREADS,SYS_PARAM),
+		DEFINE_BOOL_PARAM(REUSE_PROFILER,SYS_PARAM),
+		DEFINE_FLOAT_PARAM(REUSE_SAMPLE_RATE,SYS_PARAM),
+		DEFINE_UINT64_PARAM(REUSE_EPOCH_LENGTH,SYS_PARAM),
+		DEFINE_UINT_PARAM(STACK_SIM_WAYS,SYS_PARAM),
+		DEFINE_UINT_PARAM(STACK_SIM_MIN_SETS,SYS_PARAM),
+		DEFINE_UINT_PARAM(STACK_SIM_MAX_SETS,SYS_PARAM),
+		DEFINE_STRING_PARAM(MISS_TRACE_FILE,SYS_PARAM),
 		// debug flags
 		DEFINE_BOOL_PARAM(DEBUG_TRANS_Q,SYS_PARAM),
 		DEFINE_BOOL_PARAM(DEBUG_CMD_Q,SYS_PARAM),
@@ -330,11 +380,74 @@ namespace DRAMSim
 		}
 	}
 
+	void IniReader::SaveDeviceParams(DeviceParams &params)
+	{
+		params.clear();
+		for (size_t i=0; configMap[i].variablePtr != NULL; i++)
+		{
+			if (configMap[i].parameterType != DEV_PARAM)
+			{
+				continue;
+			}
+			switch (configMap[i].variableType)
+			{
+			case UINT:
+				params.push_back(*((unsigned *)configMap[i].variablePtr));
+				break;
+			case UINT64:
+				params.push_back(*((uint64_t *)configMap[i].variablePtr));
+				break;
+			case FLOAT:
+				params.push_back(*((float *)configMap[i].variablePtr));
+				break;
+			case BOOL:
+				params.push_back(*((bool *)configMap[i].variablePtr));
+				break;
+			case STRING:
+				ERROR("Device parameter "<<configMap[i].iniKey<<" is a string, only numeric device parameters can be saved");
+				exit(-1);
+			}
+		}
+	}
+
+	void IniReader::LoadDeviceParams(const DeviceParams &params)
+	{
+		size_t p = 0;
+		for (size_t i=0; configMap[i].variablePtr != NULL; i++)
+		{
+			if (configMap[i].parameterType != DEV_PARAM)
+			{
+				continue;
+			}
+			switch (configMap[i].variableType)
+			{
+			case UINT:
+				*((unsigned *)configMap[i].variablePtr) = (unsigned)params[p];
+				break;
+			case UINT64:
+				*((uint64_t *)configMap[i].variablePtr) = (uint64_t)params[p];
+				break;
+			case FLOAT:
+				*((float *)configMap[i].variablePtr) = (float)params[p];
+				break;
+			case BOOL:
+				*((bool *)configMap[i].variablePtr) = params[p] != 0;
+				break;
+			case STRING:
+				break;
+			}
+			p++;
+		}
+	}
+
+	IniReader::OverrideMap IniReader::appliedOverrides;
+
 	void IniReader::OverrideKeys(const OverrideMap *map)
 	{
 		if (!map)
 			return;
 
+		appliedOverrides = *map;
 		OverrideIterator it = map->begin();
 		DEBUG("Key overrides from command line:");
 		for (it=map->begin(); it != map->end(); it++)
@@ -346,6 +459,14 @@ namespace DRAMSim
 		}
 	}
 
+	void IniReader::ReapplyOverrides()
+	{
+		for (OverrideIterator it=appliedOverrides.begin(); it != appliedOverrides.end(); it++)
+		{
+			IniReader::SetKey(it->first, it->second);
+		}
+	}
+
 	bool IniReader::CheckIfAllSet()
 	{
 		// check to make sure all parameters that we exepected were set
@@ -432,9 +553,25 @@ namespace DRAMSim
 				DEBUG("ADDR SCHEME: 7");
 			}
 		}
+		else if (ADDRESS_MAPPING_SCHEME == "auto")
+		{
+			addressMappingScheme = SchemeAuto;
+			if (DEBUG_INI_READER)
+			{
+				DEBUG("ADDR SCHEME: auto");
+			}
+		}
+		else if (ADDRESS_MAPPING_SCHEME.find(':') != string::npos)
+		{
+			addressMappingScheme = SchemeCustom;
+			if (DEBUG_INI_READER)
+			{
+				DEBUG("ADDR SCHEME: "<<ADDRESS_MAPPING_SCHEME);
+			}
+		}
 		else
 		{
-			cout << "WARNING: unknown address mapping scheme '"<<ADDRESS_MAPPING_SCHEME<<"'; valid values are 'scheme1'...'scheme7'. Defaulting to scheme1"<<endl;
+			cout << "WARNING: unknown address mapping scheme '"<<ADDRESS_MAPPING_SCHEME<<"'; valid values are 'scheme1'...'scheme7', 'auto' or a field layout such as 'ch:ra:ba:ro:co'. Defaulting to scheme1"<<endl;
 			addressMappingScheme = Scheme1;
 		}
 
@@ -36,6 +36,7 @@
 #include <sstream>
 #include <string>
 #include <map> 
+#include <vector>
 #include "SystemConfiguration.h"
 
 
@@ -70,14 +71,24 @@ namespace DRAMSim
 		typedef map<string, string> OverrideMap;
 		typedef OverrideMap::const_iterator OverrideIterator;
 
+		// the values of all device parameters, in config map order
+		typedef vector<double> DeviceParams;
+
 		static void SetKey(string key, string value, size_t lineNumber = 0, IniType iniType = SYS_INI);
 		static void OverrideKeys(const OverrideMap *map);
+		// sets the keys of the last OverrideKeys again, e.g. over a device ini read after them
+		static void ReapplyOverrides();
 		static void ReadIniFile(string filename, IniType iniType = SYS_INI);
 		static void InitEnumsFromStrings();
 		static bool CheckIfAllSet();
 		static void WriteValuesOut(std::ofstream &visDataOut);
+		// copy the device parameters out of and back into their variables, so several devices can take turns
+		static void SaveDeviceParams(DeviceParams &params);
+		static void LoadDeviceParams(const DeviceParams &params);
 
 	private:
+		static OverrideMap appliedOverrides;
+
 		static void WriteParams(std::ofstream &visDataOut, ParamType t);
 		static void Trim(string &str);
 	};
@@ -0,0 +1,136 @@
+#include "MappingSelector.h"
+#include "PrintMacros.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	MappingSelector::MappingSelector()
+	{
+		// the hashes need the bit layout, i.e. power of two counts
+		bool hashable = isPowerOfTwo(NUM_CHANS) && isPowerOfTwo(NUM_RANKS) && isPowerOfTwo(NUM_BANKS) &&
+			isPowerOfTwo(NUM_ROWS) && isPowerOfTwo(NUM_COLS);
+		vector<string> hashes;
+		hashes.push_back("none");
+		if (hashable)
+		{
+			hashes.push_back("bank_xor");
+			if (NUM_CHANS > 1)
+			{
+				hashes.push_back("channel_xor");
+				hashes.push_back("channel_xor+bank_xor");
+			}
+		}
+
+		for (unsigned scheme=Scheme1; scheme<=Scheme7; scheme++)
+		{
+			for (size_t h=0; h<hashes.size(); h++)
+			{
+				Candidate candidate;
+				candidate.layout = AddressMapper::presetLayout((AddressMappingScheme)scheme);
+				candidate.hash = hashes[h];
+				candidates.push_back(candidate);
+			}
+		}
+	}
+
+
+	bool MappingSelector::fasterThan(const Candidate *a, const Candidate *b)
+	{
+		if (a->estimatedCycles != b->estimatedCycles)
+		{
+			return a->estimatedCycles < b->estimatedCycles;
+		}
+		return a->rowHitRate > b->rowHitRate;
+	}
+
+
+	void MappingSelector::select(string &layout, string &hash)
+	{
+		static const char *schemeNames[] = {"scheme1", "scheme2", "scheme3", "scheme4", "scheme5", "scheme6", "scheme7"};
+		vector<const Candidate *> ranking;
+
+		for (size_t i=0; i<candidates.size(); i++)
+		{
+			evaluate(candidates[i]);
+			ranking.push_back(&candidates[i]);
+		}
+		stable_sort(ranking.begin(), ranking.end(), fasterThan);
+
+		cout << "address mapping selection over " << samples.size() << " memory accesses:" << endl;
+		for (size_t i=0; i<ranking.size(); i++)
+		{
+			const Candidate &candidate = *ranking[i];
+			const char *name = "";
+			for (unsigned scheme=Scheme1; scheme<=Scheme7; scheme++)
+			{
+				if (candidate.layout == AddressMapper::presetLayout((AddressMappingScheme)scheme))
+				{
+					name = schemeNames[scheme];
+				}
+			}
+			cout << "    " << setw(2) << (i + 1) << ". " << name << " (" << candidate.layout << ") hash " << candidate.hash
+				<< "\t row hits: " << candidate.rowHitRate
+				<< "\t bank parallelism: " << candidate.bankParallelism
+				<< "\t channel balance: " << candidate.channelBalance
+				<< "\t estimated cycles: " << candidate.estimatedCycles << endl;
+		}
+
+		layout = ranking[0]->layout;
+		hash = ranking[0]->hash;
+	}
+
+
+	void MappingSelector::evaluate(Candidate &candidate)
+	{
+		static const unsigned NO_ROW = (unsigned)-1;
+		AddressMapper mapper(candidate.layout, candidate.hash);
+		unsigned banks = NUM_CHANS * NUM_RANKS * NUM_BANKS;
+		vector<unsigned> openRow(banks, NO_ROW);
+		vector<uint64_t> bankBusy(banks, 0);
+		vector<uint64_t> channelAccesses(NUM_CHANS, 0);
+		vector<uint64_t> bankWindow(banks, 0);  // last window each bank was counted in
+		unsigned window = max(TRANS_QUEUE_DEPTH, 1U);
+		uint64_t hits = 0;
+		uint64_t windowBanks = 0;
+
+		for (size_t i=0; i<samples.size(); i++)
+		{
+			unsigned chan, rank, bank, row, col;
+			mapper.map(samples[i], chan, rank, bank, row, col);
+			unsigned b = (chan * NUM_RANKS + rank) * NUM_BANKS + bank;
+
+			if (openRow[b] == row)
+			{
+				hits++;
+				bankBusy[b] += BL / 2;
+			}
+			else
+			{
+				bankBusy[b] += (openRow[b] == NO_ROW ? tRCD : tRC) + BL / 2;
+				openRow[b] = row;
+			}
+			channelAccesses[chan]++;
+
+			// windows are numbered from 1 so a bank's 0 means never counted
+			uint64_t w = i / window + 1;
+			if (bankWindow[b] != w)
+			{
+				bankWindow[b] = w;
+				windowBanks++;
+			}
+		}
+
+		uint64_t busiestBank = *max_element(bankBusy.begin(), bankBusy.end());
+		uint64_t busiestChannel = *max_element(channelAccesses.begin(), channelAccesses.end());
+		uint64_t windows = (samples.size() + window - 1) / window;
+		candidate.rowHitRate = samples.empty() ? 0 : (double)hits / samples.size();
+		candidate.bankParallelism = windows ? (double)windowBanks / windows : 0;
+		candidate.channelBalance = samples.empty() ? 0 : (double)busiestChannel * NUM_CHANS / samples.size();
+		candidate.estimatedCycles = max(busiestBank, busiestChannel * (BL / 2));
+	}
+}
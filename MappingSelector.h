@@ -0,0 +1,64 @@
+#ifndef MAPPINGSELECTOR_H
+#define MAPPINGSELECTOR_H
+
+#include "SystemConfiguration.h"
+#include "AddressMapping.h"
+
+#include <string>
+#include <vector>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	/*
+	 * Picks an address mapping (ADDRESS_MAPPING_SCHEME=auto) from a sample of
+	 * the addresses that go to memory, without simulating them.
+	 *
+	 * Every candidate, the seven schemes with and without the XOR hashes,
+	 * decodes the whole sample into an open row per bank:
+	 *   - the row hit rate counts accesses to the row their bank has open
+	 *   - bank level parallelism is the average number of distinct banks in
+	 *     each window of TRANS_QUEUE_DEPTH accesses
+	 *   - channel balance is the busiest channel's share over the mean share
+	 * The estimated time charges each bank BL/2 cycles for a row hit, tRCD
+	 * for opening a closed bank and tRC for a conflict. It charges each
+	 * channel BL/2 cycles of data bus per access. The estimate is the
+	 * busiest bank or channel, as if everything else overlapped with it.
+	 * The lowest estimate wins.
+	 *
+	 * The channels are taken as one interleave of the same geometry, so the
+	 * simulator does not pick a mapping for an NVM tier, a range mapped CXL
+	 * expander or channels of different devices.
+	 */
+	class MappingSelector
+	{
+	public:
+		MappingSelector();
+
+		void addSample(uint64_t address) {samples.push_back(address);}
+		size_t sampleCount() {return samples.size();}
+
+		// ranks the candidates, prints the ranking and returns the layout and hash of the best
+		void select(string &layout, string &hash);
+
+	private:
+		struct Candidate
+		{
+			string layout;
+			string hash;
+			double rowHitRate;
+			double bankParallelism;
+			double channelBalance;
+			uint64_t estimatedCycles;
+		};
+
+		vector<uint64_t> samples;
+		vector<Candidate> candidates;
+
+		void evaluate(Candidate &candidate);
+		static bool fasterThan(const Candidate *a, const Candidate *b);
+	};
+}
+
+#endif
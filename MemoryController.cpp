@@ -86,6 +86,11 @@ namespace DRAMSim
 
 		totalEpochLatency = vector<uint64_t> (NUM_RANKS*NUM_BANKS,0);
 
+		lastRowPerBank = vector<unsigned>(NUM_RANKS*NUM_BANKS,NO_ROW);
+		mappedPerBank = vector<uint64_t>(NUM_RANKS*NUM_BANKS,0);
+		rowHitsPerBank = vector<uint64_t>(NUM_RANKS*NUM_BANKS,0);
+		rowConflictsPerBank = vector<uint64_t>(NUM_RANKS*NUM_BANKS,0);
+
 		//staggers when each rank is due for a refresh
 		for (size_t i=0;i<NUM_RANKS;i++)
 		{
@@ -159,8 +164,6 @@ namespace DRAMSim
 
 	void MemoryController::updateCounter()
 	{
-		const uint64_t currentClockCycle = Simulator::clockDomainDRAM->clockcycle;
-
 		//check for outgoing command packets and handle countdowns
 		if (outgoingCmdPacket != NULL)
 		{
@@ -178,13 +181,12 @@ namespace DRAMSim
 			dataCyclesLeft--;
 			if (dataCyclesLeft == 0)
 			{
+				// the rank frees the packet once it has consumed it, so grab the address first
+				uint64_t writeAddress = outgoingDataPacket->physicalAddress;
 				(*ranks)[outgoingDataPacket->rank]->receiveFromBus(outgoingDataPacket);
 
 				//inform upper levels that a write is done
-				if (parentMemorySystem->WriteDataDone!=NULL)
-				{
-					(*parentMemorySystem->WriteDataDone)(channelID,outgoingDataPacket->physicalAddress, currentClockCycle);
-				}
+				parentMemorySystem->writeReturned(channelID, writeAddress);
 				outgoingDataPacket=NULL;
 			}
 		}
@@ -495,110 +497,120 @@ namespace DRAMSim
 
 	void MemoryController::updateTransQueue()
 	{
-		for (size_t i=0;i<transactionQueue.size();i++)
+		//demand transactions go first, a prefetch only gets the slot when no demand could be scheduled
+		for (unsigned pass=0;pass<2;pass++)
 		{
-			//pop off top transaction from queue
-			//
-			//	assuming simple scheduling at the moment
-			//	will eventually add policies here
-			Transaction *transaction = transactionQueue[i];
-			//add by libing -20120928
-		/*	Caches *myCaches;
-			myCaches=new Caches(NULL,4);
-			myCaches->access_cache(transaction->address, transaction->transactionType);
-			//add by libing -20120928
-*/
-			//map address to rank,bank,row,col
-			unsigned newChan, newRank, newBank, newRow, newColumn;
-
-			// pass these in as references so they get set by the addressMapping function
-			parentMemorySystem->addressMapping(transaction->address, newChan, newRank, newBank, newRow, newColumn);
-
-			//if we have room, break up the transaction into the appropriate commands
-			//and add them to the command queue
-			if (commandQueue.hasRoomFor(2, newRank, newBank))
+			for (size_t i=0;i<transactionQueue.size();i++)
 			{
-				/*if (DEBUG_ADDR_MAP)
+				//pop off top transaction from queue
+				//
+				//	assuming simple scheduling at the moment
+				//	will eventually add policies here
+				Transaction *transaction = transactionQueue[i];
+				if (transaction->isPrefetch != (pass == 1))
 				{
-					PRINTN("== New Transaction - Mapping Address [0x" << hex << transaction->address << dec << "]");
-					if (transaction->transactionType == Transaction::DATA_READ)
-					{
-						PRINT(" (Read)");
-					}
-					else
-					{
-						PRINT(" (Write)");
-					}
-					PRINT("Channel: " << newChan);
-					PRINT("  Rank : " << newRank);
-					PRINT("  Bank : " << newBank);
-					PRINT("  Row  : " << newRow);
-					PRINT(" Column: " << newColumn);
-					
-				}*///commented by libing 2013-4-22
-				if (DEBUG_ADDR_MAP)
+					continue;
+				}
+				//add by libing -20120928
+			/*	Caches *myCaches;
+				myCaches=new Caches(NULL,4);
+				myCaches->access_cache(transaction->address, transaction->transactionType);
+				//add by libing -20120928
+	*/
+				//map address to rank,bank,row,col
+				unsigned newChan, newRank, newBank, newRow, newColumn;
+
+				// pass these in as references so they get set by the addressMapping function
+				parentMemorySystem->addressMapping(transaction->mappedAddress, newChan, newRank, newBank, newRow, newColumn);
+
+				//if we have room, break up the transaction into the appropriate commands
+				//and add them to the command queue
+				if (commandQueue.hasRoomFor(2, newRank, newBank))
 				{
-					if (transaction->transactionType == Transaction::DATA_READ)
+					/*if (DEBUG_ADDR_MAP)
 					{
-						PRINT(" (Read)");
-					}
-					else
+						PRINTN("== New Transaction - Mapping Address [0x" << hex << transaction->address << dec << "]");
+						if (transaction->transactionType == Transaction::DATA_READ)
+						{
+							PRINT(" (Read)");
+						}
+						else
+						{
+							PRINT(" (Write)");
+						}
+						PRINT("Channel: " << newChan);
+						PRINT("  Rank : " << newRank);
+						PRINT("  Bank : " << newBank);
+						PRINT("  Row  : " << newRow);
+						PRINT(" Column: " << newColumn);
+					
+					}*///commented by libing 2013-4-22
+					if (DEBUG_ADDR_MAP)
 					{
-						PRINT(" (Write)");
+						if (transaction->transactionType == Transaction::DATA_READ)
+						{
+							PRINT(" (Read)");
+						}
+						else
+						{
+							PRINT(" (Write)");
+						}
 					}
-				}
 
 
-				//now that we know there is room in the command queue, we can remove from the transaction queue
-				transactionQueue.erase(transactionQueue.begin()+i);
+					//now that we know there is room in the command queue, we can remove from the transaction queue
+					transactionQueue.erase(transactionQueue.begin()+i);
+					parentMemorySystem->transactionScheduled(transaction);
+					countRowAccess(newRank, newBank, newRow);
 
-				//create activate command to the row we just translated
-				BusPacket *ACTcommand = new BusPacket(BusPacket::ACTIVATE,
-						newRank,
-						newBank,
-						newRow,
-						newColumn,
-						transaction->address,
-						transaction->data,
-						transaction->len);
+					//create activate command to the row we just translated
+					BusPacket *ACTcommand = new BusPacket(BusPacket::ACTIVATE,
+							newRank,
+							newBank,
+							newRow,
+							newColumn,
+							transaction->address,
+							transaction->data,
+							transaction->len);
 
-				//create read or write command and enqueue it
-				BusPacket::BusPacketType bpType = transaction->getBusPacketType();
-				BusPacket *command = new BusPacket(bpType,
-						newRank,
-						newBank,
-						newRow,
-						newColumn,
-						transaction->address,
-						transaction->data,
-						transaction->len);
+					//create read or write command and enqueue it
+					BusPacket::BusPacketType bpType = transaction->getBusPacketType();
+					BusPacket *command = new BusPacket(bpType,
+							newRank,
+							newBank,
+							newRow,
+							newColumn,
+							transaction->address,
+							transaction->data,
+							transaction->len);
 
 
 
-				commandQueue.enqueue(ACTcommand);
-				commandQueue.enqueue(command);
+					commandQueue.enqueue(ACTcommand);
+					commandQueue.enqueue(command);
 
-				// If we have a read, save the transaction so when the data comes back
-				// in a bus packet, we can staple it back into a transaction and return it
-				if (transaction->transactionType == Transaction::DATA_READ)
-				{
-					pendingReadTransactions.push_back(transaction);
+					// If we have a read, save the transaction so when the data comes back
+					// in a bus packet, we can staple it back into a transaction and return it
+					if (transaction->transactionType == Transaction::DATA_READ)
+					{
+						pendingReadTransactions.push_back(transaction);
+					}
+					else
+					{
+						// just delete the transaction now that it's a buspacket
+						delete transaction;
+					}
+					/* only allow one transaction to be scheduled per cycle -- this should
+					 * be a reasonable assumption considering how much logic would be
+					 * required to schedule multiple entries per cycle (parallel data
+					 * lines, switching logic, decision logic)
+					 */
+					return;
 				}
-				else
+				else // no room, do nothing this cycle
 				{
-					// just delete the transaction now that it's a buspacket
-					delete transaction;
+					//PRINT( "== Warning - No room in command queue" << endl;
 				}
-				/* only allow one transaction to be scheduled per cycle -- this should
-				 * be a reasonable assumption considering how much logic would be
-				 * required to schedule multiple entries per cycle (parallel data
-				 * lines, switching logic, decision logic)
-				 */
-				break;
-			}
-			else // no room, do nothing this cycle
-			{
-				//PRINT( "== Warning - No room in command queue" << endl;
 			}
 		}
 	}
@@ -723,7 +735,7 @@ namespace DRAMSim
 					//	}
 
 					unsigned chan,rank,bank,row,col;
-					parentMemorySystem->addressMapping(returnTransaction[0]->address,chan,rank,bank,row,col);
+					parentMemorySystem->addressMapping(pendingReadTransactions[i]->mappedAddress,chan,rank,bank,row,col);
 					insertHistogram(Simulator::clockDomainCPU->clockcycle - pendingReadTransactions[i]->timeAdded,rank,bank);
 					//return latency
 					if(DEBUG_ADDR_MAP)// //added by libing 2013-4-23
@@ -738,10 +750,7 @@ namespace DRAMSim
 						}
 						PRINT("  Bank : " <<bank<<"  issue  time:" << pendingReadTransactions[i]->timeAdded<<" return time:"<< Simulator::clockDomainDRAM->clockcycle); //added by libing 2013-4-23
 						}
-					if (parentMemorySystem->ReadDataDone!=NULL)
-					{
-						(*parentMemorySystem->ReadDataDone)(channelID, pendingReadTransactions[i]->address, Simulator::clockDomainDRAM->clockcycle);
-					}
+					parentMemorySystem->readReturned(channelID, pendingReadTransactions[i]->address);
 
 					delete pendingReadTransactions[i];
 					pendingReadTransactions.erase(pendingReadTransactions.begin()+i);
@@ -880,7 +889,7 @@ namespace DRAMSim
 	//allows outside source to make request of memory system
 	bool MemoryController::addTransaction(Transaction *trans)
 	{
-		if (transactionQueue.size() < TRANS_QUEUE_DEPTH)
+		if (willAcceptTransaction())
 		{
 			trans->timeAdded = Simulator::clockDomainCPU->clockcycle;
 			transactionQueue.push_back(trans);
@@ -893,6 +902,24 @@ namespace DRAMSim
 	}
 
 
+	//nothing waits to be scheduled: no queued transactions and no queued commands
+	bool MemoryController::isIdle()
+	{
+		if (!transactionQueue.empty())
+		{
+			return false;
+		}
+		for (size_t i=0;i<NUM_RANKS;i++)
+		{
+			if (!commandQueue.isEmpty(i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+
 	//prints statistics at the end of an epoch or  simulation
 	void MemoryController::printStats(bool finalStats)
 	{
@@ -1116,5 +1143,44 @@ namespace DRAMSim
 		latencies[(latencyValue/HISTOGRAM_BIN_SIZE)*HISTOGRAM_BIN_SIZE]++;
 	}
 
+	//a transaction to the open row of its bank is a hit, one to another row a conflict
+	void MemoryController::countRowAccess(unsigned rank, unsigned bank, unsigned row)
+	{
+		unsigned i = SEQUENTIAL(rank,bank);
+		mappedPerBank[i]++;
+		if (lastRowPerBank[i] == row)
+		{
+			rowHitsPerBank[i]++;
+		}
+		else if (lastRowPerBank[i] != NO_ROW)
+		{
+			rowConflictsPerBank[i]++;
+		}
+		lastRowPerBank[i] = row;
+	}
+
+	void MemoryController::printMappingStats()
+	{
+		uint64_t mapped = 0;
+		uint64_t hits = 0;
+		uint64_t conflicts = 0;
+		uint64_t busiest = 0;
+		unsigned banksUsed = 0;
+
+		for (size_t i=0; i<mappedPerBank.size(); i++)
+		{
+			mapped += mappedPerBank[i];
+			hits += rowHitsPerBank[i];
+			conflicts += rowConflictsPerBank[i];
+			busiest = max(busiest, mappedPerBank[i]);
+			banksUsed += mappedPerBank[i] > 0;
+		}
+		cout << "    channel " << channelID << ": transactions: " << mapped
+			<< "\t row hits: " << hits << " (" << (mapped ? (double)hits / mapped : 0) << ")"
+			<< "\t row conflicts: " << conflicts << " (" << (mapped ? (double)conflicts / mapped : 0) << ")"
+			<< "\t banks used: " << banksUsed << " of " << mappedPerBank.size()
+			<< "\t busiest bank: " << (mapped ? (double)busiest / mapped : 0) << " of the transactions" << endl;
+	}
+
 } // end of namespace DRAMSim
 
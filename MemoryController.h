@@ -61,9 +61,13 @@ namespace DRAMSim
 		virtual ~MemoryController();
 
 		bool addTransaction(Transaction *trans);
+		bool willAcceptTransaction() {return transactionQueue.size() < TRANS_QUEUE_DEPTH;}
+		unsigned getFreeSlots() {return willAcceptTransaction() ? TRANS_QUEUE_DEPTH - transactionQueue.size() : 0;}
+		bool isIdle();
 		void receiveFromBus(BusPacket *bpacket);
 		void update();
 		void printStats(bool finalStats = false);
+		void printMappingStats();
 
 
 		//fields
@@ -119,6 +123,13 @@ namespace DRAMSim
 		vector<uint64_t> totalWritesPerRank;
 		vector<uint64_t> totalEpochLatency;
 
+		// how the address mapping spreads the transactions: each bank's last row, and the
+		// transactions that go to the same row as the one before them in the bank or to another
+		vector<unsigned> lastRowPerBank;
+		vector<uint64_t> mappedPerBank;
+		vector<uint64_t> rowHitsPerBank;
+		vector<uint64_t> rowConflictsPerBank;
+
 		struct CmdStat
 		{
 			CmdStat()
@@ -168,6 +179,9 @@ namespace DRAMSim
 		void updatePower();
 		void updateReturnTrans();
 		void updatePrint();
+		void countRowAccess(unsigned rank, unsigned bank, unsigned row);
+
+		static const unsigned NO_ROW = (unsigned)-1;
 	};
 }
 
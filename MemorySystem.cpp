@@ -29,6 +29,9 @@
 *********************************************************************************/
 #include <errno.h> 
 #include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
 
 //#include "SystemConfiguration.h"
 #include "MemorySystem.h"
@@ -65,10 +68,51 @@ namespace DRAMSim
 	#endif
 #endif
 
+		activeDevice = NUM_CHANS;
+		mainClockCycle = 0;
+		interleaveCapacity = 0;
+		tierManager = NULL;
+		cxlLink = NULL;
+		if (NVM_CHANNELS > 0 && (NVM_CHANNELS >= NUM_CHANS || CHANNEL_DEVICE_INIS.empty()))
+		{
+			ERROR("NVM_CHANNELS="<<NVM_CHANNELS<<" needs DRAM channels in front of it and CHANNEL_DEVICE_INIS to give the NVM channels their device");
+			exit(-1);
+		}
+		if (CXL_CHANNELS > 0 && (CXL_CHANNELS >= NUM_CHANS || NVM_CHANNELS > 0))
+		{
+			ERROR("CXL_CHANNELS="<<CXL_CHANNELS<<" needs local channels in front of it and no NVM tier");
+			exit(-1);
+		}
+		if (CXL_CHANNELS > 0 && !CXL_MAPPING.empty() && CXL_MAPPING != "range" && CXL_MAPPING != "interleave")
+		{
+			ERROR("CXL_MAPPING must be range or interleave, got "<<CXL_MAPPING);
+			exit(-1);
+		}
+		if (!CHANNEL_DEVICE_INIS.empty())
+		{
+			loadChannelDevices();
+		}
+		else if (CXL_CHANNELS > 0)
+		{
+			// the range mapping lays the channels out by capacity
+			channelCapacity.assign(NUM_CHANS, (uint64_t)NUM_RANKS * NUM_BANKS * NUM_ROWS * NUM_COLS * (JEDEC_DATA_BUS_BITS / 8));
+		}
+
+		// an auto mapping is picked from the trace by the simulator once the memory system exists (see Simulator::selectAddressMapping)
+		addressMapper = NULL;
+		if (addressMappingScheme != SchemeAuto)
+		{
+			setAddressMapping(addressMappingScheme == SchemeCustom ? ADDRESS_MAPPING_SCHEME : AddressMapper::presetLayout(addressMappingScheme),
+					ADDRESS_HASH.empty() ? "none" : ADDRESS_HASH);
+		}
+
+		TOTAL_STORAGE = 0;
 		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
 		{
+			// the controller and ranks size themselves from the channel's device
+			useDevice(iChannel);
 			unsigned long megsOfStoragePerRank = ( (long long)DEVICE_WIDTH * NUM_COLS * NUM_ROWS * NUM_BANKS * NUM_DEVICES / 8) >> 20;
-			TOTAL_STORAGE = (NUM_RANKS * megsOfStoragePerRank);
+			TOTAL_STORAGE += (uint64_t)NUM_RANKS * megsOfStoragePerRank;
 
 			ranks.push_back(new vector<Rank *>());
 			memoryControllers.push_back(new MemoryController(this,ranks[iChannel],iChannel));
@@ -79,14 +123,56 @@ namespace DRAMSim
 			}
 
 			PRINTN("MemoryChannel "<<iChannel<<" :");
-			PRINT("CH. " <<iChannel<<" TOTAL_STORAGE : "<< TOTAL_STORAGE << "MB | "<<NUM_RANKS<<" Ranks | "<< NUM_DEVICES <<" Devices per rank");
+			PRINT("CH. " <<iChannel<<" STORAGE : "<< (NUM_RANKS * megsOfStoragePerRank) << "MB | "<<NUM_RANKS<<" Ranks | "<< NUM_DEVICES <<" Devices per rank");
+		}
+		useDevice(NUM_CHANS);
+		PRINT("TOTAL_STORAGE : "<<TOTAL_STORAGE<<"MB over "<<NUM_CHANS<<" channels");
+
+		if (NVM_CHANNELS > 0)
+		{
+			uint64_t tierBytes[2] = {0, 0};
+			for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+			{
+				tierBytes[iChannel >= NUM_CHANS - NVM_CHANNELS] += channelCapacity[iChannel];
+			}
+			tierManager = new TierManager(this, tierBytes[0], tierBytes[1]);
 		}
+		if (CXL_CHANNELS > 0)
+		{
+			cxlLink = new CxlLink(CXL_LINK_CREDITS, CxlLink::FLIT_BYTES / CXL_LINK_BANDWIDTH / tCK, CXL_LINK_LATENCY / tCK);
+			PRINT("CXL expander: last "<<CXL_CHANNELS<<" of "<<NUM_CHANS<<" channels | "<<CXL_LINK_BANDWIDTH<<"GB/s | "<<CXL_LINK_LATENCY<<"ns | "
+					<<CXL_LINK_CREDITS<<" credits | "<<(CXL_MAPPING == "interleave" ? "interleaved" : "after the local memory"));
+		}
+		for (unsigned target=Local; target<TARGETS; target++)
+		{
+			latencyCurves[target].windowBytes = 0;
+			latencyCurves[target].windowReads = 0;
+			latencyCurves[target].windowLatency = 0;
+		}
+
+		pendingTransactions.resize(NUM_CHANS);
+		migrationQueues.resize(NUM_CHANS);
+		expanderQueues.resize(NUM_CHANS);
+		pendingQueued.assign(NUM_CHANS, 0);
+		pendingFull.assign(NUM_CHANS, 0);
+		pendingOccupancy.assign(NUM_CHANS, 0);
+		pendingStalls.assign(NUM_CHANS, 0);
+		pendingMax.assign(NUM_CHANS, 0);
+		pendingCycles = 0;
+
+		mergeLookups = 0;
+		writesMerged = 0;
+		readsForwarded = 0;
+		readsCoalesced = 0;
+		mergeUntracked = 0;
+		mergeMax = 0;
 	}
 
 	MemorySystem::~MemorySystem()
 	{
 		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
 		{
+			useDevice(iChannel);
 			delete(memoryControllers[iChannel]);
 
 			vector<Rank *> *channelRank = ranks[iChannel];
@@ -96,6 +182,39 @@ namespace DRAMSim
 			}
 			channelRank->clear();
 		}
+		useDevice(NUM_CHANS);
+		for (size_t i=0; i<mergedCompletions.size(); i++)
+		{
+			delete mergedCompletions[i].trans;
+		}
+		for (size_t iChannel=0; iChannel<migrationQueues.size(); iChannel++)
+		{
+			for (size_t i=0; i<migrationQueues[iChannel].size(); i++)
+			{
+				delete migrationQueues[iChannel][i];
+			}
+		}
+		delete tierManager;
+		for (size_t iChannel=0; iChannel<expanderQueues.size(); iChannel++)
+		{
+			for (size_t i=0; i<expanderQueues[iChannel].size(); i++)
+			{
+				delete expanderQueues[iChannel][i];
+			}
+		}
+		delete cxlLink;
+		for (map<uint64_t, MergeEntry>::iterator it=mergeBuffer.begin(); it!=mergeBuffer.end(); it++)
+		{
+			for (size_t i=0; i<it->second.coalesced.size(); i++)
+			{
+				delete it->second.coalesced[i];
+			}
+		}
+		delete addressMapper;
+		for (size_t iChannel=0; iChannel<channelMappers.size(); iChannel++)
+		{
+			delete channelMappers[iChannel];
+		}
 
 		if (VERIFICATION_OUTPUT)
 		{
@@ -106,399 +225,866 @@ namespace DRAMSim
 
 	void MemorySystem::update()
 	{
+		// what the merge buffer answered last cycle
+		while (!mergedCompletions.empty())
+		{
+			MergedCompletion done = mergedCompletions.front();
+			mergedCompletions.pop_front();
+			if (done.trans->transactionType == Transaction::DATA_WRITE)
+			{
+				reportWrite(done.channel, done.trans->address);
+			}
+			else
+			{
+				reportRead(done.channel, done.trans->address);
+			}
+			delete done.trans;
+		}
+
+		if (tierManager != NULL)
+		{
+			tierManager->update();
+		}
+
+		pendingCycles++;
+		if (cxlLink != NULL)
+		{
+			vector<CxlLink::Message> requests, responses;
+			cxlLink->update(requests, responses);
+			for (size_t i=0; i<requests.size(); i++)
+			{
+				expanderQueues[requests[i].channel].push_back(requests[i].trans);
+			}
+			for (size_t i=0; i<responses.size(); i++)
+			{
+				if (responses[i].isWrite)
+				{
+					writeDone(responses[i].channel, responses[i].address);
+				}
+				else
+				{
+					readDone(responses[i].channel, responses[i].address);
+				}
+			}
+			if (pendingCycles % LATENCY_WINDOW == 0)
+			{
+				closeLatencyWindow();
+			}
+		}
+
 		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
 		{
-			for (size_t iRank=0;iRank<NUM_RANKS;iRank++)
+			if (channelDevices.empty())
+			{
+				updateChannel(iChannel);
+			}
+			else
 			{
-				(*ranks[iChannel])[iRank]->update();
+				// a slower channel skips some cycles, a faster one runs more than one
+				useDevice(iChannel);
+				channelClockCredit[iChannel] += channelClockRatio[iChannel];
+				while (channelClockCredit[iChannel] >= 1.0)
+				{
+					channelClockCredit[iChannel] -= 1.0;
+					updateChannel(iChannel);
+					Simulator::clockDomainDRAM->clockcycle = ++channelCycles[iChannel];
+				}
 			}
 
-			if (pendingTransactions.size() > 0)
+			deque<Transaction *> &pending = pendingTransactions[iChannel];
+			if (!pending.empty())
 			{
-				unsigned channelNum = findChannelNumber(pendingTransactions.front()->address);
-				if (channelNum == iChannel && memoryControllers[iChannel]->addTransaction(pendingTransactions.front()))
+				pendingStalls[iChannel]++;
+				pendingOccupancy[iChannel] += pending.size();
+				if (pending.size() >= PENDING_QUEUE_DEPTH)
 				{
-					pendingTransactions.pop_front();
+					pendingFull[iChannel]++;
 				}
 			}
-			memoryControllers[iChannel]->update();
 		}
+		useDevice(NUM_CHANS);
 	}
 
-	unsigned MemorySystem::findChannelNumber(uint64_t addr)
+
+	// one cycle of the channel's own clock
+	void MemorySystem::updateChannel(unsigned iChannel)
 	{
-		// Single channel case is a trivial shortcut case
-		if (NUM_CHANS == 1)
+		for (size_t iRank=0;iRank<NUM_RANKS;iRank++)
 		{
-			return 0;
+			(*ranks[iChannel])[iRank]->update();
 		}
 
-		if (!isPowerOfTwo(NUM_CHANS))
+		// the expander moves the requests the link brought on to its controller, which frees their credits
+		deque<Transaction *> &arrived = expanderQueues[iChannel];
+		while (!arrived.empty() && memoryControllers[iChannel]->addTransaction(arrived.front()))
 		{
-			ERROR("We can only support power of two # of channels.\n" <<
-					"I don't know what Intel was thinking, but trying to address map half a bit is a neat trick that we're not sure how to do");
-			abort();
+			arrived.pop_front();
+			cxlLink->returnCredit();
 		}
 
-		// only chan is used from this set
-		unsigned iChannel,rank,bank,row,column;
-		addressMapping(addr,iChannel,rank,bank,row,column);
-		if (iChannel >= NUM_CHANS)
+		// hand the controller (or the link) as many of its waiting transactions as it has room for
+		deque<Transaction *> &pending = pendingTransactions[iChannel];
+		while (!pending.empty() && acceptTransaction(iChannel, pending.front()))
 		{
-			ERROR("Got channel index "<<iChannel<<" but only "<<NUM_CHANS<<" exist");
-			abort();
+			pending.pop_front();
 		}
-		//DEBUG("Channel idx = "<<channelNumber<<" totalbits="<<totalBits<<" channelbits="<<channelBits);
+		// one migration copy a cycle, and only when no demand waits
+		deque<Transaction *> &migration = migrationQueues[iChannel];
+		if (pending.empty() && !migration.empty() && acceptTransaction(iChannel, migration.front()))
+		{
+			migration.pop_front();
+		}
+		memoryControllers[iChannel]->update();
+	}
 
-		return iChannel;
+
+	void MemorySystem::loadChannelDevices()
+	{
+		vector<string> names;
+		string name;
+		istringstream in(CHANNEL_DEVICE_INIS);
+		while (getline(in, name, ':'))
+		{
+			names.push_back(name);
+		}
+		if (CHANNEL_DEVICE_INIS[CHANNEL_DEVICE_INIS.length() - 1] == ':')
+		{
+			names.push_back("");
+		}
+		if (names.empty() || NUM_CHANS % names.size() != 0)
+		{
+			ERROR("CHANNEL_DEVICE_INIS gives "<<names.size()<<" device inis, the "<<NUM_CHANS<<" channels cannot be split evenly between them");
+			exit(-1);
+		}
+
+		IniReader::SaveDeviceParams(mainDevice);
+		unsigned mainBL = BL;
+		float mainTCK = tCK;
+		map<string, IniReader::DeviceParams> loaded;
+		channelDevices.resize(NUM_CHANS);
+		channelCapacity.resize(NUM_CHANS);
+		channelClockRatio.resize(NUM_CHANS);
+		channelClockCredit.assign(NUM_CHANS, 0.0);
+		channelCycles.assign(NUM_CHANS, 0);
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+		{
+			// consecutive channels share an entry
+			const string &file = names[iChannel * names.size() / NUM_CHANS];
+			if (file.empty())
+			{
+				channelDevices[iChannel] = mainDevice;
+			}
+			else
+			{
+				map<string, IniReader::DeviceParams>::iterator it = loaded.find(file);
+				if (it == loaded.end())
+				{
+					// keys the channel ini leaves out keep the main device's values, the command line still wins
+					IniReader::LoadDeviceParams(mainDevice);
+					IniReader::ReadIniFile(file, IniReader::DEV_INI);
+					IniReader::ReapplyOverrides();
+					IniReader::SaveDeviceParams(loaded[file]);
+					it = loaded.find(file);
+				}
+				channelDevices[iChannel] = it->second;
+			}
+
+			IniReader::LoadDeviceParams(channelDevices[iChannel]);
+			if (BL != mainBL)
+			{
+				ERROR("Channel "<<iChannel<<" has a burst length of "<<BL<<", the transaction size needs every channel at the main device's "<<mainBL);
+				exit(-1);
+			}
+			channelCapacity[iChannel] = (uint64_t)NUM_RANKS * NUM_BANKS * NUM_ROWS * NUM_COLS * (JEDEC_DATA_BUS_BITS / 8);
+			channelClockRatio[iChannel] = mainTCK / tCK;
+			PRINT("Channel "<<iChannel<<" device: "<<(file.empty() ? "main device ini" : file)<<" | tCK "<<tCK<<"ns | "<<(channelCapacity[iChannel] >> 20)<<"MB");
+		}
+		IniReader::LoadDeviceParams(mainDevice);
 	}
 
-	bool MemorySystem::addTransaction(Transaction *trans)
+
+	void MemorySystem::useDevice(unsigned iChannel)
 	{
-		unsigned iChannel = findChannelNumber(trans->address);
+		if (channelDevices.empty() || iChannel == activeDevice)
+		{
+			return;
+		}
+		IniReader::LoadDeviceParams(iChannel == NUM_CHANS ? mainDevice : channelDevices[iChannel]);
+#ifdef DATA_RELIABILITY_ECC
+		NUM_DEVICES = ECC_DATA_BUS_BITS / DEVICE_WIDTH;
+#else
+		NUM_DEVICES = JEDEC_DATA_BUS_BITS / DEVICE_WIDTH;
+#endif
+		// the controller and ranks time everything with the DRAM clock, so it shows the channel's own cycles
+		if (Simulator::clockDomainDRAM != NULL)
+		{
+			if (activeDevice == NUM_CHANS)
+			{
+				mainClockCycle = Simulator::clockDomainDRAM->clockcycle;
+			}
+			Simulator::clockDomainDRAM->clockcycle = iChannel == NUM_CHANS ? mainClockCycle : channelCycles[iChannel];
+		}
+		activeDevice = iChannel;
+	}
+
+
+	bool MemorySystem::interleavesByCapacity()
+	{
+		unsigned banks = NUM_BANKS, rows = NUM_ROWS, cols = NUM_COLS;
+		bool sameGeometry = true;
+		for (size_t iChannel=0; iChannel<channelDevices.size(); iChannel++)
+		{
+			useDevice(iChannel);
+			sameGeometry = sameGeometry && NUM_BANKS == banks && NUM_ROWS == rows && NUM_COLS == cols;
+		}
+		useDevice(NUM_CHANS);
+		bool cxlRange = CXL_CHANNELS > 0 && CXL_MAPPING != "interleave";
+		return !sameGeometry || NVM_CHANNELS > 0 || cxlRange;
+	}
+
+
+	void MemorySystem::buildInterleave(const string &layout, const string &hash)
+	{
+		for (size_t iChannel=0; iChannel<channelMappers.size(); iChannel++)
+		{
+			delete channelMappers[iChannel];
+		}
+		channelMappers.clear();
+		interleaveRegions.clear();
+		interleaveCapacity = 0;
+
+		if (!interleavesByCapacity())
+		{
+			return;
+		}
+
+		// every channel decodes its own addresses, the layout without the channel field
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+		{
+			useDevice(iChannel);
+			channelMappers.push_back(new AddressMapper(layout, hash, 1));
+		}
+		useDevice(NUM_CHANS);
+
+		// the NVM tier, or a range mapped expander, goes after the local channels
+		bool cxlRange = CXL_CHANNELS > 0 && CXL_MAPPING != "interleave";
+		unsigned behind = NVM_CHANNELS > 0 ? NVM_CHANNELS : cxlRange ? CXL_CHANNELS : 0;
+		addInterleaveRegions(0, NUM_CHANS - behind);
+		addInterleaveRegions(NUM_CHANS - behind, NUM_CHANS);
+
+		PRINT("Channels interleaved by capacity:");
+		for (size_t r=0; r<interleaveRegions.size(); r++)
+		{
+			const InterleaveRegion &region = interleaveRegions[r];
+			PRINTN("    "<<(region.start >> 20)<<"MB to "<<(region.end >> 20)<<"MB over channels");
+			for (size_t i=0; i<region.channels.size(); i++)
+			{
+				PRINTN(" "<<region.channels[i]);
+			}
+			PRINT(" every "<<region.granularity<<" bytes");
+		}
+	}
+
+
+	// interleaves the channels [first, last) by capacity after the regions there are
+	void MemorySystem::addInterleaveRegions(unsigned first, unsigned last)
+	{
+		vector<uint64_t> levels(channelCapacity.begin() + first, channelCapacity.begin() + last);
+		sort(levels.begin(), levels.end());
+		levels.erase(unique(levels.begin(), levels.end()), levels.end());
+		uint64_t previous = 0;
+		for (size_t l=0; l<levels.size(); l++)
+		{
+			InterleaveRegion region;
+			for (unsigned iChannel=first; iChannel<last; iChannel++)
+			{
+				if (channelCapacity[iChannel] >= levels[l])
+				{
+					region.channels.push_back(iChannel);
+				}
+			}
+			region.start = interleaveCapacity;
+			region.end = interleaveCapacity + (levels[l] - previous) * region.channels.size();
+			region.channelStart = previous;
+			region.granularity = addressMapper->interleaveBytes(AddressMapper::Channel);
+			while ((levels[l] - previous) % region.granularity != 0)
+			{
+				region.granularity >>= 1;
+			}
+			interleaveRegions.push_back(region);
+			interleaveCapacity = region.end;
+			previous = levels[l];
+		}
+	}
+
 
+	// the channel of the address and the address inside it, addresses past the capacity wrap around
+	uint64_t MemorySystem::channelAddress(uint64_t physicalAddress, unsigned &channel) const
+	{
+		uint64_t address = physicalAddress % interleaveCapacity;
+		size_t r = 0;
+		while (address >= interleaveRegions[r].end)
+		{
+			r++;
+		}
+		const InterleaveRegion &region = interleaveRegions[r];
+		uint64_t offset = address - region.start;
+		uint64_t chunk = offset / region.granularity;
+		channel = region.channels[chunk % region.channels.size()];
+		return region.channelStart + (chunk / region.channels.size()) * region.granularity + offset % region.granularity;
+	}
+
+	// queues trans behind the ones already waiting for its channel, false if that queue is full
+	bool MemorySystem::enqueuePending(unsigned iChannel, Transaction *trans)
+	{
+		deque<Transaction *> &pending = pendingTransactions[iChannel];
+		if (pending.size() >= PENDING_QUEUE_DEPTH)
+		{
+			return false;
+		}
+		pending.push_back(trans);
+		pendingQueued[iChannel]++;
+		if (pending.size() > pendingMax[iChannel])
+		{
+			pendingMax[iChannel] = pending.size();
+		}
+		return true;
+	}
+
+
+	// hands trans to its channel, or to the queue in front of it
+	bool MemorySystem::sendTransaction(unsigned iChannel, Transaction *trans)
+	{
 #ifdef MS_BUFFER
-		if (memoryControllers[iChannel]->addTransaction(trans))
+		// nothing overtakes the transactions already waiting for the channel
+		if (pendingTransactions[iChannel].empty() && acceptTransaction(iChannel, trans))
 		{
 			return true;
 		}
+		else if (trans->isPrefetch)
+		{
+			// a prefetch is only worth sending while the controller has room for it
+			return false;
+		}
 		else
 		{
-			pendingTransactions.push_back(trans);
-			return true;
+			return enqueuePending(iChannel, trans);
 		}
 #else
-		return memoryControllers[iChannel]->addTransaction(trans);
+		return acceptTransaction(iChannel, trans);
 #endif
 	}
 
 
+	bool MemorySystem::acceptTransaction(unsigned iChannel, Transaction *trans)
+	{
+		if (cxlLink != NULL && isExpander(iChannel))
+		{
+			return cxlLink->sendRequest(iChannel, trans);
+		}
+		return memoryControllers[iChannel]->addTransaction(trans);
+	}
+
+
+	unsigned MemorySystem::acceptSlots(unsigned iChannel)
+	{
+		if (cxlLink != NULL && isExpander(iChannel))
+		{
+			return cxlLink->getCredits();
+		}
+		return memoryControllers[iChannel]->getFreeSlots();
+	}
+
+
+	bool MemorySystem::addTransaction(Transaction *trans)
+	{
+		if (tierManager != NULL)
+		{
+			tierManager->place(trans->address);
+		}
+		// translated once, a migration later on moves the page but not what is already queued
+		trans->mappedAddress = mapAddress(trans->address);
+		unsigned iChannel = mappedChannel(trans->mappedAddress);
+
+		if (MERGE_BUFFER_ENTRIES == 0 || !mergeTransaction(iChannel, trans))
+		{
+			if (!sendTransaction(iChannel, trans))
+			{
+				return false;
+			}
+			if (MERGE_BUFFER_ENTRIES > 0)
+			{
+				trackTransaction(trans);
+			}
+			if (cxlLink != NULL && trans->transactionType != Transaction::DATA_WRITE)
+			{
+				readStarted(trans->address);
+			}
+		}
+		if (tierManager != NULL)
+		{
+			tierManager->countAccess(trans->address);
+		}
+		return true;
+	}
+
+
 	bool MemorySystem::addTransaction(bool isWrite, uint64_t addr)
 	{
-		unsigned iChannel = findChannelNumber(addr);
 		Transaction::TransactionType type = isWrite ? Transaction::DATA_WRITE : Transaction::DATA_READ;
 		Transaction *trans = new Transaction(type,addr,NULL,LEN_DEF,Simulator::clockDomainCPU->clockcycle);
 
-		// push_back in memoryController will make a copy of this during
-		// addTransaction so it's kosher for the reference to be local
+		if (!addTransaction(trans))
+		{
+			delete trans;
+			return false;
+		}
+		return true;
+	}
+
 
+	unsigned MemorySystem::channelCredits(unsigned iChannel)
+	{
 #ifdef MS_BUFFER
-		if (memoryControllers[iChannel]->addTransaction(trans))
+		size_t pending = pendingTransactions[iChannel].size();
+		if (pending > 0)
+		{
+			return pending < PENDING_QUEUE_DEPTH ? PENDING_QUEUE_DEPTH - pending : 0;
+		}
+		return acceptSlots(iChannel) + PENDING_QUEUE_DEPTH;
+#else
+		return acceptSlots(iChannel);
+#endif
+	}
+
+
+	unsigned MemorySystem::getFreeSlots()
+	{
+		unsigned fewest = channelCredits(0);
+		for (size_t iChannel=1; iChannel<NUM_CHANS; iChannel++)
 		{
+			fewest = min(fewest, channelCredits(iChannel));
+		}
+		return fewest;
+	}
+
+
+	unsigned MemorySystem::getFreeSlots(uint64_t addr)
+	{
+		return channelCredits(findChannelNumber(addr));
+	}
+
+
+	bool MemorySystem::willAcceptTransaction()
+	{
+		return getFreeSlots() > 0;
+	}
+
+
+	bool MemorySystem::willAcceptTransaction(uint64_t addr)
+	{
+		return getFreeSlots(addr) > 0;
+	}
+
+
+	// true if trans was merged into what the buffer tracks for its line
+	bool MemorySystem::mergeTransaction(unsigned iChannel, Transaction *trans)
+	{
+		map<uint64_t, MergeEntry>::iterator it = mergeBuffer.find(trans->address / TRANS_DATA_BYTES);
+		if (it == mergeBuffer.end() || trans->data != NULL || trans->len != LEN_DEF)
+		{
+			return false;
+		}
+
+		MergeEntry &entry = it->second;
+		if (trans->transactionType == Transaction::DATA_WRITE)
+		{
+			if (entry.write == NULL || entry.write->data != NULL)
+			{
+				return false;
+			}
+			// one burst writes the whole line, the newer bytes win
+			entry.write->len = LEN_DEF;
+			writesMerged++;
+		}
+		else if (entry.write != NULL && entry.write->len == LEN_DEF)
+		{
+			readsForwarded++;
+		}
+		else if (entry.reads > 0 && entry.write == NULL && !entry.partialReads)
+		{
+			entry.coalesced.push_back(trans);
+			readsCoalesced++;
+			mergeLookups++;
 			return true;
 		}
 		else
 		{
-			pendingTransactions.push_back(trans);
-			return true;
+			return false;
 		}
-#else
-		return memoryControllers[iChannel]->addTransaction(trans);
-#endif
+
+		MergedCompletion done = {iChannel, trans};
+		mergedCompletions.push_back(done);
+		mergeLookups++;
+		return true;
 	}
 
 
-	void MemorySystem::printStats()
+	// starts tracking a transaction that went to its channel
+	void MemorySystem::trackTransaction(Transaction *trans)
 	{
-		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+		mergeLookups++;
+		uint64_t line = trans->address / TRANS_DATA_BYTES;
+		map<uint64_t, MergeEntry>::iterator it = mergeBuffer.find(line);
+		if (it == mergeBuffer.end())
 		{
-			PRINT("==== Channel ["<<iChannel<<"] ====");
-			memoryControllers[iChannel]->printStats(true);
-			PRINT("//// Channel ["<<iChannel<<"] ////");
+			if (mergeBuffer.size() >= MERGE_BUFFER_ENTRIES)
+			{
+				mergeUntracked++;
+				return;
+			}
+			it = mergeBuffer.insert(make_pair(line, MergeEntry())).first;
+			mergeMax = max(mergeMax, mergeBuffer.size());
+		}
+
+		if (trans->transactionType == Transaction::DATA_WRITE)
+		{
+			// a write the buffer could not merge replaces the older one
+			it->second.write = trans;
+		}
+		else
+		{
+			it->second.reads++;
+			it->second.partialReads = it->second.partialReads || trans->len != LEN_DEF;
 		}
 	}
 
 
-	void MemorySystem::registerCallbacks( TransactionCompleteCB* readCB, TransactionCompleteCB* writeCB,
-										  void (*reportPower)(double bgpower, double burstpower, double refreshpower, double actprepower))
+	void MemorySystem::transactionScheduled(Transaction *trans)
 	{
-		ReadDataDone = readCB;
-		WriteDataDone = writeCB;
-		ReportPower = reportPower;
+		if (tierManager != NULL && !(trans->address & TierManager::FRAME_BIT))
+		{
+			tierManager->transferScheduled(trans->mappedAddress, trans->transactionType == Transaction::DATA_WRITE);
+		}
+		if (mergeBuffer.empty() || trans->transactionType != Transaction::DATA_WRITE)
+		{
+			return;
+		}
+		map<uint64_t, MergeEntry>::iterator it = mergeBuffer.find(trans->address / TRANS_DATA_BYTES);
+		if (it != mergeBuffer.end() && it->second.write == trans)
+		{
+			// from now on it is on its way to the ranks and cannot take more data
+			it->second.write = NULL;
+			releaseEntry(it);
+		}
 	}
 
-	void MemorySystem::addressMapping(
-			uint64_t physicalAddress,
-			unsigned &chan,
-			unsigned &rank,
-			unsigned &bank,
-			unsigned &row,
-			unsigned &col)
-	{
-		uint64_t tempA, tempB;
-
-		uint64_t transactionMask =  TRANS_DATA_BYTES - 1; //ex: (64 bit bus width) x (8 Burst Length) - 1 = 64 bytes - 1 = 63 = 0x3f mask
-		unsigned  channelBitWidth = dramsim_log2(NUM_CHANS);
-		unsigned	 rankBitWidth = dramsim_log2(NUM_RANKS);
-		unsigned	 bankBitWidth = dramsim_log2(NUM_BANKS);
-		unsigned	  rowBitWidth = dramsim_log2(NUM_ROWS);
-		unsigned	  colBitWidth = dramsim_log2(NUM_COLS);
-		// this forces the alignment to the width of a single burst (64 bits = 8 bytes = 3 address bits for DDR parts)
-		unsigned	byteOffsetWidth = dramsim_log2((JEDEC_DATA_BUS_BITS/8));
-		// Since we're assuming that a request is for BL*BUS_WIDTH, the bottom bits
-		// of this address *should* be all zeros if it's not, issue a warning
-
-		if ((physicalAddress & transactionMask) != 0)
-		{
-			DEBUG("WARNING: address 0x"<<std::hex<<physicalAddress<<std::dec<<" is not aligned to the request size of "<<TRANS_DATA_BYTES);
-		}
-
-		// each burst will contain JEDEC_DATA_BUS_BITS/8 bytes of data, so the bottom bits (3 bits for a single channel DDR system) are
-		// 	thrown away before mapping the other bits
-		physicalAddress >>= byteOffsetWidth;
-
-		// The next thing we have to consider is that when a request is made for a
-		// we've taken into account the granulaity of a single burst by shifting
-		// off the bottom 3 bits, but a transaction has to take into account the
-		// burst length (i.e. the requests will be aligned to cache line sizes which
-		// should be equal to transactionSize above).
-		//
-		// Since the column address increments internally on bursts, the bottom n
-		// bits of the column (colLow) have to be zero in order to account for the
-		// total size of the transaction. These n bits should be shifted off the
-		// address and also subtracted from the total column width.
-		//
-		// I am having a hard time explaining the reasoning here, but it comes down
-		// this: for a 64 byte transaction, the bottom 6 bits of the address must be
-		// zero. These zero bits must be made up of the byte offset (3 bits) and also
-		// from the bottom bits of the column
-		//
-		// For example: cowLowBits = log2(64bytes) - 3 bits = 3 bits
-		unsigned colLowBitWidth = dramsim_log2(TRANS_DATA_BYTES) - byteOffsetWidth;
-
-		physicalAddress >>= colLowBitWidth;
-		unsigned colHighBitWidth = colBitWidth - colLowBitWidth;
-		/*if (DEBUG_ADDR_MAP)
-		{
-			DEBUG("Bit widths: channel:"<<channelBitWidth<<
-							 " rank:"<<rankBitWidth<<
-							 " bank:"<<bankBitWidth<<
-							 " row:"<<rowBitWidth<<
-							 " colLow:"<<colLowBitWidth<<
-							 " colHigh:"<<colHighBitWidth<<
-							 " off:"<<byteOffsetWidth<<
-							 " Total:"<< (channelBitWidth + rankBitWidth + bankBitWidth + rowBitWidth + colLowBitWidth + colHighBitWidth + byteOffsetWidth));
-		}*///commented by libing 2013-4-22
-
-		//perform various address mapping schemes
-		if (addressMappingScheme == Scheme1)
-		{
-			//chan:rank:row:col:bank
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
-		}
-		else if (addressMappingScheme == Scheme2)
-		{
-			//chan:row:col:bank:rank
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
-
-		}
-		else if (addressMappingScheme == Scheme3)
-		{
-			//chan:rank:bank:col:row
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
-
-		}
-		else if (addressMappingScheme == Scheme4)
-		{
-			//chan:rank:bank:row:col
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
-
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
+	void MemorySystem::readReturned(unsigned iChannel, uint64_t address)
+	{
+		if (cxlLink != NULL && isExpander(iChannel))
+		{
+			cxlLink->sendResponse(iChannel, address, false);
+			return;
+		}
+		readDone(iChannel, address);
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
 
+	void MemorySystem::writeReturned(unsigned iChannel, uint64_t address)
+	{
+		if (cxlLink != NULL && isExpander(iChannel))
+		{
+			cxlLink->sendResponse(iChannel, address, true);
+			return;
+		}
+		writeDone(iChannel, address);
+	}
+
+
+	void MemorySystem::readDone(unsigned iChannel, uint64_t address)
+	{
+		if (tierManager != NULL)
+		{
+			if (address & TierManager::FRAME_BIT)
+			{
+				tierManager->copyDone(address, false);
+				return;
+			}
+		}
+		if (cxlLink != NULL)
+		{
+			transferred(iChannel, address, false);
+		}
+		reportRead(iChannel, address);
+
+		if (mergeBuffer.empty())
+		{
+			return;
+		}
+		map<uint64_t, MergeEntry>::iterator it = mergeBuffer.find(address / TRANS_DATA_BYTES);
+		if (it == mergeBuffer.end())
+		{
+			return;
+		}
+
+		// a read sent before the line was tracked also brings the data
+		MergeEntry &entry = it->second;
+		if (entry.reads > 0)
+		{
+			entry.reads--;
 		}
-		else if (addressMappingScheme == Scheme5)
+		for (size_t i=0; i<entry.coalesced.size(); i++)
 		{
-			//chan:row:col:rank:bank
+			reportRead(iChannel, entry.coalesced[i]->address);
+			delete entry.coalesced[i];
+		}
+		entry.coalesced.clear();
+		releaseEntry(it);
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
+	void MemorySystem::writeDone(unsigned iChannel, uint64_t address)
+	{
+		if (tierManager != NULL)
+		{
+			if (address & TierManager::FRAME_BIT)
+			{
+				tierManager->copyDone(address, true);
+				return;
+			}
+		}
+		if (cxlLink != NULL)
+		{
+			transferred(iChannel, address, true);
+		}
+		reportWrite(iChannel, address);
+	}
+
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
+	void MemorySystem::readStarted(uint64_t address)
+	{
+		readStarts[address].push_back(pendingCycles);
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
+	// counts the data towards its target's bandwidth, and a read's latency
+	void MemorySystem::transferred(unsigned iChannel, uint64_t address, bool isWrite)
+	{
+		LatencyCurve &curve = latencyCurves[isExpander(iChannel) ? Expander : Local];
+		curve.windowBytes += TRANS_DATA_BYTES;
+		if (isWrite)
+		{
+			return;
+		}
+		map<uint64_t, deque<uint64_t> >::iterator it = readStarts.find(address);
+		if (it == readStarts.end())
+		{
+			return;  // a read the memory system took before the counting
+		}
+		curve.windowReads++;
+		curve.windowLatency += pendingCycles - it->second.front();
+		it->second.pop_front();
+		if (it->second.empty())
+		{
+			readStarts.erase(it);
+		}
+	}
 
 
+	void MemorySystem::closeLatencyWindow()
+	{
+		for (unsigned target=Local; target<TARGETS; target++)
+		{
+			LatencyCurve &curve = latencyCurves[target];
+			// bytes per ns are GB/s
+			unsigned bandwidth = (unsigned)(curve.windowBytes / (LATENCY_WINDOW * tCK));
+			map<unsigned, LatencyBin>::iterator it = curve.bins.find(bandwidth);
+			if (it == curve.bins.end())
+			{
+				LatencyBin empty = {0, 0, 0};
+				it = curve.bins.insert(make_pair(bandwidth, empty)).first;
+			}
+			it->second.windows++;
+			it->second.reads += curve.windowReads;
+			it->second.latency += curve.windowLatency;
+			curve.windowBytes = 0;
+			curve.windowReads = 0;
+			curve.windowLatency = 0;
 		}
-		else if (addressMappingScheme == Scheme6)
+	}
+
+
+	void MemorySystem::reportRead(unsigned iChannel, uint64_t address)
+	{
+		if (ReadDataDone != NULL)
 		{
-			//chan:row:bank:rank:col
+			(*ReadDataDone)(iChannel, address, Simulator::clockDomainDRAM->clockcycle);
+		}
+	}
+
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
+	void MemorySystem::reportWrite(unsigned iChannel, uint64_t address)
+	{
+		if (WriteDataDone != NULL)
+		{
+			(*WriteDataDone)(iChannel, address, Simulator::clockDomainDRAM->clockcycle);
+		}
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
+	void MemorySystem::queueMigration(uint64_t address, bool isWrite)
+	{
+		Transaction::TransactionType type = isWrite ? Transaction::DATA_WRITE : Transaction::DATA_READ;
+		Transaction *copy = new Transaction(type, address, NULL, LEN_DEF, Simulator::clockDomainCPU->clockcycle);
+		copy->mappedAddress = mapAddress(address);
+		migrationQueues[mappedChannel(copy->mappedAddress)].push_back(copy);
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
+	// frees the line once nothing for it is in flight
+	void MemorySystem::releaseEntry(map<uint64_t, MergeEntry>::iterator it)
+	{
+		if (it->second.write == NULL && it->second.reads == 0 && it->second.coalesced.empty())
+		{
+			mergeBuffer.erase(it);
+		}
+	}
 
 
+	//every controller is idle and nothing waits for room in them or for the merge buffer to answer
+	bool MemorySystem::isIdle()
+	{
+		if (!mergedCompletions.empty() || (cxlLink != NULL && !cxlLink->isIdle()))
+		{
+			return false;
+		}
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+		{
+			useDevice(iChannel);
+			if (!pendingTransactions[iChannel].empty() || !migrationQueues[iChannel].empty() || !expanderQueues[iChannel].empty() ||
+					!memoryControllers[iChannel]->isIdle())
+			{
+				useDevice(NUM_CHANS);
+				return false;
+			}
 		}
-		// clone of scheme 5, but channel moved to lower bits
-		else if (addressMappingScheme == Scheme7)
+		useDevice(NUM_CHANS);
+		return true;
+	}
+
+
+	void MemorySystem::printStats()
+	{
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
 		{
-			//row:col:rank:bank:chan
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> channelBitWidth;
-			tempB = physicalAddress << channelBitWidth;
-			chan = tempA ^ tempB;
+			useDevice(iChannel);
+			PRINT("==== Channel ["<<iChannel<<"] ====");
+			memoryControllers[iChannel]->printStats(true);
+			PRINT("//// Channel ["<<iChannel<<"] ////");
+		}
+		useDevice(NUM_CHANS);
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> bankBitWidth;
-			tempB = physicalAddress << bankBitWidth;
-			bank = tempA ^ tempB;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rankBitWidth;
-			tempB = physicalAddress << rankBitWidth;
-			rank = tempA ^ tempB;
+	void MemorySystem::printPendingStats()
+	{
+		cout << "pending queues (" << PENDING_QUEUE_DEPTH << " per channel):" << endl;
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> colHighBitWidth;
-			tempB = physicalAddress << colHighBitWidth;
-			col = tempA ^ tempB;
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
+		{
+			cout << "    channel " << iChannel << ": queued: " << pendingQueued[iChannel]
+				<< "\t max occupancy: " << pendingMax[iChannel]
+				<< "\t average: " << (pendingCycles ? (double)pendingOccupancy[iChannel] / pendingCycles : 0)
+				<< "\t stalled cycles: " << pendingStalls[iChannel]
+				<< "\t full cycles: " << pendingFull[iChannel] << endl;
+		}
+	}
 
-			tempA = physicalAddress;
-			physicalAddress = physicalAddress >> rowBitWidth;
-			tempB = physicalAddress << rowBitWidth;
-			row = tempA ^ tempB;
 
+	void MemorySystem::printMergeStats()
+	{
+		uint64_t saved = writesMerged + readsForwarded + readsCoalesced;
+		cout << "merge buffer (" << MERGE_BUFFER_ENTRIES << " lines): transactions: " << mergeLookups
+			<< "\t writes merged: " << writesMerged
+			<< "\t reads forwarded: " << readsForwarded
+			<< "\t reads coalesced: " << readsCoalesced
+			<< "\t max occupancy: " << mergeMax
+			<< "\t untracked: " << mergeUntracked << endl;
+		cout << "    DRAM accesses saved: " << saved << " (" << (mergeLookups ? (double)saved / mergeLookups : 0) << ")"
+			<< "\t traffic saved: " << ((saved * TRANS_DATA_BYTES) >> 10) << "KB" << endl;
+	}
+
+
+	void MemorySystem::printCxlStats()
+	{
+		static const char *targetNames[] = {"local", "expander"};
+		cxlLink->printStats();
+		cout << "    loaded latency (reads, by the GB/s their target delivered in " << LATENCY_WINDOW << " cycle windows):" << endl;
+		for (unsigned target=Local; target<TARGETS; target++)
+		{
+			const LatencyCurve &curve = latencyCurves[target];
+			for (map<unsigned, LatencyBin>::const_iterator it=curve.bins.begin(); it!=curve.bins.end(); it++)
+			{
+				const LatencyBin &bin = it->second;
+				if (bin.reads == 0)
+				{
+					continue;
+				}
+				cout << "    " << targetNames[target] << " " << it->first << "GB/s: windows: " << bin.windows
+					<< "\t reads: " << bin.reads
+					<< "\t average latency: " << (double)bin.latency / bin.reads * tCK << "ns" << endl;
+			}
 		}
+	}
 
-		else
+
+	void MemorySystem::setAddressMapping(const string &layout, const string &hash)
+	{
+		delete addressMapper;
+		addressMapper = new AddressMapper(layout, hash);
+		if (!CHANNEL_XOR_MASKS.empty())
+		{
+			addressMapper->setXorMasks(AddressMapper::Channel, CHANNEL_XOR_MASKS);
+		}
+		if (!RANK_XOR_MASKS.empty())
+		{
+			addressMapper->setXorMasks(AddressMapper::Rank, RANK_XOR_MASKS);
+		}
+		if (!BANK_XOR_MASKS.empty())
+		{
+			addressMapper->setXorMasks(AddressMapper::Bank, BANK_XOR_MASKS);
+		}
+		PRINT("Address mapping: "<<addressMapper->describe());
+		if (!channelCapacity.empty())
+		{
+			buildInterleave(layout, hash);
+		}
+		if (!interleaveRegions.empty() && (!CHANNEL_XOR_MASKS.empty() || !RANK_XOR_MASKS.empty() || !BANK_XOR_MASKS.empty()))
 		{
-			ERROR("== Error - Unknown Address Mapping Scheme");
+			// each channel decodes an address of its own, masks over the physical address do not carry over to it
+			ERROR("CHANNEL_XOR_MASKS, RANK_XOR_MASKS and BANK_XOR_MASKS cannot be used with the channels interleaved by capacity, use ADDRESS_HASH");
 			exit(-1);
 		}
-		/*if (DEBUG_ADDR_MAP)
+	}
+
+
+	void MemorySystem::printMappingStats()
+	{
+		cout << "address mapping (" << addressMapper->describe() << "):" << endl;
+		for (size_t iChannel=0; iChannel<NUM_CHANS; iChannel++)
 		{
-			DEBUG("Mapped Ch="<<chan<<" Rank="<<rank<<
-				  " Bank="<<bank<<" Row="<<row<<" Col="<<col<<"\n");
-		}*///commented by libing 2013-4-22
+			memoryControllers[iChannel]->printMappingStats();
+		}
+	}
+
+
+	void MemorySystem::registerCallbacks( TransactionCompleteCB* readCB, TransactionCompleteCB* writeCB,
+										  void (*reportPower)(double bgpower, double burstpower, double refreshpower, double actprepower))
+	{
+		ReadDataDone = readCB;
+		WriteDataDone = writeCB;
+		ReportPower = reportPower;
 	}
 
 
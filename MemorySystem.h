@@ -31,6 +31,7 @@
 #define MEMORYSYSTEM_H
 
 #include <deque>
+#include <map>
 #include "SystemConfiguration.h"
 #include "Transaction.h"
 #include "MemoryController.h"
@@ -38,6 +39,9 @@
 #include "IniReader.h"
 #include "ClockDomain.h"
 #include "Callback.h"
+#include "AddressMapping.h"
+#include "TierManager.h"
+#include "CxlLink.h"
 
 
 namespace DRAMSim
@@ -51,27 +55,94 @@ namespace DRAMSim
 		virtual ~MemorySystem();
 		bool addTransaction(Transaction *trans);
 		bool addTransaction(bool isWrite, uint64_t addr);
+		/*
+		 * Credits: how many transactions the memory system takes before it
+		 * turns the next one away. A channel has the free slots of its
+		 * transaction queue plus, with MS_BUFFER, those of its pending queue;
+		 * once transactions wait in the pending queue only its slots are left,
+		 * since nothing overtakes them. Without an address the answer holds
+		 * for any address, i.e. it is the fewest credits of any channel.
+		 * Transactions the merge buffer absorbs are not counted, so a caller
+		 * that keeps to its credits is never turned away.
+		 */
 		bool willAcceptTransaction();
 		bool willAcceptTransaction(uint64_t addr);
+		unsigned getFreeSlots();
+		unsigned getFreeSlots(uint64_t addr);
+		bool isIdle();
 		void update();
 		void printStats();
+		void printPendingStats();
+		void printMappingStats();
+		void printMergeStats();
+		void printTierStats() {tierManager->printStats();}
+		void printCxlStats();
+		// the channels differ in geometry or some sit behind the others (NVM tier, range mapped CXL), see buildInterleave
+		bool interleavesByCapacity();
+		// the controllers report when they take a transaction off their queue and when its data is through
+		void transactionScheduled(Transaction *trans);
+		void readReturned(unsigned iChannel, uint64_t address);
+		void writeReturned(unsigned iChannel, uint64_t address);
+		// a line copy of a page migration, it waits for a slot nothing else wants
+		void queueMigration(uint64_t address, bool isWrite);
+		// replaces the address mapping, the XOR_MASKS keys still apply on top of the hash (not with the channels interleaved by capacity)
+		void setAddressMapping(const string &layout, const string &hash);
 		void registerCallbacks( TransactionCompleteCB *readDone, TransactionCompleteCB *writeDone,
 								void (*reportPower)(double bgpower, double burstpower, double refreshpower, double actprepower));
 
+		// decodes the address as it is, the controllers pass a transaction's mappedAddress
 		void addressMapping(
 				uint64_t physicalAddress,
 				unsigned &channel,
 				unsigned &rank,
 				unsigned &bank,
 				unsigned &row,
-				unsigned &col);
+				unsigned &col)
+		{
+			if (interleaveRegions.empty())
+			{
+				addressMapper->map(physicalAddress, channel, rank, bank, row, col);
+				return;
+			}
+			unsigned unused;
+			uint64_t local = channelAddress(physicalAddress, channel);
+			channelMappers[channel]->map(local, unused, rank, bank, row, col);
+		}
 
-		unsigned findChannelNumber(uint64_t addr);
+		// the address the channels see, the frame the tiers placed its page in
+		uint64_t mapAddress(uint64_t addr)
+		{
+			return tierManager != NULL ? tierManager->frameAddress(addr) : addr;
+		}
+
+		unsigned findChannelNumber(uint64_t addr)
+		{
+			return mappedChannel(mapAddress(addr));
+		}
+
+		unsigned mappedChannel(uint64_t mappedAddress)
+		{
+			if (interleaveRegions.empty())
+			{
+				return addressMapper->channel(mappedAddress);
+			}
+			unsigned channel;
+			channelAddress(mappedAddress, channel);
+			return channel;
+		}
 
 		//fields
+		AddressMapper *addressMapper;
+		TierManager *tierManager;  // NULL without an NVM tier
+		CxlLink *cxlLink;          // NULL without a CXL expander
 		vector<MemoryController *> memoryControllers;
 		vector<vector<Rank *> *> ranks;
-		deque<Transaction *> pendingTransactions;
+		// transactions that found their controller full (MS_BUFFER), at most PENDING_QUEUE_DEPTH
+		// per channel so a full channel does not hold back the others
+		vector<deque<Transaction *> > pendingTransactions;
+		vector<deque<Transaction *> > migrationQueues;
+		// requests that came over the CXL link and wait for room in their expander channel's controller
+		vector<deque<Transaction *> > expanderQueues;
 
 		//function pointers
 		TransactionCompleteCB* ReadDataDone;
@@ -80,6 +151,158 @@ namespace DRAMSim
 		//TODO: make this a functor as well?
 		static PowerCB ReportPower;
 
+	private:
+		bool enqueuePending(unsigned iChannel, Transaction *trans);
+		unsigned channelCredits(unsigned iChannel);
+		bool sendTransaction(unsigned iChannel, Transaction *trans);
+		// the controller, or the CXL link for an expander channel
+		bool acceptTransaction(unsigned iChannel, Transaction *trans);
+		unsigned acceptSlots(unsigned iChannel);
+		bool isExpander(unsigned iChannel) const {return iChannel >= NUM_CHANS - CXL_CHANNELS;}
+
+		/*
+		 * The merge buffer (MERGE_BUFFER_ENTRIES lines) sits in front of the
+		 * channels and remembers, per line, the write that is waiting to be
+		 * scheduled and how many reads are out at DRAM:
+		 *   - a write to a line with a waiting write is folded into it
+		 *   - a read to a line with a waiting write is answered from it
+		 *   - a read to a line with reads out waits for their data
+		 * A merged transaction never reaches DRAM. The writes and forwarded
+		 * reads complete on the next memory system cycle, since the caller
+		 * only starts waiting once addTransaction returns; the coalesced
+		 * reads complete with the read they wait for. The caller may still
+		 * look at a merged transaction after handing it over, so it is freed
+		 * when it completes. Transactions with a data payload are not merged.
+		 * Only whole lines merge (len == LEN_DEF, see SECTOR_BYTES): a partial
+		 * transaction goes to DRAM, a read is only answered from a whole line
+		 * write, and once a partial read is out at DRAM the line's reads stop
+		 * coalescing until the entry is released, since the completion does
+		 * not tell which read it is.
+		 * When every line is taken, new lines go to DRAM untracked.
+		 */
+		struct MergeEntry
+		{
+			Transaction *write;               // waiting to be scheduled, NULL if none
+			unsigned reads;                   // out at DRAM
+			bool partialReads;                // one of them fetches only some sectors
+			vector<Transaction *> coalesced;  // reads waiting for their data
+			MergeEntry() : write(NULL), reads(0), partialReads(false) {}
+		};
+		struct MergedCompletion
+		{
+			unsigned channel;
+			Transaction *trans;
+		};
+
+		// a transaction's data is through, and back at the host for an expander channel
+		void readDone(unsigned iChannel, uint64_t address);
+		void writeDone(unsigned iChannel, uint64_t address);
+		void reportRead(unsigned iChannel, uint64_t address);
+		void reportWrite(unsigned iChannel, uint64_t address);
+		bool mergeTransaction(unsigned iChannel, Transaction *trans);
+		void trackTransaction(Transaction *trans);
+		void releaseEntry(map<uint64_t, MergeEntry>::iterator it);
+
+		map<uint64_t, MergeEntry> mergeBuffer;    // by line
+		deque<MergedCompletion> mergedCompletions;
+		uint64_t mergeLookups;                    // transactions the memory system accepted
+		uint64_t writesMerged;
+		uint64_t readsForwarded;
+		uint64_t readsCoalesced;
+		uint64_t mergeUntracked;                  // lines sent while the buffer was full
+		size_t mergeMax;
+
+		/*
+		 * Channels with a device ini of their own (CHANNEL_DEVICE_INIS).
+		 *
+		 * The device parameters are globals, so a channel's parameters are
+		 * loaded into them whenever its controller or ranks run; everything
+		 * else sees the main device. A channel with a different tCK runs on
+		 * its own clock: it is updated tCK/its tCK times per memory system
+		 * cycle, carrying the fraction over, and while it runs the DRAM clock
+		 * domain counts its cycles.
+		 *
+		 * Channels of different geometry are interleaved by capacity: the
+		 * address space is cut into regions, the first interleaves every
+		 * channel up to the smallest capacity, the next the channels that
+		 * have more, and so on. Inside a region the channels take turns at
+		 * the granularity the layout puts below the channel field, and each
+		 * channel decodes its own part of the region with the layout minus
+		 * the channel field. The channel hash does not apply then, and the
+		 * XOR_MASKS keys, whose masks are over the physical address, are
+		 * refused. With an NVM tier the DRAM channels are interleaved this
+		 * way first and the NVM channels after them, whatever their
+		 * geometry, and so are the local channels and those of a CXL
+		 * expander with CXL_MAPPING=range.
+		 */
+		struct InterleaveRegion
+		{
+			uint64_t start;            // in the physical address space
+			uint64_t end;
+			uint64_t channelStart;     // in each channel of the region
+			uint64_t granularity;      // bytes a channel gets before the next one's turn
+			vector<unsigned> channels;
+		};
+
+		void loadChannelDevices();
+		void useDevice(unsigned iChannel);  // NUM_CHANS for the main device
+		void updateChannel(unsigned iChannel);
+		void buildInterleave(const string &layout, const string &hash);
+		void addInterleaveRegions(unsigned first, unsigned last);
+		uint64_t channelAddress(uint64_t physicalAddress, unsigned &channel) const;
+
+		IniReader::DeviceParams mainDevice;
+		vector<IniReader::DeviceParams> channelDevices;  // empty when every channel uses the main device
+		unsigned activeDevice;
+		vector<uint64_t> channelCapacity;                // bytes
+		vector<double> channelClockRatio;                // channel cycles per memory system cycle
+		vector<double> channelClockCredit;
+		vector<uint64_t> channelCycles;                  // of the channel's own clock
+		uint64_t mainClockCycle;                         // of the DRAM clock while a channel has it
+		vector<InterleaveRegion> interleaveRegions;      // empty when every channel has the main geometry
+		vector<AddressMapper *> channelMappers;
+		uint64_t interleaveCapacity;
+
+		// pending queue statistics, per channel
+		vector<uint64_t> pendingQueued;     // transactions that had to wait
+		vector<uint64_t> pendingFull;       // cycles the queue turned new transactions away
+		vector<uint64_t> pendingOccupancy;  // queue length summed over the cycles
+		vector<uint64_t> pendingStalls;     // cycles the head could not go to the controller
+		vector<size_t> pendingMax;
+		uint64_t pendingCycles;
+
+		/*
+		 * Loaded latency, with a CXL expander: the latency of the reads that
+		 * went to memory, from the cycle the memory system took them to the
+		 * cycle their data is back, against the bandwidth their target (the
+		 * local channels or the expander) delivered at the time. The
+		 * bandwidth is measured over windows of LATENCY_WINDOW cycles and a
+		 * read falls in the window it completes in; the windows are binned
+		 * by whole GB/s.
+		 */
+		static const unsigned LATENCY_WINDOW = 1000;
+		enum Target {Local, Expander, TARGETS};
+		struct LatencyBin
+		{
+			uint64_t windows;
+			uint64_t reads;
+			uint64_t latency;      // summed, in cycles
+		};
+		struct LatencyCurve
+		{
+			uint64_t windowBytes;
+			uint64_t windowReads;
+			uint64_t windowLatency;
+			map<unsigned, LatencyBin> bins;  // by GB/s
+		};
+
+		void readStarted(uint64_t address);
+		void transferred(unsigned iChannel, uint64_t address, bool isWrite);
+		void closeLatencyWindow();
+
+		map<uint64_t, deque<uint64_t> > readStarts;  // cycles the reads out for an address were taken
+		LatencyCurve latencyCurves[TARGETS];
+
 	};
 }
 
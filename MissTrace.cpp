@@ -0,0 +1,125 @@
+#include "MissTrace.h"
+
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <assert.h>
+using namespace std;
+
+BlSim::MissTraceWriter::MissTraceWriter(const std::string &filename)
+{
+	m_file = fopen(filename.c_str(), "wb");
+	if(m_file == NULL)
+	{
+		cerr<<"Could not open miss trace file '"<<filename<<"'"<<endl;
+		exit(-8);
+	}
+
+	m_ring = new MissTraceRecord[RING_SIZE];
+	m_head = 0;
+	m_tail = 0;
+	m_tail_cache = 0;
+	m_stop = false;
+	m_records = 0;
+	m_full_waits = 0;
+
+	if(pthread_create(&m_thread, NULL, writer_main, this) != 0)
+	{
+		cerr<<"Could not start the miss trace writer thread"<<endl;
+		exit(-8);
+	}
+}
+
+BlSim::MissTraceWriter::~MissTraceWriter()
+{
+	//the writer sees m_stop only after every record published before it
+	__atomic_store_n(&m_stop, true, __ATOMIC_RELEASE);
+	pthread_join(m_thread, NULL);
+
+	fclose(m_file);
+	delete []m_ring;
+}
+
+void BlSim::MissTraceWriter::add(uint64_t maddr, uint32_t rw, uint32_t thread_id, uint32_t upper_ins_count)
+{
+	if(m_head - m_tail_cache == RING_SIZE)
+	{
+		m_tail_cache = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+		if(m_head - m_tail_cache == RING_SIZE)
+		{
+			m_full_waits++;
+			while(m_head - m_tail_cache == RING_SIZE)
+			{
+				sched_yield();
+				m_tail_cache = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+			}
+		}
+	}
+
+	MissTraceRecord *p_record = &m_ring[m_head & (RING_SIZE - 1)];
+	p_record->m_addr = maddr;
+	p_record->m_upper_ins_count = upper_ins_count;
+	p_record->m_threadid = (uint16_t)thread_id;
+	p_record->m_rw = (uint8_t)rw;
+	p_record->m_reserved = 0;
+
+	//publish the record, the writer reads the slot only after it acquires the new head
+	__atomic_store_n(&m_head, m_head + 1, __ATOMIC_RELEASE);
+	m_records++;
+}
+
+void BlSim::MissTraceWriter::drain()
+{
+	uint64_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+
+	while(m_tail != head)
+	{
+		//write up to the end of the ring or the head, whichever comes first
+		uint64_t index = m_tail & (RING_SIZE - 1);
+		uint64_t count = head - m_tail;
+		if(count > RING_SIZE - index)
+		{
+			count = RING_SIZE - index;
+		}
+		if(fwrite(&m_ring[index], sizeof(MissTraceRecord), count, m_file) != count)
+		{
+			cerr<<"Writing the miss trace failed"<<endl;
+			exit(-8);
+		}
+		//hand the slots back to the cache thread
+		__atomic_store_n(&m_tail, m_tail + count, __ATOMIC_RELEASE);
+	}
+}
+
+void *BlSim::MissTraceWriter::writer_main(void *p_arg)
+{
+	MissTraceWriter *p_writer = (MissTraceWriter *)p_arg;
+
+	while(true)
+	{
+		//read the stop flag before draining, so the last drain sees every record added before the stop
+		bool stop = __atomic_load_n(&p_writer->m_stop, __ATOMIC_ACQUIRE);
+		uint64_t tail = p_writer->m_tail;
+
+		p_writer->drain();
+		if(stop)
+		{
+			break;
+		}
+		if(p_writer->m_tail == tail)
+		{
+			//nothing came in, do not spin on the cache thread's core
+			usleep(IDLE_WAIT_US);
+		}
+	}
+	fflush(p_writer->m_file);
+	return NULL;
+}
+
+void BlSim::MissTraceWriter::print_statistic()
+{
+	cout<<"miss trace: records: "<<m_records
+		<<"\t ring full waits: "<<m_full_waits<<endl;
+}
@@ -0,0 +1,60 @@
+#ifndef MISS_TRACE_H_
+#define MISS_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string>
+
+namespace BlSim
+{
+    //one record of the binary miss trace, written as is (little endian, 16 bytes)
+    struct MissTraceRecord
+    {
+        uint64_t m_addr;
+        uint32_t m_upper_ins_count;  //accesses the caches filtered since the previous record
+        uint16_t m_threadid;
+        uint8_t m_rw;                //MEM_WRITE or MEM_READ
+        uint8_t m_reserved;
+    };
+
+    /*
+     * Writes the LLC miss trace from a dedicated thread.
+     *
+     * The cache thread only copies the record into a single producer single
+     * consumer ring and publishes it with a release store of the head; the
+     * writer thread acquires the head, fwrite()s everything up to it in one
+     * go and releases the slots by storing the tail. The cache only waits
+     * when the ring is full, i.e. when the disk cannot keep up.
+     */
+    class MissTraceWriter
+    {
+        protected:
+            enum Ring_Config{RING_BITS=16, RING_SIZE=1<<RING_BITS, IDLE_WAIT_US=200};
+
+            FILE *m_file;
+            MissTraceRecord *m_ring;
+            uint64_t m_head;       //next slot the cache thread fills, written by the cache thread only
+            uint64_t m_tail;       //next slot the writer drains, written by the writer thread only
+            uint64_t m_tail_cache; //the cache thread's last view of m_tail
+            bool m_stop;
+
+            uint64_t m_records;
+            uint64_t m_full_waits; //times the cache thread found the ring full
+
+            pthread_t m_thread;
+
+            static void *writer_main(void *p_arg);
+            void drain();
+
+        public:
+            MissTraceWriter(const std::string &filename);
+            ~MissTraceWriter();  //writes out everything still in the ring
+
+            void add(uint64_t maddr, uint32_t rw, uint32_t thread_id, uint32_t upper_ins_count);
+
+            void print_statistic();
+    };
+}
+
+#endif
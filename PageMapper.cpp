@@ -0,0 +1,310 @@
+#include "PageMapper.h"
+#include "PrintMacros.h"
+
+#include <iostream>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	PageMapper::PageMapper(MemorySystem *memorySystem, uint64_t pageSize, AllocationPolicy policy, unsigned cores, unsigned tlbEntries) :
+		memorySystem(memorySystem), pageSize(pageSize), policy(policy), cores(cores)
+	{
+		if (pageSize != 4096 && pageSize != (2UL << 20))
+		{
+			ERROR("PAGE_SIZE must be 4096 (4KB) or 2097152 (2MB), got "<<pageSize);
+			exit(-1);
+		}
+		if (tlbEntries % TLB_WAYS != 0)
+		{
+			ERROR("TLB_ENTRIES must be a multiple of the "<<TLB_WAYS<<" TLB ways, got "<<tlbEntries);
+			exit(-1);
+		}
+		if (policy == BankPartition && cores > NUM_RANKS * NUM_BANKS)
+		{
+			ERROR("bank_partition needs a rank/bank for each of the "<<cores<<" cores, there are "<<NUM_RANKS * NUM_BANKS);
+			exit(-1);
+		}
+
+		pageBits = dramsim_log2(pageSize);
+		tlbSets = tlbEntries / TLB_WAYS;
+		walkLevels = pageSize == 4096 ? 4 : 3;
+
+		// the page tables get the top 1/256 of memory, a 4KB node maps 2MB of 4KB pages
+		uint64_t capacity = TOTAL_STORAGE << 20;
+		tableRegionStart = (capacity - capacity / 256) & ~(pageSize - 1);
+		nextTableNode = capacity;
+		frameCount = tableRegionStart >> pageBits;
+		if (frameCount == 0)
+		{
+			ERROR("The memory ("<<(capacity >> 20)<<"MB) cannot hold a single "<<pageSize<<" byte page");
+			exit(-1);
+		}
+		frameUsed.assign(frameCount, false);
+		framesAllocated = 0;
+		nextFrame = 0;
+		randomState = 0x9e3779b97f4a7c15UL;
+
+		colorCount = NUM_CHANS * NUM_RANKS * NUM_BANKS;
+		colorCursor.assign(colorCount, 0);
+		// only the colored policies decode frames, the others work before there is an address mapping
+		bool colored = policy == Coloring || policy == BankPartition;
+		colorable = false;
+		for (uint64_t frame = 1; colored && frame < frameCount && !colorable; frame <<= 1)
+		{
+			colorable = frameColor(frame) != frameColor(0);
+		}
+		if (colored && !colorable)
+		{
+			PRINT("WARNING: the address mapping picks the bank inside a page, pages are allocated in sequential order");
+		}
+
+		walkReadCount = 0;
+	}
+
+
+	PageMapper::AddressSpace &PageMapper::getSpace(unsigned core)
+	{
+		map<unsigned, AddressSpace>::iterator it = spaces.find(core);
+		if (it == spaces.end())
+		{
+			AddressSpace &space = spaces[core];
+			TlbEntry empty = {0, 0, false};
+			space.tlb.assign(tlbSets * TLB_WAYS, empty);
+			// start the threads on different colors so their first pages do not pile up on one bank
+			space.nextColor = colorCount * (core % cores) / cores;
+			space.tlbAccesses = 0;
+			space.tlbMisses = 0;
+			return space;
+		}
+		return it->second;
+	}
+
+
+	void PageMapper::translate(Transaction *trans, vector<uint64_t> &walkReads)
+	{
+		AddressSpace &space = getSpace(trans->coreID);
+		uint64_t vpn = trans->address >> pageBits;
+
+		if (tlbSets > 0 && !lookupTlb(space, vpn))
+		{
+			walk(space, trans->address, walkReads);
+		}
+
+		uint64_t frame;
+		map<uint64_t, uint64_t>::iterator it = space.pages.find(vpn);
+		if (it == space.pages.end())
+		{
+			// first touch
+			frame = allocateFrame(space, trans->coreID);
+			space.pages[vpn] = frame;
+		}
+		else
+		{
+			frame = it->second;
+		}
+		trans->address = (frame << pageBits) | (trans->address & (pageSize - 1));
+	}
+
+
+	bool PageMapper::lookupTlb(AddressSpace &space, uint64_t vpn)
+	{
+		TlbEntry *set = &space.tlb[(vpn % tlbSets) * TLB_WAYS];
+		TlbEntry *victim = &set[0];
+
+		space.tlbAccesses++;
+		for (unsigned i=0; i<TLB_WAYS; i++)
+		{
+			if (set[i].valid && set[i].vpn == vpn)
+			{
+				set[i].lastUse = space.tlbAccesses;
+				return true;
+			}
+			if (!set[i].valid || (victim->valid && set[i].lastUse < victim->lastUse))
+			{
+				victim = &set[i];
+			}
+		}
+
+		space.tlbMisses++;
+		victim->vpn = vpn;
+		victim->lastUse = space.tlbAccesses;
+		victim->valid = true;
+		return false;
+	}
+
+
+	void PageMapper::walk(AddressSpace &space, uint64_t vaddr, vector<uint64_t> &walkReads)
+	{
+		uint64_t va = vaddr & ((1UL << VIRTUAL_ADDRESS_BITS) - 1);
+
+		// one entry per level from the root down, each level indexes 9 more bits of the virtual address
+		for (unsigned level=0; level<walkLevels; level++)
+		{
+			uint64_t key = ((uint64_t)level << 56) | (va >> (VIRTUAL_ADDRESS_BITS - TABLE_INDEX_BITS * level));
+			map<uint64_t, uint64_t>::iterator it = space.tableNodes.find(key);
+			uint64_t node;
+			if (it == space.tableNodes.end())
+			{
+				if (nextTableNode - TABLE_NODE_BYTES < tableRegionStart)
+				{
+					ERROR("Out of room for page tables ("<<((nextTableNode - tableRegionStart) >> 10)<<"KB left)");
+					exit(-1);
+				}
+				nextTableNode -= TABLE_NODE_BYTES;
+				node = nextTableNode;
+				space.tableNodes[key] = node;
+			}
+			else
+			{
+				node = it->second;
+			}
+
+			uint64_t index = (va >> (VIRTUAL_ADDRESS_BITS - TABLE_INDEX_BITS * (level + 1))) & ((1U << TABLE_INDEX_BITS) - 1);
+			walkReads.push_back(node + index * 8);
+			walkReadCount++;
+		}
+	}
+
+
+	uint64_t PageMapper::allocateFrame(AddressSpace &space, unsigned core)
+	{
+		if (framesAllocated == frameCount)
+		{
+			ERROR("Out of physical memory after "<<framesAllocated<<" pages of "<<pageSize<<" bytes");
+			exit(-1);
+		}
+
+		if (policy == Random)
+		{
+			// a few random picks, then the first free frame after the last one
+			uint64_t frame = 0;
+			for (unsigned i=0; i<64; i++)
+			{
+				randomState ^= randomState << 13;
+				randomState ^= randomState >> 7;
+				randomState ^= randomState << 17;
+				frame = randomState % frameCount;
+				if (!frameUsed[frame])
+				{
+					return takeFrame(frame);
+				}
+			}
+			nextFrame = frame;
+		}
+		else if ((policy == Coloring || policy == BankPartition) && colorable)
+		{
+			uint64_t frame = allocateColored(space, core);
+			if (frame != frameCount)
+			{
+				return takeFrame(frame);
+			}
+		}
+
+		while (frameUsed[nextFrame])
+		{
+			nextFrame = (nextFrame + 1) % frameCount;
+		}
+		return takeFrame(nextFrame);
+	}
+
+
+	// the next free frame of the space's next color (of the core's own banks for bank_partition), frameCount if none is left
+	uint64_t PageMapper::allocateColored(AddressSpace &space, unsigned core)
+	{
+		for (unsigned i=0; i<colorCount; i++)
+		{
+			unsigned color = (space.nextColor + i) % colorCount;
+			if (policy == BankPartition && !ownsColor(core, color))
+			{
+				continue;
+			}
+
+			// every cursor only moves forward, so finding the frames of a color costs one pass over memory
+			uint64_t &cursor = colorCursor[color];
+			while (cursor < frameCount && (frameUsed[cursor] || frameColor(cursor) != color))
+			{
+				cursor++;
+			}
+			if (cursor < frameCount)
+			{
+				space.nextColor = (color + 1) % colorCount;
+				return cursor++;
+			}
+		}
+		return frameCount;
+	}
+
+
+	uint64_t PageMapper::takeFrame(uint64_t frame)
+	{
+		frameUsed[frame] = true;
+		framesAllocated++;
+		return frame;
+	}
+
+
+	unsigned PageMapper::frameColor(uint64_t frame)
+	{
+		unsigned chan, rank, bank, row, col;
+		memorySystem->addressMapping(frame << pageBits, chan, rank, bank, row, col);
+		return (chan * NUM_RANKS + rank) * NUM_BANKS + bank;
+	}
+
+
+	bool PageMapper::ownsColor(unsigned core, unsigned color)
+	{
+		return (color % (NUM_RANKS * NUM_BANKS)) % cores == core % cores;
+	}
+
+
+	void PageMapper::printStats()
+	{
+		static const char *policyNames[] = {"sequential", "random", "coloring", "bank_partition"};
+		uint64_t fewest = 0;
+		uint64_t most = 0;
+		unsigned colorsUsed = 0;
+
+		// counted here, the frames are decoded with the final address mapping (see Simulator::selectAddressMapping)
+		vector<uint64_t> framesPerColor(colorCount, 0);
+		for (uint64_t frame=0; frame<frameCount; frame++)
+		{
+			if (frameUsed[frame])
+			{
+				framesPerColor[frameColor(frame)]++;
+			}
+		}
+		for (unsigned color=0; color<colorCount; color++)
+		{
+			if (framesPerColor[color] == 0)
+			{
+				continue;
+			}
+			if (colorsUsed == 0 || framesPerColor[color] < fewest)
+			{
+				fewest = framesPerColor[color];
+			}
+			if (framesPerColor[color] > most)
+			{
+				most = framesPerColor[color];
+			}
+			colorsUsed++;
+		}
+
+		cout << "pages (" << (pageSize >> 10) << "KB, " << policyNames[policy] << "): frames: " << framesAllocated << " of " << frameCount
+			<< "\t colors used: " << colorsUsed << " of " << colorCount
+			<< " (" << fewest << " to " << most << " frames each)" << endl;
+
+		uint64_t tableBytes = 0;
+		for (map<unsigned, AddressSpace>::iterator it = spaces.begin(); it != spaces.end(); it++)
+		{
+			AddressSpace &space = it->second;
+			tableBytes += space.tableNodes.size() * TABLE_NODE_BYTES;
+			cout << "    core " << it->first << ": pages: " << space.pages.size()
+				<< "\t TLB accesses: " << space.tlbAccesses
+				<< "\t misses: " << space.tlbMisses
+				<< " (" << (space.tlbAccesses ? (double)space.tlbMisses / space.tlbAccesses : 0) << ")" << endl;
+		}
+		cout << "    page walk reads: " << walkReadCount << "\t page tables: " << (tableBytes >> 10) << "KB" << endl;
+	}
+}
@@ -0,0 +1,112 @@
+#ifndef PAGEMAPPER_H
+#define PAGEMAPPER_H
+
+#include "SystemConfiguration.h"
+#include "Transaction.h"
+#include "MemorySystem.h"
+
+#include <map>
+#include <vector>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	/*
+	 * Virtual to physical page mapping between the trace and the caches.
+	 *
+	 * Every core (the trace's thread) has its own address space. A page is
+	 * given a frame on its first touch, and the allocation policy decides
+	 * which frame it gets:
+	 *   sequential      the next free frame
+	 *   random          any free frame
+	 *   coloring        a thread's consecutive pages go round robin over the
+	 *                   channel/rank/bank colors of the frames
+	 *   bank_partition  like coloring, but a core only gets frames of its own
+	 *                   banks (PALLOC): banks are dealt out to the cores
+	 *                   by rank*NUM_BANKS+bank modulo the core count
+	 * The color of a frame is the channel, rank and bank addressMapping
+	 * gives its first byte. If the mapping takes those bits from inside the
+	 * page, every frame has the same color and the colored policies fall
+	 * back to sequential order.
+	 *
+	 * Each core has a set associative TLB. A miss walks an x86-64 style
+	 * radix page table (4 levels for 4KB pages, 3 for 2MB). The page table
+	 * nodes sit in a 4KB-frame region at the top of memory, and each walk
+	 * step returns the physical address of the entry it reads.
+	 */
+	class PageMapper
+	{
+	public:
+		typedef enum
+		{
+			Sequential,
+			Random,
+			Coloring,
+			BankPartition
+		} AllocationPolicy;
+
+		PageMapper(MemorySystem *memorySystem, uint64_t pageSize, AllocationPolicy policy, unsigned cores, unsigned tlbEntries);
+
+		// maps trans->address into the core's address space, a TLB miss appends the page table entries it reads
+		void translate(Transaction *trans, vector<uint64_t> &walkReads);
+		void printStats();
+
+	private:
+		static const unsigned TLB_WAYS = 4;
+		static const unsigned TABLE_NODE_BYTES = 4096;
+		static const unsigned TABLE_INDEX_BITS = 9;
+		static const unsigned VIRTUAL_ADDRESS_BITS = 48;
+
+		struct TlbEntry
+		{
+			uint64_t vpn;
+			uint64_t lastUse;
+			bool valid;
+		};
+
+		struct AddressSpace
+		{
+			map<uint64_t, uint64_t> pages;       // vpn -> frame
+			map<uint64_t, uint64_t> tableNodes;  // level and virtual prefix -> node address
+			vector<TlbEntry> tlb;
+			unsigned nextColor;
+			uint64_t tlbAccesses;
+			uint64_t tlbMisses;
+		};
+
+		MemorySystem *memorySystem;
+		uint64_t pageSize;
+		unsigned pageBits;
+		AllocationPolicy policy;
+		unsigned cores;
+		unsigned tlbSets;
+		unsigned walkLevels;
+
+		uint64_t frameCount;        // data frames, below the page table region
+		vector<bool> frameUsed;
+		uint64_t framesAllocated;
+		uint64_t nextFrame;         // sequential cursor
+		uint64_t nextTableNode;     // next free page table node, counting down from the top of memory
+		uint64_t tableRegionStart;
+		uint64_t randomState;
+
+		unsigned colorCount;
+		vector<uint64_t> colorCursor;    // next frame to look at for each color
+		bool colorable;                  // frames do differ in color
+
+		map<unsigned, AddressSpace> spaces;
+		uint64_t walkReadCount;
+
+		AddressSpace &getSpace(unsigned core);
+		bool lookupTlb(AddressSpace &space, uint64_t vpn);
+		void walk(AddressSpace &space, uint64_t vaddr, vector<uint64_t> &walkReads);
+		uint64_t allocateFrame(AddressSpace &space, unsigned core);
+		uint64_t allocateColored(AddressSpace &space, unsigned core);
+		uint64_t takeFrame(uint64_t frame);
+		unsigned frameColor(uint64_t frame);
+		bool ownsColor(unsigned core, unsigned color);
+	};
+}
+
+#endif
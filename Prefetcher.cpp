@@ -0,0 +1,370 @@
+#include "Prefetcher.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <assert.h>
+using namespace std;
+
+BlSim::Prefetcher::Prefetcher(uint32_t block_size, uint32_t degree, uint32_t distance)
+{
+	m_block_bits = 0;
+	while((1U << m_block_bits) < block_size)
+	{
+		m_block_bits++;
+	}
+	m_degree = degree > 0 ? degree : 1;
+	m_distance = distance > 0 ? distance : 1;
+
+	m_issued = 0;
+	m_dropped = 0;
+	m_filled = 0;
+	m_useful = 0;
+	m_late = 0;
+	m_useless = 0;
+	m_demand_misses = 0;
+}
+
+void BlSim::Prefetcher::add_candidate(std::vector<uint64_t> &candidates, uint64_t block_num)
+{
+	candidates.push_back(block_num << m_block_bits);
+}
+
+void BlSim::Prefetcher::print_statistic()
+{
+	//accuracy: how many prefetches were used; coverage: how many demand misses were removed;
+	//timeliness: how many of the used prefetches arrived before the demand
+	uint64_t used = m_useful + m_late;
+	double accuracy = m_issued ? (double)used / m_issued : 0.0;
+	double coverage = (used + m_demand_misses) ? (double)used / (used + m_demand_misses) : 0.0;
+	double timeliness = used ? (double)m_useful / used : 0.0;
+
+	cout << "prefetcher " << name() << " (degree " << m_degree << ", distance " << m_distance << "):"
+		<< " issued: " << m_issued
+		<< "\t dropped: " << m_dropped
+		<< "\t filled: " << m_filled
+		<< "\t useful: " << m_useful
+		<< "\t late: " << m_late
+		<< "\t useless: " << m_useless << endl;
+	cout << "\t accuracy: " << accuracy
+		<< "\t coverage: " << coverage
+		<< "\t timeliness: " << timeliness << endl;
+}
+
+void BlSim::NextLinePrefetcher::access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                                       std::vector<uint64_t> &candidates)
+{
+	if(!miss && !prefetch_hit)
+	{
+		return;
+	}
+
+	uint64_t block_num = block_addr >> m_block_bits;
+	for(uint32_t i = 0; i < m_degree; i++)
+	{
+		add_candidate(candidates, block_num + m_distance + i);
+	}
+}
+
+BlSim::StridePrefetcher::StridePrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance):
+	Prefetcher(block_size, degree, distance)
+{
+	memset(m_table, 0, sizeof(m_table));
+	m_lru_clock = 0;
+}
+
+void BlSim::StridePrefetcher::access(uint64_t block_addr, bool /*miss*/, bool /*prefetch_hit*/,
+                                     std::vector<uint64_t> &candidates)
+{
+	uint64_t block_num = block_addr >> m_block_bits;
+	uint64_t page = block_addr >> PAGE_BITS;
+	StreamEntry *p_entry = NULL;
+	StreamEntry *p_victim = &m_table[0];
+	uint32_t i;
+
+	m_lru_clock++;
+	for(i = 0; i < TABLE_SIZE; i++)
+	{
+		if(m_table[i].m_valid && m_table[i].m_page == page)
+		{
+			p_entry = &m_table[i];
+			break;
+		}
+		if(!m_table[i].m_valid || m_table[i].m_lru < p_victim->m_lru)
+		{
+			p_victim = &m_table[i];
+		}
+	}
+
+	if(p_entry == NULL)
+	{
+		//first touch of this page, start a new stream
+		p_victim->m_valid = true;
+		p_victim->m_page = page;
+		p_victim->m_last_block = block_num;
+		p_victim->m_stride = 0;
+		p_victim->m_confidence = 0;
+		p_victim->m_lru = m_lru_clock;
+		return;
+	}
+
+	p_entry->m_lru = m_lru_clock;
+	int64_t delta = (int64_t)(block_num - p_entry->m_last_block);
+	if(delta == 0)
+	{
+		return;
+	}
+
+	if(delta == p_entry->m_stride)
+	{
+		if(p_entry->m_confidence < CONF_MAX)
+		{
+			p_entry->m_confidence++;
+		}
+	}
+	else if(p_entry->m_confidence > 0)
+	{
+		p_entry->m_confidence--;
+	}
+	else
+	{
+		p_entry->m_stride = delta;
+	}
+	p_entry->m_last_block = block_num;
+
+	if(p_entry->m_confidence < CONF_ISSUE)
+	{
+		return;
+	}
+
+	//without a PC we only know the layout inside the page, so stop at the page boundary
+	for(i = 0; i < m_degree; i++)
+	{
+		uint64_t target = block_num + p_entry->m_stride * (int64_t)(m_distance + i);
+		if(((target << m_block_bits) >> PAGE_BITS) != page)
+		{
+			break;
+		}
+		add_candidate(candidates, target);
+	}
+}
+
+BlSim::StreamBufferPrefetcher::StreamBufferPrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance):
+	Prefetcher(block_size, degree, distance)
+{
+	memset(m_streams, 0, sizeof(m_streams));
+	memset(m_train, 0, sizeof(m_train));
+	m_train_next = 0;
+	m_lru_clock = 0;
+}
+
+void BlSim::StreamBufferPrefetcher::run_ahead(StreamBuffer *p_stream, std::vector<uint64_t> &candidates)
+{
+	//keep the stream 'degree' blocks deep, starting 'distance' blocks after the next expected demand
+	uint64_t limit = p_stream->m_next + p_stream->m_dir * (int64_t)(m_distance + m_degree - 2);
+	while((int64_t)(limit - p_stream->m_tail) * p_stream->m_dir > 0)
+	{
+		p_stream->m_tail += p_stream->m_dir;
+		add_candidate(candidates, p_stream->m_tail);
+	}
+}
+
+void BlSim::StreamBufferPrefetcher::access(uint64_t block_addr, bool miss, bool /*prefetch_hit*/,
+                                           std::vector<uint64_t> &candidates)
+{
+	uint64_t block_num = block_addr >> m_block_bits;
+	StreamBuffer *p_victim = &m_streams[0];
+	uint32_t i;
+
+	m_lru_clock++;
+	for(i = 0; i < STREAM_COUNT; i++)
+	{
+		StreamBuffer *p_stream = &m_streams[i];
+		if(p_stream->m_valid)
+		{
+			int64_t from_next = (int64_t)(block_num - p_stream->m_next) * p_stream->m_dir;
+			int64_t to_tail = (int64_t)(p_stream->m_tail - block_num) * p_stream->m_dir;
+			if(from_next >= 0 && to_tail >= 0)
+			{
+				//the demand stream caught up with the buffer, advance it
+				p_stream->m_next = block_num + p_stream->m_dir;
+				p_stream->m_lru = m_lru_clock;
+				run_ahead(p_stream, candidates);
+				return;
+			}
+		}
+		if(!p_stream->m_valid || p_stream->m_lru < p_victim->m_lru)
+		{
+			p_victim = p_stream;
+		}
+	}
+
+	if(!miss)
+	{
+		return;
+	}
+
+	//allocate a stream when this miss is close to a recent one
+	for(i = 0; i < TRAIN_COUNT; i++)
+	{
+		int64_t delta = (int64_t)(block_num - m_train[i]);
+		if(m_train[i] != 0 && delta != 0 && delta <= TRAIN_WINDOW && delta >= -TRAIN_WINDOW)
+		{
+			m_train[i] = 0;
+			p_victim->m_valid = true;
+			p_victim->m_dir = delta > 0 ? 1 : -1;
+			p_victim->m_next = block_num + p_victim->m_dir;
+			p_victim->m_tail = block_num + p_victim->m_dir * (int64_t)(m_distance - 1);
+			p_victim->m_lru = m_lru_clock;
+			run_ahead(p_victim, candidates);
+			return;
+		}
+	}
+
+	m_train[m_train_next] = block_num;
+	m_train_next = (m_train_next + 1) % TRAIN_COUNT;
+}
+
+BlSim::BestOffsetPrefetcher::BestOffsetPrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance):
+	Prefetcher(block_size, degree, distance)
+{
+	//the offset list of the paper: every n whose prime factors are only 2, 3 and 5
+	uint32_t max_offset = distance > 1 ? distance : 256;
+	for(uint32_t n = 1; n <= max_offset; n++)
+	{
+		uint32_t m = n;
+		while(m % 2 == 0) m /= 2;
+		while(m % 3 == 0) m /= 3;
+		while(m % 5 == 0) m /= 5;
+		if(m == 1)
+		{
+			m_offsets.push_back(n);
+		}
+	}
+	m_scores.assign(m_offsets.size(), 0);
+	memset(m_rr_table, 0, sizeof(m_rr_table));
+	m_test_index = 0;
+	m_round = 0;
+	m_best_offset = 1;
+	m_prefetch_on = true;
+}
+
+uint32_t BlSim::BestOffsetPrefetcher::rr_index(uint64_t block_num)
+{
+	return (uint32_t)((block_num ^ (block_num >> 8)) & (RR_SIZE - 1));
+}
+
+bool BlSim::BestOffsetPrefetcher::rr_hit(uint64_t block_num)
+{
+	return m_rr_table[rr_index(block_num)] == block_num;
+}
+
+void BlSim::BestOffsetPrefetcher::learn(uint64_t block_num)
+{
+	//test one offset per trigger: had block_num - offset been requested recently,
+	//a prefetch with this offset would have covered block_num
+	uint32_t i = m_test_index;
+	bool round_over = false;
+
+	if(rr_hit(block_num - m_offsets[i]))
+	{
+		m_scores[i]++;
+		if(m_scores[i] >= SCORE_MAX)
+		{
+			round_over = true;
+		}
+	}
+
+	m_test_index++;
+	if(m_test_index == m_offsets.size())
+	{
+		m_test_index = 0;
+		m_round++;
+		if(m_round >= ROUND_MAX)
+		{
+			round_over = true;
+		}
+	}
+
+	if(round_over)
+	{
+		uint32_t best = 0;
+		for(i = 1; i < m_scores.size(); i++)
+		{
+			if(m_scores[i] > m_scores[best])
+			{
+				best = i;
+			}
+		}
+		m_best_offset = m_offsets[best];
+		m_prefetch_on = m_scores[best] > BAD_SCORE;
+
+		m_scores.assign(m_offsets.size(), 0);
+		m_test_index = 0;
+		m_round = 0;
+	}
+}
+
+void BlSim::BestOffsetPrefetcher::access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                                         std::vector<uint64_t> &candidates)
+{
+	if(!miss && !prefetch_hit)
+	{
+		return;
+	}
+
+	uint64_t block_num = block_addr >> m_block_bits;
+	learn(block_num);
+
+	if(m_prefetch_on)
+	{
+		for(uint32_t i = 0; i < m_degree; i++)
+		{
+			add_candidate(candidates, block_num + m_best_offset * (int64_t)(i + 1));
+		}
+	}
+}
+
+void BlSim::BestOffsetPrefetcher::fill(uint64_t block_addr, bool prefetch)
+{
+	uint64_t block_num = block_addr >> m_block_bits;
+	if(prefetch)
+	{
+		uint64_t base = block_num - m_best_offset;
+		m_rr_table[rr_index(base)] = base;
+	}
+	else if(!m_prefetch_on)
+	{
+		//keep learning while prefetching is off
+		m_rr_table[rr_index(block_num)] = block_num;
+	}
+}
+
+BlSim::Prefetcher *BlSim::create_prefetcher(const std::string &type, uint32_t block_size,
+                                            uint32_t degree, uint32_t distance)
+{
+	if(type.length() == 0 || type == "none")
+	{
+		return NULL;
+	}
+	else if(type == "next_line")
+	{
+		return new NextLinePrefetcher(block_size, degree, distance);
+	}
+	else if(type == "stride")
+	{
+		return new StridePrefetcher(block_size, degree, distance);
+	}
+	else if(type == "stream")
+	{
+		return new StreamBufferPrefetcher(block_size, degree, distance);
+	}
+	else if(type == "bop")
+	{
+		return new BestOffsetPrefetcher(block_size, degree, distance);
+	}
+
+	cerr<<"WARNING: unknown prefetcher '"<<type<<"'; valid values are 'none', 'next_line', 'stride', 'stream' or 'bop'. Prefetching disabled"<<endl;
+	return NULL;
+}
@@ -0,0 +1,154 @@
+#ifndef PREFETCHER_H_
+#define PREFETCHER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace BlSim
+{
+    /*
+     * Hardware prefetchers attached to the last level cache.
+     *
+     * Caches::access_cache reports every access that reaches the LLC, the
+     * prefetcher answers with candidate block addresses, and Caches queues
+     * the ones not already cached or in flight so the simulator can send them
+     * to the memory system as low priority reads. The block is filled into
+     * the LLC when the read returns (Caches::prefetch_fill).
+     */
+    class Prefetcher
+    {
+        public:
+            //prefetch statistics, updated by Caches
+            uint64_t m_issued;    //prefetch reads sent to the memory system
+            uint64_t m_dropped;   //candidates already cached/in flight, or refused by the memory system
+            uint64_t m_filled;    //prefetched blocks written into the LLC
+            uint64_t m_useful;    //demand hits on a prefetched block before it was evicted
+            uint64_t m_late;      //demand misses on a block whose prefetch was still in flight
+            uint64_t m_useless;   //prefetched blocks evicted without being touched
+            uint64_t m_demand_misses; //LLC demand misses not covered by any prefetch
+
+        protected:
+            uint32_t m_block_bits;
+            uint32_t m_degree;    //how many blocks to prefetch per trigger
+            uint32_t m_distance;  //how far ahead (in blocks) the first prefetch goes
+
+            void add_candidate(std::vector<uint64_t> &candidates, uint64_t block_num);
+
+        public:
+            Prefetcher(uint32_t block_size, uint32_t degree, uint32_t distance);
+            virtual ~Prefetcher() {}
+
+            //an access reached the LLC, block_addr is block aligned;
+            //miss is set for demand misses, prefetch_hit for the first demand hit on a prefetched block
+            virtual void access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                                std::vector<uint64_t> &candidates) = 0;
+            //a block was filled into the LLC, either by a demand miss or a prefetch
+            virtual void fill(uint64_t /*block_addr*/, bool /*prefetch*/) {}
+            virtual const char *name() = 0;
+
+            void print_statistic();
+    };
+
+    //prefetch the next 'degree' blocks starting 'distance' blocks ahead
+    class NextLinePrefetcher : public Prefetcher
+    {
+        public:
+            NextLinePrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance):
+                Prefetcher(block_size, degree, distance) {}
+
+            void access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                        std::vector<uint64_t> &candidates);
+            const char *name() {return "next_line";}
+    };
+
+    //PC-less stride prefetcher, one stream entry per 4KB page
+    class StridePrefetcher : public Prefetcher
+    {
+        protected:
+            enum Stride_Config{TABLE_SIZE=64, PAGE_BITS=12, CONF_MAX=3, CONF_ISSUE=2};
+
+            struct StreamEntry
+            {
+                uint64_t m_page;
+                uint64_t m_last_block;
+                int64_t m_stride;
+                uint32_t m_confidence;
+                uint64_t m_lru;
+                bool m_valid;
+            };
+
+            StreamEntry m_table[TABLE_SIZE];
+            uint64_t m_lru_clock;
+
+        public:
+            StridePrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance);
+
+            void access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                        std::vector<uint64_t> &candidates);
+            const char *name() {return "stride";}
+    };
+
+    //sequential stream buffers, allocated on two misses to adjacent blocks
+    class StreamBufferPrefetcher : public Prefetcher
+    {
+        protected:
+            enum Stream_Config{STREAM_COUNT=16, TRAIN_COUNT=16, TRAIN_WINDOW=4};
+
+            struct StreamBuffer
+            {
+                uint64_t m_next;     //next block the stream expects to be demanded
+                uint64_t m_tail;     //last block already prefetched
+                int64_t m_dir;       //+1 ascending, -1 descending
+                uint64_t m_lru;
+                bool m_valid;
+            };
+
+            StreamBuffer m_streams[STREAM_COUNT];
+            uint64_t m_train[TRAIN_COUNT];  //recent miss blocks, not yet part of a stream
+            uint32_t m_train_next;
+            uint64_t m_lru_clock;
+
+            void run_ahead(StreamBuffer *p_stream, std::vector<uint64_t> &candidates);
+
+        public:
+            StreamBufferPrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance);
+
+            void access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                        std::vector<uint64_t> &candidates);
+            const char *name() {return "stream";}
+    };
+
+    //Best-Offset prefetcher (Michaud, HPCA 2016), distance bounds the largest offset tried
+    class BestOffsetPrefetcher : public Prefetcher
+    {
+        protected:
+            enum BOP_Config{RR_SIZE=256, SCORE_MAX=31, ROUND_MAX=100, BAD_SCORE=1};
+
+            std::vector<int64_t> m_offsets;
+            std::vector<uint32_t> m_scores;
+            uint64_t m_rr_table[RR_SIZE];   //recent requests, holds (filled block - offset in use)
+            uint32_t m_test_index;
+            uint32_t m_round;
+            int64_t m_best_offset;
+            bool m_prefetch_on;
+
+            uint32_t rr_index(uint64_t block_num);
+            bool rr_hit(uint64_t block_num);
+            void learn(uint64_t block_num);
+
+        public:
+            BestOffsetPrefetcher(uint32_t block_size, uint32_t degree, uint32_t distance);
+
+            void access(uint64_t block_addr, bool miss, bool prefetch_hit,
+                        std::vector<uint64_t> &candidates);
+            void fill(uint64_t block_addr, bool prefetch);
+            const char *name() {return "bop";}
+    };
+
+    //returns NULL for "none" or an empty name
+    Prefetcher *create_prefetcher(const std::string &type, uint32_t block_size,
+                                  uint32_t degree, uint32_t distance);
+}
+
+#endif
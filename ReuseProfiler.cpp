@@ -0,0 +1,315 @@
+#include "ReuseProfiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <assert.h>
+using namespace std;
+
+BlSim::ReuseProfiler::ReuseProfiler(uint32_t block_size, double sample_rate, uint64_t epoch_length)
+{
+	m_block_bits = 0;
+	while((1U << m_block_bits) < block_size)
+	{
+		m_block_bits++;
+	}
+
+	if(sample_rate <= 0.0 || sample_rate > 1.0)
+	{
+		cerr<<"WARNING: reuse profiler sample rate "<<sample_rate<<" is not in (0, 1], sampling every block"<<endl;
+		sample_rate = 1.0;
+	}
+	m_sample_rate = sample_rate;
+	m_sample_threshold = (uint64_t)(sample_rate * (1UL << HASH_BITS));
+	m_epoch_length = epoch_length;
+
+	m_tree.assign((1UL << 20) + 1, 0);
+	m_now = 0;
+
+	m_cold = 0;
+	m_epoch_cold = 0;
+	m_accesses = 0;
+	m_sampled = 0;
+	m_epoch_accesses = 0;
+	m_epoch = 0;
+}
+
+uint32_t BlSim::ReuseProfiler::bucket_of(uint64_t distance)
+{
+	if(distance < LINEAR_BUCKETS)
+	{
+		return (uint32_t)distance;
+	}
+
+	uint32_t e = 0;
+	while((distance >> (e + 1)) != 0)
+	{
+		e++;
+	}
+	uint32_t sub = (uint32_t)((distance >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+	return LINEAR_BUCKETS + (e - 4) * SUB_BUCKETS + sub;
+}
+
+uint64_t BlSim::ReuseProfiler::bucket_low(uint32_t bucket)
+{
+	if(bucket < LINEAR_BUCKETS)
+	{
+		return bucket;
+	}
+
+	uint32_t e = (bucket - LINEAR_BUCKETS) / SUB_BUCKETS + 4;
+	uint64_t sub = (bucket - LINEAR_BUCKETS) % SUB_BUCKETS;
+	return (SUB_BUCKETS + sub) << (e - SUB_BUCKET_BITS);
+}
+
+uint64_t BlSim::ReuseProfiler::hash_block(uint64_t block_num)
+{
+	//splitmix64 finalizer
+	uint64_t z = block_num + 0x9e3779b97f4a7c15UL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+	return z ^ (z >> 31);
+}
+
+void BlSim::ReuseProfiler::tree_add(uint64_t time, int32_t value)
+{
+	for(uint64_t i = time + 1; i < m_tree.size(); i += i & (~i + 1))
+	{
+		m_tree[i] += value;
+	}
+}
+
+uint64_t BlSim::ReuseProfiler::tree_prefix(uint64_t time)
+{
+	uint64_t sum = 0;
+	for(uint64_t i = time + 1; i > 0; i -= i & (~i + 1))
+	{
+		sum += m_tree[i];
+	}
+	return sum;
+}
+
+void BlSim::ReuseProfiler::compact()
+{
+	//the timestamps ran out: renumber the live blocks 0..n-1 in access order
+	std::vector<std::pair<uint64_t, uint64_t> > live;
+	std::map<uint64_t, uint64_t>::iterator it;
+	size_t i;
+
+	live.reserve(m_last_access.size());
+	for(it = m_last_access.begin(); it != m_last_access.end(); it++)
+	{
+		live.push_back(std::make_pair(it->second, it->first));
+	}
+	std::sort(live.begin(), live.end());
+
+	m_tree.assign(std::max((size_t)(1UL << 20), 2 * live.size()) + 1, 0);
+	for(i = 0; i < live.size(); i++)
+	{
+		m_last_access[live[i].second] = i;
+		tree_add(i, 1);
+	}
+	m_now = live.size();
+}
+
+void BlSim::ReuseProfiler::add_distance(std::vector<uint64_t> &histogram, uint64_t distance)
+{
+	uint32_t bucket = bucket_of(distance);
+	if(bucket >= histogram.size())
+	{
+		histogram.resize(bucket + 1, 0);
+	}
+	histogram[bucket]++;
+}
+
+void BlSim::ReuseProfiler::access(uint64_t maddr)
+{
+	uint64_t block_num = maddr >> m_block_bits;
+
+	m_accesses++;
+	m_epoch_accesses++;
+
+	if((hash_block(block_num) & ((1UL << HASH_BITS) - 1)) < m_sample_threshold)
+	{
+		m_sampled++;
+		if(m_now + 1 >= m_tree.size())
+		{
+			compact();
+		}
+
+		std::map<uint64_t, uint64_t>::iterator it = m_last_access.find(block_num);
+		if(it != m_last_access.end())
+		{
+			//distinct sampled blocks touched since the last access, scaled back to the whole trace
+			uint64_t last = it->second;
+			uint64_t distance = tree_prefix(m_now - 1) - tree_prefix(last);
+			distance = (uint64_t)(distance / m_sample_rate + 0.5);
+
+			tree_add(last, -1);
+			it->second = m_now;
+			add_distance(m_histogram, distance);
+			add_distance(m_epoch_histogram, distance);
+		}
+		else
+		{
+			m_cold++;
+			m_epoch_cold++;
+			m_last_access[block_num] = m_now;
+		}
+		tree_add(m_now, 1);
+		m_now++;
+	}
+
+	if(m_epoch_length && m_epoch_accesses >= m_epoch_length)
+	{
+		end_epoch();
+	}
+}
+
+void BlSim::ReuseProfiler::print_histogram(const std::vector<uint64_t> &histogram, uint64_t cold)
+{
+	//group the buckets by power of two for printing
+	uint64_t range_low = 0;
+	uint64_t range_count = 0;
+	uint32_t b;
+
+	cout<<"    [cold] : "<<cold<<endl;
+	for(b = 0; b < histogram.size(); b++)
+	{
+		uint64_t low = bucket_low(b);
+		if(low != 0 && (low & (low - 1)) == 0 && low != range_low)
+		{
+			if(range_count)
+			{
+				cout<<"    ["<<range_low<<"-"<<low-1<<"] : "<<range_count<<endl;
+			}
+			range_low = low;
+			range_count = 0;
+		}
+		range_count += histogram[b];
+	}
+	if(range_count)
+	{
+		cout<<"    ["<<range_low<<"-"<<2*range_low-1<<"] : "<<range_count<<endl;
+	}
+}
+
+void BlSim::ReuseProfiler::end_epoch()
+{
+	cout<<"reuse epoch "<<m_epoch<<": accesses: "<<m_epoch_accesses<<endl;
+	print_histogram(m_epoch_histogram, m_epoch_cold);
+
+	m_epoch_histogram.clear();
+	m_epoch_cold = 0;
+	m_epoch_accesses = 0;
+	m_epoch++;
+}
+
+//probability that fewer than 'ways' of the 'distance' blocks in between land in the same set
+static double hit_probability(uint64_t distance, uint64_t sets, uint32_t ways)
+{
+	if(distance < ways)
+	{
+		return 1.0;
+	}
+	if(sets == 1)
+	{
+		return 0.0;
+	}
+
+	double p = 1.0 / sets;
+	double term = exp(distance * log1p(-p));
+	double sum = term;
+	for(uint32_t k = 0; k + 1 < ways; k++)
+	{
+		term *= (double)(distance - k) / (k + 1) * p / (1.0 - p);
+		sum += term;
+	}
+	return sum < 1.0 ? sum : 1.0;
+}
+
+double BlSim::ReuseProfiler::miss_ratio(uint64_t capacity_blocks, uint32_t ways)
+{
+	double misses = m_cold;
+	uint32_t b;
+
+	if(m_sampled == 0)
+	{
+		return 0.0;
+	}
+
+	for(b = 0; b < m_histogram.size(); b++)
+	{
+		if(m_histogram[b] == 0)
+		{
+			continue;
+		}
+		if(ways == 0)
+		{
+			//fully associative LRU: a hit exactly when the distance is below the capacity
+			if(bucket_low(b) >= capacity_blocks)
+			{
+				misses += m_histogram[b];
+			}
+		}
+		else
+		{
+			uint64_t middle = (bucket_low(b) + bucket_low(b + 1) - 1) / 2;
+			misses += m_histogram[b] * (1.0 - hit_probability(middle, capacity_blocks / ways, ways));
+		}
+	}
+	return misses / m_sampled;
+}
+
+void BlSim::ReuseProfiler::print_statistic()
+{
+	static const uint32_t assoc[] = {1, 2, 4, 8, 16};
+	const uint32_t assoc_count = sizeof(assoc) / sizeof(assoc[0]);
+	uint64_t largest = m_histogram.empty() ? 1 : bucket_low(m_histogram.size());
+	uint64_t capacity;
+	uint32_t i;
+
+	cout<<"reuse profile: accesses: "<<m_accesses<<"\t sampled: "<<m_sampled
+		<<" (rate "<<m_sample_rate<<")\t cold: "<<m_cold<<endl;
+	print_histogram(m_histogram, m_cold);
+
+	cout<<"miss ratio curve (LRU):"<<endl;
+	cout<<"    capacity\t full";
+	for(i = 0; i < assoc_count; i++)
+	{
+		cout<<"\t "<<assoc[i]<<"-way";
+	}
+	cout<<endl;
+
+	for(capacity = 1; capacity <= 2 * largest; capacity <<= 1)
+	{
+		uint64_t bytes = capacity << m_block_bits;
+		if(bytes >= (1UL << 20))
+		{
+			cout<<"    "<<(bytes >> 20)<<"MB";
+		}
+		else if(bytes >= (1UL << 10))
+		{
+			cout<<"    "<<(bytes >> 10)<<"KB";
+		}
+		else
+		{
+			cout<<"    "<<bytes<<"B";
+		}
+		cout<<"\t "<<miss_ratio(capacity, 0);
+		for(i = 0; i < assoc_count; i++)
+		{
+			if(capacity >= assoc[i])
+			{
+				cout<<"\t "<<miss_ratio(capacity, assoc[i]);
+			}
+			else
+			{
+				cout<<"\t -";
+			}
+		}
+		cout<<endl;
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef REUSE_PROFILER_H_
+#define REUSE_PROFILER_H_
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace BlSim
+{
+    /*
+     * One-pass reuse (LRU stack) distance profiler.
+     *
+     * Every block access is timestamped; a Fenwick tree over the timestamps
+     * marks the last access of each live block, so the number of distinct
+     * blocks touched since the previous access to a block is a prefix sum
+     * (Olken's algorithm). SHARDS spatial sampling keeps only the blocks
+     * whose hash falls under the sample rate and scales their distances back
+     * up by 1/rate.
+     *
+     * The distance histogram gives the fully associative LRU miss ratio for
+     * every capacity at once; set associative caches are approximated by
+     * assuming the blocks in between spread uniformly over the sets.
+     */
+    class ReuseProfiler
+    {
+        protected:
+            //log-linear histogram: distances below LINEAR_BUCKETS are exact,
+            //above that every power of two is split into SUB_BUCKETS buckets
+            enum Histogram_Config{LINEAR_BUCKETS=16, SUB_BUCKET_BITS=3, SUB_BUCKETS=8, HASH_BITS=24};
+
+            uint32_t m_block_bits;
+            uint64_t m_sample_threshold;   //a block is sampled when its hash is below this
+            double m_sample_rate;
+            uint64_t m_epoch_length;       //accesses per epoch, 0 for no epochs
+
+            std::map<uint64_t, uint64_t> m_last_access;  //sampled block -> timestamp of its last access
+            std::vector<uint32_t> m_tree;  //Fenwick tree over timestamps, 1 where a block was last accessed
+            uint64_t m_now;
+
+            std::vector<uint64_t> m_histogram;
+            std::vector<uint64_t> m_epoch_histogram;
+            uint64_t m_cold;
+            uint64_t m_epoch_cold;
+            uint64_t m_accesses;        //all accesses, sampled or not
+            uint64_t m_sampled;
+            uint64_t m_epoch_accesses;
+            uint64_t m_epoch;
+
+            static uint32_t bucket_of(uint64_t distance);
+            static uint64_t bucket_low(uint32_t bucket);
+            static uint64_t hash_block(uint64_t block_num);
+
+            void tree_add(uint64_t time, int32_t value);
+            uint64_t tree_prefix(uint64_t time);  //marks in [0, time]
+            void compact();
+            void add_distance(std::vector<uint64_t> &histogram, uint64_t distance);
+            void print_histogram(const std::vector<uint64_t> &histogram, uint64_t cold);
+            double miss_ratio(uint64_t capacity_blocks, uint32_t ways);
+
+        public:
+            ReuseProfiler(uint32_t block_size, double sample_rate, uint64_t epoch_length);
+
+            void access(uint64_t maddr);
+            void end_epoch();
+
+            //miss ratio curve for power of two capacities, fully associative and for a few associativities
+            void print_statistic();
+    };
+}
+
+#endif
@@ -10,6 +10,7 @@
 #include "Callback.h"
 #include "ClockDomain.h"
 #include "CacheSimulator.h"
+#include "MappingSelector.h"
 
 namespace DRAMSim
 {
@@ -22,6 +23,8 @@ namespace DRAMSim
 	static uint64_t trans_count = 0;
 	static uint64_t hit_count=0;
 	static uint64_t miss_count=0;
+	static uint64_t writeback_count=0;
+	static uint64_t walk_miss_count=0;
 
 	Simulator::~Simulator()
 	{
@@ -29,10 +32,20 @@ namespace DRAMSim
 		{
 			delete trans;
 		}
+		delete writeback;
+
+		for (map<uint64_t, vector<Transaction*> >::iterator it=prefetchWaiters.begin(); it!=prefetchWaiters.end(); it++)
+		{
+			for (size_t i=0; i<it->second.size(); i++)
+			{
+				delete it->second[i];
+			}
+		}
 
 		delete simIO;
 		delete clockDomainDRAM;
 		delete clockDomainCPU;
+		delete pageMapper;
 		delete (memorySystem);
 	}
 
@@ -49,12 +62,17 @@ namespace DRAMSim
 #endif
 
 		memorySystem= new MemorySystem();
+		if (addressMappingScheme == SchemeAuto)
+		{
+			selectAddressMapping();
+		}
 //Added by libing 
 		//cache = new Caches(NULL, 4);
 #ifdef RETURN_TRANSACTIONS
 		transReceiver = new TransactionReceiver;
 		/* create and register our callback functions */
-		TransactionCompleteCB *read_cb = new CallbackP3<TransactionReceiver, void, unsigned, uint64_t, uint64_t>(transReceiver, &TransactionReceiver::read_complete);
+		// reads come back through the simulator first so prefetch fills can be picked off
+		TransactionCompleteCB *read_cb = new CallbackP3<Simulator, void, unsigned, uint64_t, uint64_t>(this, &Simulator::readComplete);
 		TransactionCompleteCB *write_cb = new CallbackP3<TransactionReceiver, void, unsigned, uint64_t, uint64_t>(transReceiver, &TransactionReceiver::write_complete);
 		memorySystem->registerCallbacks(read_cb, write_cb, NULL);
 #endif
@@ -68,6 +86,29 @@ namespace DRAMSim
 
 		// create cache
 		myCache = new Caches(NULL, 4);
+		configureCache(myCache);
+		if (DRAM_AWARE_WRITEBACK)
+		{
+			if (!LLC_WRITEBACKS)
+			{
+				ERROR("DRAM_AWARE_WRITEBACK needs LLC_WRITEBACKS=true");
+				exit(-1);
+			}
+			myCache->set_row_writeback(rowColumnMask(), WRITEBACK_CLEAN_WAYS);
+		}
+		if (REUSE_PROFILER)
+		{
+			myCache->set_reuse_profiler(new BlSim::ReuseProfiler(64, REUSE_SAMPLE_RATE, REUSE_EPOCH_LENGTH));
+		}
+		if (STACK_SIM_WAYS > 0)
+		{
+			myCache->set_stack_simulator(new BlSim::StackSimulator(64, STACK_SIM_MIN_SETS, STACK_SIM_MAX_SETS, STACK_SIM_WAYS));
+		}
+		if (!MISS_TRACE_FILE.empty())
+		{
+			myCache->set_miss_trace(new BlSim::MissTraceWriter(MISS_TRACE_FILE));
+		}
+		pageMapper = createPageMapper();
 
 		// for compatibility with the old marss code which assumed an sg15 part with a
 		// 2GHz CPU, the new code will reset this value later
@@ -83,10 +124,15 @@ namespace DRAMSim
 
 	void Simulator::start()
 	{
+		if (FAST_FORWARD > 0)
+		{
+			fastForward(FAST_FORWARD);
+		}
+
 #ifdef RETURN_TRANSACTIONS
 		if (simIO->cycleNum == 0)
 		{
-			while (pendingTrace || transReceiver->pendingTrans() )//libing
+			while (pendingTrace || !cacheRequests.empty() || !prefetchWaiters.empty() || writebackPending() || transReceiver->pendingTrans() )//libing
 			//while (pendingTrace == true || transReceiver->pendingTrans() == true)
 			{
 				clockDomainTREE->tick();
@@ -97,53 +143,675 @@ namespace DRAMSim
 #endif
 		{
 			while (clockDomainTREE->clockcycle < simIO->cycleNum &&
-				( pendingTrace ||  transReceiver->pendingTrans() ))
+				( pendingTrace || !cacheRequests.empty() || !prefetchWaiters.empty() || writebackPending() || transReceiver->pendingTrans() ))
 			{
 				clockDomainTREE->tick();
 			}
 		}
 		myCache->dump_statistic();
+		myCache->close_miss_trace();
 		std::cout << "\t hit_count: " << hit_count
 				<< "\t miss_count: " << miss_count
 				<<"\t transaction count: " << trans_count << std::endl;
+		if (LLC_WRITEBACKS)
+		{
+			std::cout << "\t writeback count: " << writeback_count << std::endl;
+		}
+		if (pageMapper != NULL)
+		{
+			pageMapper->printStats();
+			std::cout << "\t page walk miss count: " << walk_miss_count << std::endl;
+		}
+#ifdef MS_BUFFER
+		memorySystem->printPendingStats();
+#endif
+		if (MERGE_BUFFER_ENTRIES > 0)
+		{
+			memorySystem->printMergeStats();
+		}
+		if (NVM_CHANNELS > 0)
+		{
+			memorySystem->printTierStats();
+		}
+		if (CXL_CHANNELS > 0)
+		{
+			memorySystem->printCxlStats();
+		}
+		memorySystem->printMappingStats();
+#ifdef RETURN_TRANSACTIONS
+		transReceiver->printReadLatencies();
+#endif
 	}
 
 
 
 	void Simulator::update()
 	{
-		//bool writeback=false;
-		bool hit=false;
-			trans = simIO->nextTrans();
-			if (trans) {
-				hit = myCache->access_cache(trans->address, trans->transactionType); //libing
-				//writeback= myCache->writebackornot();
-			}
-			
+		const uint64_t currentClockCycle = clockDomainCPU->clockcycle;
+
+		// hold on to the next trace record until its trace time has come
+		if (pendingTrace && trans == NULL)
+		{
+			trans = nextTrans();
 			if (trans == NULL)
 			{
 				pendingTrace = false;
-				return;
 			}
+		}
+
+		if (trans != NULL && !memoryFull && currentClockCycle >= trans->timeTraced && myCache->port_available(currentClockCycle))
+		{
+			// BlSim numbers the request types the other way round (MEM_WRITE is 0)
+			uint32_t memop = (trans->transactionType == Transaction::DATA_WRITE) ? BlSim::MEM_WRITE : BlSim::MEM_READ;
+			CacheRequest request;
+			request.trans = trans;
+			myCache->set_core(trans->coreID);
+			myCache->set_access_bytes(trans->byteOffset, trans->len * TRANS_DATA_BYTES / LEN_DEF);
+			if (trans->data != NULL && !trans->data->hasNoData())
+			{
+				// the compressed LLC sizes the block from the data written to it
+				myCache->set_access_data(trans->byteOffset, trans->data->getData(), trans->data->getNumBytes());
+			}
+			request.hit = myCache->access_cache(trans->address, memop, currentClockCycle, &request.readyCycle); //libing
+#ifndef DATA_STORAGE
+			if (trans->data != NULL)
+			{
+				// the payload was only parsed for the compressor, the memory system does not store data
+				delete trans->data;
+				trans->data = NULL;
+			}
+#endif
+			if (!request.hit && SECTOR_BYTES > 0)
+			{
+				// only the sectors the caches do not have go to memory
+				trans->len = myCache->get_fetch_sectors() * LEN_DEF / myCache->get_sector_count();
+			}
+			trans->timeIssued = currentClockCycle;
+			cacheRequests.push_back(request);
+			trans = NULL;
+		}
+
+		// writebacks and then prefetches only use the cycles left over by demand requests
+		if (!updateCacheRequests() && !issueWriteback())
+		{
+			if (DRAM_AWARE_WRITEBACK && memorySystem->isIdle())
+			{
+				// the writebacks it queues go out from the next cycle on
+				myCache->eager_clean();
+			}
+			issuePrefetch();
+		}
+	}
+
 
+	// retire the requests whose cache lookup is done, returns true if a miss went to memory
+	bool Simulator::updateCacheRequests()
+	{
+		const uint64_t currentClockCycle = clockDomainCPU->clockcycle;
+		bool sent = false;
 
-		if ((!hit)&&(clockDomainCPU->clockcycle >= trans->timeTraced))//libing
-		//if (clockDomainCPU->clockcycle >= trans->timeTraced)
+		memoryFull = false;
+		list<CacheRequest>::iterator it = cacheRequests.begin();
+		while (it != cacheRequests.end())
 		{
-			//miss_count++;
-			//cout << trans << endl;
-			if(memorySystem->addTransaction(trans))
+			Transaction *request = it->trans;
+			if (it->readyCycle > currentClockCycle)
 			{
+				it++;
+				continue;
+			}
+
+			if (it->hit)
+			{
+				hit_count++;
+#ifdef RETURN_TRANSACTIONS
+				if (request->transactionType == Transaction::DATA_READ)
+				{
+					transReceiver->insertReadLatency(currentClockCycle - request->timeIssued);
+				}
+#endif
+				delete request;
+			}
+			else if (request->transactionType == Transaction::DATA_READ && myCache->prefetch_pending(request->address))
+			{
+				// the block is already on its way, the demand waits for the prefetch to bring it
+				miss_count++;
+#ifdef RETURN_TRANSACTIONS
+				transReceiver->addPending(request, request->timeIssued);
+#endif
+				prefetchWaiters[blockAddress(request->address)].push_back(request);
+			}
+			else if (memorySystem->addTransaction(request))
+			{
+				miss_count++;
 				trans_count++;
+				if (request->isPageWalk)
+				{
+					walk_miss_count++;
+				}
 #ifdef RETURN_TRANSACTIONS
-				transReceiver->addPending(trans, clockDomainCPU->clockcycle);
+				// latency is counted from the start of the cache lookup
+				transReceiver->addPending(request, request->timeIssued);
 #endif
 				// the memory system accepted our request so now it takes ownership of it
-				trans=NULL;
+				sent = true;
+			}
+			else
+			{
+				// no room in the memory system, retry next cycle
+				memoryFull = true;
+				it++;
+				continue;
+			}
+			it = cacheRequests.erase(it);
+		}
+		return sent;
+	}
+
+
+	// warm up the caches with the first records of the trace, in batches split by cache set over CACHE_THREADS
+	void Simulator::fastForward(uint64_t records)
+	{
+		const size_t batchSize = 1 << 16;
+		vector<uint64_t> addresses;
+		vector<uint32_t> memops;
+		vector<uint32_t> cores;
+		vector<uint8_t> sectors;
+		uint64_t done = 0;
+
+		addresses.reserve(batchSize);
+		memops.reserve(batchSize);
+		cores.reserve(batchSize);
+		sectors.reserve(batchSize);
+		myCache->set_thread_count(CACHE_THREADS);
+
+		while (done < records && pendingTrace)
+		{
+			addresses.clear();
+			memops.clear();
+			cores.clear();
+			sectors.clear();
+			while (addresses.size() < batchSize && done < records)
+			{
+				Transaction *record = nextTrans();
+				if (record == NULL)
+				{
+					pendingTrace = false;
+					break;
+				}
+				addresses.push_back(record->address);
+				memops.push_back(record->transactionType == Transaction::DATA_WRITE ? BlSim::MEM_WRITE : BlSim::MEM_READ);
+				cores.push_back(record->coreID);
+				sectors.push_back(myCache->sector_mask(record->byteOffset, record->len * TRANS_DATA_BYTES / LEN_DEF));
+				if (record->data != NULL && !record->data->hasNoData())
+				{
+					// the batch does not take payloads, the compressor sees the data ahead of the fills
+					myCache->store_data(record->address + record->byteOffset, record->data->getData(), record->data->getNumBytes());
+					delete record->data;
+				}
+				delete record;
+				done++;
+			}
+			if (!addresses.empty())
+			{
+				myCache->access_cache_batch(&addresses[0], &memops[0], &cores[0], &sectors[0], addresses.size(), NULL);
 			}
 		}
 
-}
+		PRINT("Fast forwarded "<<done<<" trace records through the caches on "<<CACHE_THREADS<<" thread(s)");
+		myCache->dump_statistic();
+		myCache->reset_statistic();
+	}
+
+
+	// runs the first AUTO_MAPPING_RECORDS records through a scratch copy of the configured caches and
+	// page mapping, ranks the mappings on what goes to memory and rewinds the trace for the real run
+	void Simulator::selectAddressMapping()
+	{
+		if (memorySystem->interleavesByCapacity())
+		{
+			// the selector scores one interleave over all channels alike
+			ERROR("ADDRESS_MAPPING_SCHEME=auto needs channels of one geometry, without NVM_CHANNELS or a range mapped CXL expander");
+			exit(-1);
+		}
+		if (PAGE_SIZE > 0 && (PAGE_POLICY == "coloring" || PAGE_POLICY == "bank_partition"))
+		{
+			ERROR("ADDRESS_MAPPING_SCHEME=auto cannot be used with PAGE_POLICY="<<PAGE_POLICY<<", the page colors come from the mapping it picks");
+			exit(-1);
+		}
+
+		Caches sampleCache(NULL, 4);
+		configureCache(&sampleCache);
+		PageMapper *sampleMapper = createPageMapper();
+		MappingSelector selector;
+		vector<uint64_t> walks;
+		uint64_t records = 0;
+
+		while (records < AUTO_MAPPING_RECORDS)
+		{
+			Transaction *record = simIO->nextTrans();
+			if (record == NULL)
+			{
+				break;
+			}
+			walks.clear();
+			if (sampleMapper != NULL)
+			{
+				sampleMapper->translate(record, walks);
+			}
+			sampleCache.set_core(record->coreID);
+			for (size_t i=0; i<walks.size(); i++)
+			{
+				sampleCache.set_access_bytes(0, TRANS_DATA_BYTES / LEN_DEF);
+				if (!sampleCache.access_cache(walks[i], BlSim::MEM_READ))
+				{
+					selector.addSample(walks[i]);
+				}
+			}
+
+			uint32_t memop = (record->transactionType == Transaction::DATA_WRITE) ? BlSim::MEM_WRITE : BlSim::MEM_READ;
+			sampleCache.set_access_bytes(record->byteOffset, record->len * TRANS_DATA_BYTES / LEN_DEF);
+			if (record->data != NULL && !record->data->hasNoData())
+			{
+				sampleCache.set_access_data(record->byteOffset, record->data->getData(), record->data->getNumBytes());
+			}
+			if (!sampleCache.access_cache(record->address, memop))
+			{
+				selector.addSample(record->address);
+			}
+
+			// prefetches and writebacks go to memory as well, a prefetch is taken to fill at once
+			uint64_t addr;
+			uint32_t core, sectors;
+			while (sampleCache.get_prefetch_request(&addr, &core))
+			{
+				selector.addSample(addr);
+				sampleCache.prefetch_issued(addr, core);
+				sampleCache.prefetch_fill(addr);
+			}
+			while (sampleCache.get_writeback_request(&addr, &sectors))
+			{
+				selector.addSample(addr);
+			}
+			if (record->data != NULL)
+			{
+				delete record->data;
+			}
+			delete record;
+			records++;
+		}
+		delete sampleMapper;
+		simIO->rewindTrace();
+
+		if (selector.sampleCount() == 0)
+		{
+			ERROR("ADDRESS_MAPPING_SCHEME=auto found no memory accesses in the first "<<records<<" trace records");
+			exit(-1);
+		}
+		string layout, hash;
+		selector.select(layout, hash);
+		ADDRESS_MAPPING_SCHEME = layout;
+		ADDRESS_HASH = hash;
+		addressMappingScheme = SchemeCustom;
+		memorySystem->setAddressMapping(layout, hash);
+	}
+
+
+	// the next trace record with its address translated, the page table reads of a TLB miss come first
+	Transaction *Simulator::nextTrans()
+	{
+		if (!pendingWalks.empty())
+		{
+			Transaction *walk = pendingWalks.front();
+			pendingWalks.pop_front();
+			return walk;
+		}
+
+		Transaction *record = simIO->nextTrans();
+		if (record == NULL || pageMapper == NULL)
+		{
+			return record;
+		}
+
+		walkAddresses.clear();
+		pageMapper->translate(record, walkAddresses);
+		for (size_t i=0; i<walkAddresses.size(); i++)
+		{
+			Transaction *walk = new Transaction(Transaction::DATA_READ, walkAddresses[i], NULL, 1, record->timeTraced);
+			walk->coreID = record->coreID;
+			walk->isPageWalk = true;
+			pendingWalks.push_back(walk);
+		}
+		if (pendingWalks.empty())
+		{
+			return record;
+		}
+		pendingWalks.push_back(record);
+		return nextTrans();
+	}
+
+
+	// the address bits that only change the DRAM column, i.e. select a block inside its row
+	uint64_t Simulator::rowColumnMask()
+	{
+		unsigned chan, rank, bank, row, col;
+		uint64_t mask = 0;
+
+		memorySystem->addressMapping(0, chan, rank, bank, row, col);
+		for (unsigned bit=dramsim_log2(TRANS_DATA_BYTES); bit<48; bit++)
+		{
+			unsigned bitChan, bitRank, bitBank, bitRow, bitCol;
+			memorySystem->addressMapping(1UL << bit, bitChan, bitRank, bitBank, bitRow, bitCol);
+			if (bitChan == chan && bitRank == rank && bitBank == bank && bitRow == row && bitCol != col)
+			{
+				mask |= 1UL << bit;
+			}
+		}
+		return mask;
+	}
+
+
+	// CACHE_TAG_LATENCY, CACHE_DATA_LATENCY and CACHE_PORTS hold one value per cache level, e.g. "1:2:6"
+	static vector<unsigned> parseLevelList(const string &value)
+	{
+		vector<unsigned> levels;
+		size_t start = 0;
+		while (start < value.length())
+		{
+			size_t end = value.find(':', start);
+			if (end == string::npos)
+			{
+				end = value.length();
+			}
+			levels.push_back(atoi(value.substr(start, end - start).c_str()));
+			start = end + 1;
+		}
+		return levels;
+	}
+
+
+	// the cache hierarchy the ini describes, for the simulated caches and for the auto mapping's sample
+	void Simulator::configureCache(Caches *cache)
+	{
+		setCacheLevels(cache);
+		cache->set_prefetcher(BlSim::create_prefetcher(PREFETCHER, 64, PREFETCH_DEGREE, PREFETCH_DISTANCE));
+		setCacheTiming(cache);
+		setCacheInclusion(cache);
+		cache->set_core_count(CACHE_CORES, COHERENCE_LATENCY);
+		setCachePartition(cache);
+		cache->set_compressor(BlSim::create_compressor(LLC_COMPRESSION, 64));
+		cache->set_sector_size(SECTOR_BYTES);
+		cache->set_writeback_queue(LLC_WRITEBACKS);
+	}
+
+
+	// NULL without PAGE_SIZE, the trace addresses are physical then
+	PageMapper *Simulator::createPageMapper()
+	{
+		if (PAGE_SIZE == 0)
+		{
+			return NULL;
+		}
+		PageMapper::AllocationPolicy policy = PageMapper::Sequential;
+		if (PAGE_POLICY == "random")
+		{
+			policy = PageMapper::Random;
+		}
+		else if (PAGE_POLICY == "coloring")
+		{
+			policy = PageMapper::Coloring;
+		}
+		else if (PAGE_POLICY == "bank_partition")
+		{
+			policy = PageMapper::BankPartition;
+		}
+		else if (PAGE_POLICY != "sequential" && PAGE_POLICY != "")
+		{
+			ERROR("Unknown PAGE_POLICY '"<<PAGE_POLICY<<"'; valid values are 'sequential', 'random', 'coloring' or 'bank_partition'");
+			exit(-1);
+		}
+		return new PageMapper(memorySystem, PAGE_SIZE, policy, CACHE_CORES, TLB_ENTRIES);
+	}
+
+
+	void Simulator::setCacheLevels(Caches *cache)
+	{
+		vector<unsigned> sizes = parseLevelList(CACHE_SIZES_KB);
+		vector<unsigned> ways = parseLevelList(CACHE_WAYS);
+
+		if (sizes.empty() && ways.empty())
+		{
+			return;
+		}
+		if (sizes.size() != ways.size())
+		{
+			ERROR("CACHE_SIZES_KB and CACHE_WAYS need one value for each cache level, they give "<<sizes.size()<<" and "<<ways.size());
+			exit(-1);
+		}
+
+		vector<uint64_t> capacities;
+		for (size_t i=0; i<sizes.size(); i++)
+		{
+			capacities.push_back((uint64_t)sizes[i] << 10);
+		}
+		cache->set_levels(sizes.size(), &capacities[0], &ways[0]);
+	}
+
+
+	void Simulator::setCacheTiming(Caches *cache)
+	{
+		vector<unsigned> tagLatency = parseLevelList(CACHE_TAG_LATENCY);
+		vector<unsigned> dataLatency = parseLevelList(CACHE_DATA_LATENCY);
+		vector<unsigned> ports = parseLevelList(CACHE_PORTS);
+
+		// keep the built-in timing when nothing is configured
+		if (tagLatency.empty() && dataLatency.empty() && ports.empty())
+		{
+			return;
+		}
+
+		unsigned levels = cache->get_level_count();
+		vector<unsigned> *lists[] = {&tagLatency, &dataLatency, &ports};
+		for (unsigned i=0; i<3; i++)
+		{
+			// a single value applies to every level, like CACHE_INCLUSION
+			if (lists[i]->size() == 1)
+			{
+				lists[i]->assign(levels, (*lists[i])[0]);
+			}
+			if (lists[i]->size() != levels)
+			{
+				ERROR("CACHE_TAG_LATENCY, CACHE_DATA_LATENCY and CACHE_PORTS need one value, or one for each of the "<<levels<<" cache levels");
+				exit(-1);
+			}
+		}
+
+		for (unsigned i=0; i<levels; i++)
+		{
+			cache->set_level_timing(i, tagLatency[i], dataLatency[i], ports[i]);
+		}
+	}
+
+
+	// CACHE_INCLUSION is either one policy for every level below the first or one per level, e.g. "inclusive:nine:exclusive"
+	void Simulator::setCacheInclusion(Caches *cache)
+	{
+		vector<string> policies;
+		size_t start = 0;
+		while (start < CACHE_INCLUSION.length())
+		{
+			size_t end = CACHE_INCLUSION.find(':', start);
+			if (end == string::npos)
+			{
+				end = CACHE_INCLUSION.length();
+			}
+			policies.push_back(CACHE_INCLUSION.substr(start, end - start));
+			start = end + 1;
+		}
+		if (policies.empty())
+		{
+			return;
+		}
+
+		unsigned levels = cache->get_level_count();
+		if (policies.size() != 1 && policies.size() != levels)
+		{
+			ERROR("CACHE_INCLUSION needs one policy or one for each of the "<<levels<<" cache levels");
+			exit(-1);
+		}
+		if (levels == 1 && policies[0] != "inclusive")
+		{
+			// nothing above the LLC to back-invalidate or take victims from
+			ERROR("CACHE_INCLUSION="<<CACHE_INCLUSION<<" needs more than one cache level, there is only the LLC");
+			exit(-1);
+		}
+
+		// the first level has nothing above it, its entry is ignored
+		for (unsigned i=1; i<levels; i++)
+		{
+			const string &policy = policies[policies.size() == 1 ? 0 : i];
+			if (policy == "inclusive")
+			{
+				cache->set_inclusion(i, BlSim::INCLUSIVE);
+			}
+			else if (policy == "nine")
+			{
+				cache->set_inclusion(i, BlSim::NINE);
+			}
+			else if (policy == "exclusive")
+			{
+				cache->set_inclusion(i, BlSim::EXCLUSIVE);
+			}
+			else
+			{
+				ERROR("Unknown CACHE_INCLUSION policy '"<<policy<<"'; valid values are 'inclusive', 'nine' or 'exclusive'");
+				exit(-1);
+			}
+		}
+	}
+
+
+	// LLC_WAY_MASKS holds one hex way mask per core separated by ':', e.g. "0x00ff:0xff00";
+	// UCP_EPOCH > 0 lets the UCP partitioner move the ways, starting from an even split
+	void Simulator::setCachePartition(Caches *cache)
+	{
+		if (UCP_EPOCH > 0)
+		{
+			if (!LLC_WAY_MASKS.empty())
+			{
+				ERROR("LLC_WAY_MASKS and UCP_EPOCH both partition the LLC, set only one of them");
+				exit(-1);
+			}
+			cache->set_way_partitioner(new BlSim::WayPartitioner(CACHE_CORES, cache->get_llc_way_count(),
+				64, cache->get_llc_set_count(), UCP_EPOCH));
+			return;
+		}
+
+		vector<string> masks;
+		size_t start = 0;
+		while (start < LLC_WAY_MASKS.length())
+		{
+			size_t end = LLC_WAY_MASKS.find(':', start);
+			if (end == string::npos)
+			{
+				end = LLC_WAY_MASKS.length();
+			}
+			masks.push_back(LLC_WAY_MASKS.substr(start, end - start));
+			start = end + 1;
+		}
+		if (masks.empty())
+		{
+			return;
+		}
+
+		if (masks.size() != CACHE_CORES)
+		{
+			ERROR("LLC_WAY_MASKS needs one way mask for each of the "<<CACHE_CORES<<" cores");
+			exit(-1);
+		}
+		for (unsigned i=0; i<masks.size(); i++)
+		{
+			cache->set_way_mask(i, strtoul(masks[i].c_str(), NULL, 16));
+		}
+	}
+
+
+	void Simulator::issuePrefetch()
+	{
+		uint64_t addr;
+		uint32_t core;
+		if (!myCache->get_prefetch_request(&addr, &core))
+		{
+			return;
+		}
+
+		Transaction *prefetch = new Transaction(Transaction::DATA_READ, addr, NULL, LEN_DEF, clockDomainCPU->clockcycle);
+		prefetch->isPrefetch = true;
+		prefetch->coreID = core;
+		if (memorySystem->addTransaction(prefetch))
+		{
+			myCache->prefetch_issued(prefetch->address, core);
+		}
+		else
+		{
+			myCache->prefetch_dropped(addr);
+			delete prefetch;
+		}
+	}
+
+
+	// sends the next dirty LLC victim to memory, returns true if one was accepted
+	bool Simulator::issueWriteback()
+	{
+		if (writeback == NULL)
+		{
+			uint64_t addr;
+			uint32_t sectors;
+			if (!myCache->get_writeback_request(&addr, &sectors))
+			{
+				return false;
+			}
+			writeback = new Transaction(Transaction::DATA_WRITE, addr, NULL, sectors * LEN_DEF / myCache->get_sector_count(), clockDomainCPU->clockcycle);
+		}
+
+		if (!memorySystem->addTransaction(writeback))
+		{
+			// no room, try again next cycle
+			return false;
+		}
+#ifdef RETURN_TRANSACTIONS
+		transReceiver->addPending(writeback, clockDomainCPU->clockcycle);
+#endif
+		writeback_count++;
+		writeback = NULL;
+		return true;
+	}
+
+
+	void Simulator::readComplete(unsigned id, uint64_t address, uint64_t done_cycle)
+	{
+		if (myCache->prefetch_fill(address))
+		{
+			// the demands that found the prefetch in flight are done now
+			map<uint64_t, vector<Transaction*> >::iterator it = prefetchWaiters.find(blockAddress(address));
+			if (it != prefetchWaiters.end())
+			{
+				for (size_t i=0; i<it->second.size(); i++)
+				{
+#ifdef RETURN_TRANSACTIONS
+					// their load latency runs to the fill
+					transReceiver->read_complete(id, it->second[i]->address, done_cycle);
+#endif
+					delete it->second[i];
+				}
+				prefetchWaiters.erase(it);
+			}
+			return;
+		}
+#ifdef RETURN_TRANSACTIONS
+		transReceiver->read_complete(id, address, done_cycle);
+#endif
+	}
 
 
 	void Simulator::report()
@@ -5,25 +5,43 @@
 #include "ClockDomain.h"
 #include "MemorySystem.h"
 #include "CacheSimulator.h"
+#include "PageMapper.h"
+
+#include <list>
+#include <deque>
+#include <map>
 
 using BlSim::Caches;
 
 namespace DRAMSim
 {
+	// a trace request in the cache lookup pipeline, it leaves at readyCycle:
+	// a hit completes, a miss is sent to the memory system
+	struct CacheRequest
+	{
+		Transaction *trans;
+		uint64_t readyCycle;
+		bool hit;
+	};
+
 	class Simulator
 	{
 	public:
 		Simulator(SimulatorIO *simIO) : simIO(simIO),
 		                                memorySystem(NULL),
 		                                myCache(NULL),
+		                                pageMapper(NULL),
 		                                trans(NULL),
-		                                pendingTrace(true) {};
+		                                writeback(NULL),
+		                                pendingTrace(true),
+		                                memoryFull(false) {};
 		~Simulator();
 
 		void setup();
 		void start();
 		void update();
 		void report();
+		void readComplete(unsigned id, uint64_t address, uint64_t done_cycle);
 
 		static ClockDomain* clockDomainCPU;
 		static ClockDomain* clockDomainDRAM;
@@ -32,13 +50,36 @@ namespace DRAMSim
 	private:
 		void setCPUClock(uint64_t cpuClkFreqHz);
 		void setClockRatio(double ratio);
+		void issuePrefetch();
+		bool issueWriteback();
+		// an LLC writeback, or a batch of them, the memory system has not taken yet
+		bool writebackPending() {return writeback != NULL || myCache->writeback_pending();}
+		void configureCache(Caches *cache);
+		void setCacheLevels(Caches *cache);
+		void setCacheTiming(Caches *cache);
+		void setCacheInclusion(Caches *cache);
+		void setCachePartition(Caches *cache);
+		PageMapper *createPageMapper();
+		uint64_t rowColumnMask();
+		uint64_t blockAddress(uint64_t address) {return address & ~(uint64_t)(myCache->get_llc_block_size() - 1);}
+		bool updateCacheRequests();
+		void fastForward(uint64_t records);
+		void selectAddressMapping();
+		Transaction *nextTrans();
 
 		SimulatorIO *simIO;
 		MemorySystem *memorySystem;
 		Caches *myCache;
+		PageMapper *pageMapper;
+		std::deque<Transaction*> pendingWalks;  // page table reads of a TLB miss, they go before the access that missed
+		std::vector<uint64_t> walkAddresses;
 		Transaction *trans;
+		Transaction *writeback;  // LLC writeback the memory system did not take yet
 
 		bool pendingTrace;
+		bool memoryFull;  // the memory system refused a miss last cycle, no new accesses until it takes it
+		std::list<CacheRequest> cacheRequests;
+		std::map<uint64_t, std::vector<Transaction*> > prefetchWaiters;  // demand reads waiting for the prefetch of their block, by block
 
 #ifdef RETURN_TRANSACTIONS
 		TransactionReceiver *transReceiver;
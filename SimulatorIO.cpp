@@ -135,6 +135,27 @@ namespace DRAMSim
 			abort();
 		}
 
+		// the channel device inis sit next to the main one unless they have a path of their own
+		if (CHANNEL_DEVICE_INIS.length() > 0)
+		{
+			string deviceDirectory = deviceIniFilename.substr(0, deviceIniFilename.find_last_of("/") + 1);
+			string resolved, name;
+			istringstream names(CHANNEL_DEVICE_INIS);
+			for (unsigned i=0; getline(names, name, ':'); i++)
+			{
+				if (name.length() > 0 && name[0] != '/')
+				{
+					name = deviceDirectory + name;
+				}
+				resolved += (i > 0 ? ":" : "") + name;
+			}
+			if (CHANNEL_DEVICE_INIS[CHANNEL_DEVICE_INIS.length() - 1] == ':')
+			{
+				resolved += ":";
+			}
+			CHANNEL_DEVICE_INIS = resolved;
+		}
+
 		// don't need this anymore
 		delete paramOverrides;
 
@@ -312,6 +333,14 @@ namespace DRAMSim
 	}
 
 
+	// back to the first record, e.g. after the trace was sampled to pick the address mapping
+	void SimulatorIO::rewindTrace()
+	{
+		traceFile.clear();
+		traceFile.seekg(0);
+	}
+
+
 	Transaction* SimulatorIO::nextTrans()
 	{
 		string line="";
@@ -345,6 +374,7 @@ namespace DRAMSim
 		DataPacket *dataPacket = NULL;
 		string addressStr="", cmdStr="", dataStr="", ccStr="";
 		size_t subrankLen = LEN_DEF;
+		unsigned coreID = 0;
 
 		switch (traceType)
 		{
@@ -361,6 +391,18 @@ namespace DRAMSim
 
 			spaceIndex = line.find_first_not_of(" ", previousIndex);
 			ccStr = line.substr(spaceIndex, line.find_first_of(" ", spaceIndex) - spaceIndex);
+			previousIndex = line.find_first_of(" ", spaceIndex);
+
+			// an optional fourth field is the core that made the access (0 when missing)
+			if (previousIndex != string::npos)
+			{
+				spaceIndex = line.find_first_not_of(" ", previousIndex);
+				if (spaceIndex != string::npos)
+				{
+					istringstream c(line.substr(spaceIndex, line.find_first_of(" ", spaceIndex) - spaceIndex));
+					c>>coreID;
+				}
+			}
 
 			if (cmdStr.compare("P_MEM_WR")==0 ||
 					cmdStr.compare("BOFF")==0)
@@ -444,8 +486,14 @@ namespace DRAMSim
 			a>>hex>>addr;
 
 			//parse data
-			//if we are running in a no storage mode, don't allocate space, just return NULL
-#ifdef DATA_STORAGE
+			//if we are running in a no storage mode, don't allocate space, just return NULL;
+			//the compressed LLC needs the write payloads either way
+#ifndef DATA_STORAGE
+			if (LLC_COMPRESSION.empty() || LLC_COMPRESSION == "none")
+			{
+				dataStr = "";
+			}
+#endif
 			if (dataStr.size() > 0 && transType == Transaction::DATA_WRITE)
 			{
 				// two hex characters = 1 byte
@@ -494,7 +542,6 @@ namespace DRAMSim
 
 				//PRINT("ds="<<dataStr <<", bytes="<<stringBytes<<"\ndp="<<*dataPacket);
 			}
-#endif
 
 			//if this is set to false, clockCycle will remain at 0, and every line read from the trace
 			//  will be allowed to be issued
@@ -549,7 +596,9 @@ namespace DRAMSim
 		}
 		} // end of SWITCH
 
-		return new Transaction(transType, addr, dataPacket, subrankLen, clockCycle);
+		Transaction *newTrans = new Transaction(transType, addr, dataPacket, subrankLen, clockCycle);
+		newTrans->coreID = coreID;
+		return newTrans;
 	}
 
 
@@ -38,6 +38,7 @@ namespace DRAMSim
 		void initOutputFiles();
 
 		Transaction* nextTrans();
+		void rewindTrace();
 
 		IniReader::OverrideMap* parseParamOverrides(const string &kv_str);
 		string FilenameWithNumberSuffix(const string &filename, const string &extension, unsigned maxNumber = 100);
@@ -0,0 +1,164 @@
+#include "StackSimulator.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <assert.h>
+using namespace std;
+
+BlSim::StackSimulator::StackSimulator(uint32_t block_size, uint32_t min_sets, uint32_t max_sets, uint32_t max_ways)
+{
+	uint32_t sets;
+
+	m_block_bits = 0;
+	while((1U << m_block_bits) < block_size)
+	{
+		m_block_bits++;
+	}
+
+	if(min_sets == 0 || (min_sets & (min_sets - 1)) || (max_sets & (max_sets - 1)) || max_sets < min_sets)
+	{
+		cerr<<"ERROR: stack simulator set counts must be powers of two with min <= max (got "<<min_sets<<", "<<max_sets<<")"<<endl;
+		exit(-8);
+	}
+
+	m_max_ways = max_ways;
+	m_reads = 0;
+	m_writes = 0;
+
+	for(sets = min_sets; sets && sets <= max_sets; sets <<= 1)
+	{
+		m_configs.push_back(SetConfig());
+		SetConfig &config = m_configs.back();
+		config.m_set_count = sets;
+		config.m_entries.resize((size_t)sets * max_ways);
+		config.m_depths.assign(sets, 0);
+		config.m_read_hits.assign(max_ways, 0);
+		config.m_write_hits.assign(max_ways, 0);
+		config.m_dirty_evictions.assign(max_ways, 0);
+	}
+}
+
+void BlSim::StackSimulator::access_config(SetConfig &config, uint64_t block_num, bool write)
+{
+	uint32_t set = (uint32_t)(block_num & (config.m_set_count - 1));
+	StackEntry *p_stack = &config.m_entries[(size_t)set * m_max_ways];
+	uint32_t depth = config.m_depths[set];
+	uint32_t d;
+	StackEntry top;
+
+	for(d = 0; d < depth; d++)
+	{
+		if(p_stack[d].m_block_num == block_num)
+		{
+			break;
+		}
+	}
+
+	if(d < depth)
+	{
+		//hit in every cache with more than d ways, a miss refetches the block clean
+		if(write)
+		{
+			config.m_write_hits[d]++;
+		}
+		else
+		{
+			config.m_read_hits[d]++;
+		}
+		top = p_stack[d];
+	}
+	else
+	{
+		//miss in all of them; the bottom entry falls out of the largest cache
+		top.m_block_num = block_num;
+		top.m_max_depth = NEVER_WRITTEN;
+		if(depth == m_max_ways)
+		{
+			d = m_max_ways - 1;
+			if(p_stack[d].m_max_depth <= d)
+			{
+				config.m_dirty_evictions[d]++;
+			}
+		}
+		else
+		{
+			d = depth;
+			config.m_depths[set]++;
+		}
+	}
+
+	//push the entries above d down one position; the one leaving position j
+	//is evicted from the (j+1)-way cache, dirty if it never went deeper than j
+	for(; d > 0; d--)
+	{
+		p_stack[d] = p_stack[d - 1];
+		if(p_stack[d].m_max_depth < d)
+		{
+			config.m_dirty_evictions[d - 1]++;
+			p_stack[d].m_max_depth = d;
+		}
+	}
+
+	top.m_max_depth = write ? 0 : top.m_max_depth;
+	p_stack[0] = top;
+}
+
+void BlSim::StackSimulator::access(uint64_t maddr, bool write)
+{
+	uint64_t block_num = maddr >> m_block_bits;
+	size_t i;
+
+	if(write)
+	{
+		m_writes++;
+	}
+	else
+	{
+		m_reads++;
+	}
+
+	for(i = 0; i < m_configs.size(); i++)
+	{
+		access_config(m_configs[i], block_num, write);
+	}
+}
+
+void BlSim::StackSimulator::print_statistic()
+{
+	size_t i;
+	uint32_t w;
+
+	cout<<"stack simulation (LRU): reads: "<<m_reads<<"\t writes: "<<m_writes<<endl;
+	cout<<"    sets\t ways\t size\t read_miss\t write_miss\t miss_ratio\t dirty_evictions"<<endl;
+	for(i = 0; i < m_configs.size(); i++)
+	{
+		SetConfig &config = m_configs[i];
+		uint64_t read_hits = 0;
+		uint64_t write_hits = 0;
+
+		for(w = 1; w <= m_max_ways; w++)
+		{
+			read_hits += config.m_read_hits[w - 1];
+			write_hits += config.m_write_hits[w - 1];
+
+			uint64_t read_misses = m_reads - read_hits;
+			uint64_t write_misses = m_writes - write_hits;
+			uint64_t total = m_reads + m_writes;
+			uint64_t bytes = ((uint64_t)config.m_set_count * w) << m_block_bits;
+
+			cout<<"    "<<config.m_set_count<<"\t "<<w<<"\t ";
+			if(bytes >= (1UL << 20))
+			{
+				cout<<(bytes >> 20)<<"MB";
+			}
+			else
+			{
+				cout<<(bytes >> 10)<<"KB";
+			}
+			cout<<"\t "<<read_misses<<"\t "<<write_misses
+				<<"\t "<<(total ? (double)(read_misses + write_misses) / total : 0.0)
+				<<"\t "<<config.m_dirty_evictions[w - 1]<<endl;
+		}
+	}
+}
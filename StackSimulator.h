@@ -0,0 +1,65 @@
+#ifndef STACK_SIMULATOR_H_
+#define STACK_SIMULATOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace BlSim
+{
+    /*
+     * All-associativity LRU cache simulator (Mattson's stack algorithm).
+     *
+     * For a fixed number of sets, a block that hits at depth d of its set's
+     * LRU stack hits in every cache of that set count with more than d ways,
+     * so one pass over the trace gives the exact hits of all way counts
+     * 1..max_ways. Each power of two set count between min_sets and max_sets
+     * keeps its own stacks; the set index of the larger counts only adds tag
+     * bits, so all of them are updated from the same block number.
+     *
+     * Dirty evictions are exact too: every stack entry remembers the deepest
+     * position it reached since its last write. The block is dirty in a W-way
+     * cache exactly when that depth is below W, and it is evicted from the
+     * W-way cache when it is pushed from position W-1 to W.
+     */
+    class StackSimulator
+    {
+        protected:
+            enum Stack_Config{NEVER_WRITTEN=0xffffffff};
+
+            struct StackEntry
+            {
+                uint64_t m_block_num;
+                uint32_t m_max_depth;   //deepest position since the last write, NEVER_WRITTEN if clean everywhere
+            };
+
+            //all stacks of one set count
+            struct SetConfig
+            {
+                uint32_t m_set_count;
+                std::vector<StackEntry> m_entries;   //m_set_count stacks of m_max_ways entries, MRU first
+                std::vector<uint32_t> m_depths;      //valid entries per stack
+
+                std::vector<uint64_t> m_read_hits;   //reads that hit at each depth
+                std::vector<uint64_t> m_write_hits;
+                std::vector<uint64_t> m_dirty_evictions;  //per way count, index W-1
+            };
+
+            uint32_t m_block_bits;
+            uint32_t m_max_ways;
+            uint64_t m_reads;
+            uint64_t m_writes;
+            std::vector<SetConfig> m_configs;
+
+            void access_config(SetConfig &config, uint64_t block_num, bool write);
+
+        public:
+            StackSimulator(uint32_t block_size, uint32_t min_sets, uint32_t max_sets, uint32_t max_ways);
+
+            void access(uint64_t maddr, bool write);
+
+            //read/write misses and dirty evictions of every (sets, ways) configuration
+            void print_statistic();
+    };
+}
+
+#endif
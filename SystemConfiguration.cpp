@@ -65,6 +65,8 @@ namespace DRAMSim
 	//Memory Controller parameters
 	unsigned TRANS_QUEUE_DEPTH;
 	unsigned CMD_QUEUE_DEPTH;
+	unsigned PENDING_QUEUE_DEPTH;
+	unsigned MERGE_BUFFER_ENTRIES;
 
 	//cycles within an epoch
 	uint64_t EPOCH_LENGTH;
@@ -73,10 +75,86 @@ namespace DRAMSim
 	//row accesses allowed before closing (open page)
 	unsigned TOTAL_ROW_ACCESSES;
 
+	//last level cache prefetcher
+	string PREFETCHER;
+	unsigned PREFETCH_DEGREE;
+	unsigned PREFETCH_DISTANCE;
+
+	//cache levels
+	string CACHE_SIZES_KB;
+	string CACHE_WAYS;
+
+	//per level cache lookup timing
+	string CACHE_TAG_LATENCY;
+	string CACHE_DATA_LATENCY;
+	string CACHE_PORTS;
+	string CACHE_INCLUSION;
+
+	//multi-core coherence
+	unsigned CACHE_CORES;
+	unsigned COHERENCE_LATENCY;
+
+	//sectors and writebacks
+	unsigned SECTOR_BYTES;
+	bool LLC_WRITEBACKS;
+	bool DRAM_AWARE_WRITEBACK;
+	unsigned WRITEBACK_CLEAN_WAYS;
+
+	//LLC way partitioning
+	string LLC_WAY_MASKS;
+	uint64_t UCP_EPOCH;
+
+	//LLC compression
+	string LLC_COMPRESSION;
+
+	//page mapping
+	unsigned PAGE_SIZE;
+	string PAGE_POLICY;
+	unsigned TLB_ENTRIES;
+
+	//functional cache warmup
+	uint64_t FAST_FORWARD;
+	uint64_t AUTO_MAPPING_RECORDS;
+	unsigned CACHE_THREADS;
+
+	//reuse distance profiler
+	bool REUSE_PROFILER;
+	float REUSE_SAMPLE_RATE;
+	uint64_t REUSE_EPOCH_LENGTH;
+
+	//stack simulator
+	unsigned STACK_SIM_WAYS;
+	unsigned STACK_SIM_MIN_SETS;
+	unsigned STACK_SIM_MAX_SETS;
+
+	//miss trace
+	string MISS_TRACE_FILE;
+
 	// strings and their associated enums
 	string ROW_BUFFER_POLICY;
 	string SCHEDULING_POLICY;
 	string ADDRESS_MAPPING_SCHEME;
+	string ADDRESS_HASH;
+	string CHANNEL_XOR_MASKS;
+	string RANK_XOR_MASKS;
+	string BANK_XOR_MASKS;
+	string CHANNEL_DEVICE_INIS;
+
+	//DRAM + NVM tiers
+	unsigned NVM_CHANNELS;
+	string TIER_PLACEMENT;
+	uint64_t MIGRATION_EPOCH;
+	unsigned MIGRATION_PAGES;
+	unsigned MIGRATION_THRESHOLD;
+	float NVM_WRITE_ENERGY;
+	uint64_t NVM_ENDURANCE;
+
+	//CXL.mem memory expander
+	unsigned CXL_CHANNELS;
+	string CXL_MAPPING;
+	float CXL_LINK_LATENCY;
+	float CXL_LINK_BANDWIDTH;
+	unsigned CXL_LINK_CREDITS;
 	string QUEUING_STRUCTURE;
 
 	RowBufferPolicy rowBufferPolicy;
@@ -162,12 +162,65 @@ namespace DRAMSim
 	//Memory Controller related parameters
 	extern unsigned TRANS_QUEUE_DEPTH;
 	extern unsigned CMD_QUEUE_DEPTH;
+	extern unsigned PENDING_QUEUE_DEPTH;
+	extern unsigned MERGE_BUFFER_ENTRIES;
 
 	extern uint64_t EPOCH_LENGTH;
 	extern unsigned HISTOGRAM_BIN_SIZE;
 
 	extern unsigned TOTAL_ROW_ACCESSES;
 
+	//last level cache prefetcher, see Prefetcher.h
+	extern std::string PREFETCHER;
+	extern unsigned PREFETCH_DEGREE;
+	extern unsigned PREFETCH_DISTANCE;
+
+	//cache levels, one value per level separated by ':'; empty for the built-in single LLC
+	extern std::string CACHE_SIZES_KB;
+	extern std::string CACHE_WAYS;
+	//per level cache lookup timing in cpu cycles, one value per level separated by ':'
+	extern std::string CACHE_TAG_LATENCY;
+	extern std::string CACHE_DATA_LATENCY;
+	extern std::string CACHE_PORTS;
+	//inclusive, nine or exclusive, one for every level or one per level separated by ':'
+	extern std::string CACHE_INCLUSION;
+	//cores with private levels above the shared LLC, kept coherent through a directory in the LLC
+	extern unsigned CACHE_CORES;
+	extern unsigned COHERENCE_LATENCY;
+	//sectored cache blocks and LLC writeback traffic
+	extern unsigned SECTOR_BYTES;
+	extern bool LLC_WRITEBACKS;
+	//write the dirty lru-side LLC blocks of a dirty victim's DRAM row along with it, and clean eagerly while memory is idle
+	extern bool DRAM_AWARE_WRITEBACK;
+	extern unsigned WRITEBACK_CLEAN_WAYS;
+	//per core LLC way masks in hex separated by ':', or UCP repartitioning every UCP_EPOCH LLC accesses (0 for off)
+	extern std::string LLC_WAY_MASKS;
+	extern uint64_t UCP_EPOCH;
+	//none, bdi or fpc; the LLC keeps blocks compressed, sized by the write payloads of the trace
+	extern std::string LLC_COMPRESSION;
+	//virtual to physical pages of PAGE_SIZE bytes (0 for off), sequential, random, coloring or bank_partition allocation, per core TLB
+	extern unsigned PAGE_SIZE;
+	extern std::string PAGE_POLICY;
+	extern unsigned TLB_ENTRIES;
+
+	//trace records run through the caches only (no timing, no memory system) before simulation starts
+	extern uint64_t FAST_FORWARD;
+	extern uint64_t AUTO_MAPPING_RECORDS;
+	extern unsigned CACHE_THREADS;
+
+	//one-pass reuse distance profile and miss ratio curve
+	extern bool REUSE_PROFILER;
+	extern float REUSE_SAMPLE_RATE;
+	extern uint64_t REUSE_EPOCH_LENGTH;
+
+	//all-associativity stack simulation over a range of set counts
+	extern unsigned STACK_SIM_WAYS;
+	extern unsigned STACK_SIM_MIN_SETS;
+	extern unsigned STACK_SIM_MAX_SETS;
+
+	//binary LLC miss trace (see MissTrace.h), empty for none
+	extern std::string MISS_TRACE_FILE;
+
 
 	typedef enum
 	{
@@ -186,7 +239,9 @@ namespace DRAMSim
 		Scheme4,
 		Scheme5,
 		Scheme6,
-		Scheme7
+		Scheme7,
+		SchemeCustom,  // ADDRESS_MAPPING_SCHEME is a field layout (see AddressMapper)
+		SchemeAuto     // picked from the trace before the run (see MappingSelector)
 	} AddressMappingScheme;
 
 	// used in MemoryController and CommandQueue
@@ -213,7 +268,29 @@ namespace DRAMSim
 	extern std::string ROW_BUFFER_POLICY;
 	extern std::string SCHEDULING_POLICY;
 	extern std::string ADDRESS_MAPPING_SCHEME;
+	extern std::string ADDRESS_HASH;
+	extern std::string CHANNEL_XOR_MASKS;
+	extern std::string RANK_XOR_MASKS;
+	extern std::string BANK_XOR_MASKS;
 	extern std::string QUEUING_STRUCTURE;
+	//device ini per channel, or per group of channels, separated by ':'; empty entries use the main device ini
+	extern std::string CHANNEL_DEVICE_INIS;
+
+	//DRAM + NVM tiers (see TierManager)
+	extern unsigned NVM_CHANNELS;
+	extern std::string TIER_PLACEMENT;
+	extern uint64_t MIGRATION_EPOCH;
+	extern unsigned MIGRATION_PAGES;
+	extern unsigned MIGRATION_THRESHOLD;
+	extern float NVM_WRITE_ENERGY;
+	extern uint64_t NVM_ENDURANCE;
+
+	//CXL.mem memory expander (see CxlLink)
+	extern unsigned CXL_CHANNELS;
+	extern std::string CXL_MAPPING;
+	extern float CXL_LINK_LATENCY;
+	extern float CXL_LINK_BANDWIDTH;
+	extern unsigned CXL_LINK_CREDITS;
 
 	extern RowBufferPolicy rowBufferPolicy;
 	extern SchedulingPolicy schedulingPolicy;
@@ -0,0 +1,304 @@
+#include "TierManager.h"
+#include "MemorySystem.h"
+#include "PrintMacros.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	const uint64_t TierManager::FRAME_BIT;
+	const uint64_t TierManager::PAGE_BYTES;
+	const uint64_t TierManager::NO_PAGE;
+
+	// the hottest first
+	static bool hotter(const pair<uint64_t, unsigned> &a, const pair<uint64_t, unsigned> &b)
+	{
+		return a.second > b.second;
+	}
+
+
+	TierManager::TierManager(MemorySystem *memorySystem, uint64_t dramBytes, uint64_t nvmBytes) :
+		memorySystem(memorySystem)
+	{
+		if (TIER_PLACEMENT.empty() || TIER_PLACEMENT == "dram")
+		{
+			nvmFirst = false;
+		}
+		else if (TIER_PLACEMENT == "nvm")
+		{
+			nvmFirst = true;
+		}
+		else
+		{
+			ERROR("TIER_PLACEMENT must be dram or nvm, got "<<TIER_PLACEMENT);
+			exit(-1);
+		}
+		if (PAGE_BYTES % TRANS_DATA_BYTES != 0)
+		{
+			ERROR("The "<<TRANS_DATA_BYTES<<" byte transactions do not fit a "<<PAGE_BYTES<<" byte page");
+			exit(-1);
+		}
+
+		dramFrames = dramBytes / PAGE_BYTES;
+		nvmFrames = nvmBytes / PAGE_BYTES;
+		frameOwner.assign(dramFrames + nvmFrames, NO_PAGE);
+		nextFree[DRAM] = 0;
+		nextFree[NVM] = dramFrames;
+		victimHand = 0;
+		cycles = 0;
+		copiesInFlight = 0;
+
+		for (unsigned tier=DRAM; tier<TIERS; tier++)
+		{
+			pagesIn[tier] = 0;
+			demandBytes[tier] = 0;
+			copyReadBytes[tier] = 0;
+			copyWriteBytes[tier] = 0;
+		}
+		promotions = 0;
+		demotions = 0;
+		epochs = 0;
+		epochsSkipped = 0;
+		nvmFrameWrites.assign(nvmFrames, 0);
+		nvmWriteBytes = 0;
+
+		PRINT("Tiers: DRAM "<<(dramBytes >> 20)<<"MB | NVM "<<(nvmBytes >> 20)<<"MB | "<<(nvmFirst ? "NVM" : "DRAM")<<" first");
+	}
+
+
+	uint64_t TierManager::frameAddress(uint64_t address) const
+	{
+		if (address & FRAME_BIT)
+		{
+			return address & ~FRAME_BIT;
+		}
+		map<uint64_t, uint64_t>::const_iterator it = pageFrames.find(address / PAGE_BYTES);
+		if (it == pageFrames.end())
+		{
+			return address;
+		}
+		return it->second * PAGE_BYTES + address % PAGE_BYTES;
+	}
+
+
+	void TierManager::place(uint64_t address)
+	{
+		uint64_t page = address / PAGE_BYTES;
+		if (pageFrames.find(page) != pageFrames.end())
+		{
+			return;
+		}
+
+		Tier first = nvmFirst ? NVM : DRAM;
+		uint64_t frame = allocateFrame(first);
+		if (frame == NO_PAGE)
+		{
+			frame = allocateFrame(first == DRAM ? NVM : DRAM);
+		}
+		if (frame == NO_PAGE)
+		{
+			ERROR("Out of memory after "<<pageFrames.size()<<" pages of "<<PAGE_BYTES<<" bytes");
+			exit(-1);
+		}
+		pageFrames[page] = frame;
+		frameOwner[frame] = page;
+		pagesIn[tierOf(frame)]++;
+	}
+
+
+	void TierManager::countAccess(uint64_t address)
+	{
+		epochAccesses[address / PAGE_BYTES]++;
+	}
+
+
+	void TierManager::transferScheduled(uint64_t frameAddress, bool isWrite)
+	{
+		uint64_t frame = frameAddress / PAGE_BYTES;
+		if (frame >= frameOwner.size())
+		{
+			return;  // a page nothing placed, beyond the tiers
+		}
+		demandBytes[tierOf(frame)] += TRANS_DATA_BYTES;
+		if (isWrite && tierOf(frame) == NVM)
+		{
+			countNvmWrite(frame);
+		}
+	}
+
+
+	void TierManager::copyDone(uint64_t address, bool isWrite)
+	{
+		uint64_t frame = frameAddress(address) / PAGE_BYTES;
+		if (isWrite && tierOf(frame) == NVM)
+		{
+			countNvmWrite(frame);
+		}
+		copiesInFlight--;
+	}
+
+
+	void TierManager::update()
+	{
+		cycles++;
+		if (MIGRATION_EPOCH > 0 && cycles % MIGRATION_EPOCH == 0)
+		{
+			migrate();
+		}
+	}
+
+
+	uint64_t TierManager::allocateFrame(Tier tier)
+	{
+		if (!freed[tier].empty())
+		{
+			uint64_t frame = freed[tier].back();
+			freed[tier].pop_back();
+			return frame;
+		}
+		uint64_t end = tier == DRAM ? dramFrames : dramFrames + nvmFrames;
+		return nextFree[tier] < end ? nextFree[tier]++ : NO_PAGE;
+	}
+
+
+	uint64_t TierManager::findVictim()
+	{
+		for (uint64_t i=0; i<dramFrames; i++)
+		{
+			uint64_t frame = victimHand;
+			victimHand = (victimHand + 1) % dramFrames;
+			uint64_t page = frameOwner[frame];
+			if (page == NO_PAGE)
+			{
+				continue;
+			}
+			map<uint64_t, unsigned>::iterator it = epochAccesses.find(page);
+			if (it == epochAccesses.end() || it->second < MIGRATION_THRESHOLD)
+			{
+				return frame;
+			}
+		}
+		return NO_PAGE;
+	}
+
+
+	void TierManager::movePage(uint64_t page, uint64_t frame)
+	{
+		pageFrames[page] = frame;
+		frameOwner[frame] = page;
+	}
+
+
+	void TierManager::copyFrame(uint64_t from, uint64_t to)
+	{
+		for (uint64_t offset=0; offset<PAGE_BYTES; offset+=TRANS_DATA_BYTES)
+		{
+			memorySystem->queueMigration(FRAME_BIT | (from * PAGE_BYTES + offset), false);
+			memorySystem->queueMigration(FRAME_BIT | (to * PAGE_BYTES + offset), true);
+			copiesInFlight += 2;
+		}
+		copyReadBytes[tierOf(from)] += PAGE_BYTES;
+		copyWriteBytes[tierOf(to)] += PAGE_BYTES;
+	}
+
+
+	void TierManager::countNvmWrite(uint64_t frame)
+	{
+		nvmFrameWrites[frame - dramFrames]++;
+		nvmWriteBytes += TRANS_DATA_BYTES;
+	}
+
+
+	void TierManager::migrate()
+	{
+		epochs++;
+		if (copiesInFlight > 0)
+		{
+			epochsSkipped++;
+			epochAccesses.clear();
+			return;
+		}
+
+		vector<pair<uint64_t, unsigned> > hot;
+		for (map<uint64_t, unsigned>::iterator it=epochAccesses.begin(); it!=epochAccesses.end(); it++)
+		{
+			map<uint64_t, uint64_t>::iterator page = pageFrames.find(it->first);
+			if (it->second >= MIGRATION_THRESHOLD && page != pageFrames.end() && tierOf(page->second) == NVM)
+			{
+				hot.push_back(*it);
+			}
+		}
+		stable_sort(hot.begin(), hot.end(), hotter);
+		if (hot.size() > MIGRATION_PAGES)
+		{
+			hot.resize(MIGRATION_PAGES);
+		}
+
+		for (size_t i=0; i<hot.size(); i++)
+		{
+			uint64_t page = hot[i].first;
+			uint64_t nvmFrame = pageFrames[page];
+			uint64_t dramFrame = allocateFrame(DRAM);
+			if (dramFrame != NO_PAGE)
+			{
+				frameOwner[nvmFrame] = NO_PAGE;
+				freed[NVM].push_back(nvmFrame);
+				pagesIn[NVM]--;
+				pagesIn[DRAM]++;
+			}
+			else
+			{
+				dramFrame = findVictim();
+				if (dramFrame == NO_PAGE)
+				{
+					break;  // every DRAM page is hot
+				}
+				uint64_t victim = frameOwner[dramFrame];
+				movePage(victim, nvmFrame);
+				copyFrame(dramFrame, nvmFrame);
+				demotions++;
+			}
+			movePage(page, dramFrame);
+			copyFrame(nvmFrame, dramFrame);
+			promotions++;
+		}
+		epochAccesses.clear();
+	}
+
+
+	void TierManager::printStats()
+	{
+		uint64_t framesWritten = 0;
+		uint64_t mostWrites = 0;
+		for (size_t i=0; i<nvmFrameWrites.size(); i++)
+		{
+			if (nvmFrameWrites[i] > 0)
+			{
+				framesWritten++;
+				mostWrites = max(mostWrites, nvmFrameWrites[i]);
+			}
+		}
+		uint64_t demand = demandBytes[DRAM] + demandBytes[NVM];
+		uint64_t copies = copyReadBytes[DRAM] + copyWriteBytes[DRAM] + copyReadBytes[NVM] + copyWriteBytes[NVM];
+		double seconds = cycles * tCK * 1e-9;
+		// every line of the most written frame takes an equal share of its writes
+		double lifetime = mostWrites ? (double)NVM_ENDURANCE * (PAGE_BYTES / TRANS_DATA_BYTES) / mostWrites * seconds : 0;
+
+		cout << "tiers (" << (nvmFirst ? "NVM" : "DRAM") << " first): pages: " << pageFrames.size()
+			<< "\t in DRAM: " << pagesIn[DRAM] << " of " << dramFrames
+			<< "\t in NVM: " << pagesIn[NVM] << " of " << nvmFrames << endl;
+		cout << "    demand traffic: DRAM " << (demandBytes[DRAM] >> 10) << "KB\t NVM " << (demandBytes[NVM] >> 10) << "KB"
+			<< " (" << (demand ? (double)demandBytes[NVM] / demand : 0) << " of it)" << endl;
+		cout << "    migration (every " << MIGRATION_EPOCH << " cycles): epochs: " << epochs << "\t skipped: " << epochsSkipped
+			<< "\t promoted: " << promotions << "\t demoted: " << demotions << endl;
+		cout << "    copy traffic: DRAM read " << (copyReadBytes[DRAM] >> 10) << "KB written " << (copyWriteBytes[DRAM] >> 10) << "KB"
+			<< "\t NVM read " << (copyReadBytes[NVM] >> 10) << "KB written " << (copyWriteBytes[NVM] >> 10) << "KB"
+			<< " (" << (demand + copies ? (double)copies / (demand + copies) : 0) << " of all traffic)" << endl;
+		cout << "    NVM writes: " << (nvmWriteBytes >> 10) << "KB\t write energy: " << nvmWriteBytes * 8 * NVM_WRITE_ENERGY * 1e-6 << "uJ"
+			<< "\t frames written: " << framesWritten << "\t most written frame: " << mostWrites
+			<< "\t lifetime at this rate: " << lifetime / (365.0 * 24 * 3600) << " years" << endl;
+	}
+}
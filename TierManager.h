@@ -0,0 +1,106 @@
+#ifndef TIERMANAGER_H
+#define TIERMANAGER_H
+
+#include "SystemConfiguration.h"
+
+#include <map>
+#include <vector>
+
+namespace DRAMSim
+{
+	using namespace std;
+
+	class MemorySystem;
+
+	/*
+	 * DRAM + NVM tiered memory (NVM_CHANNELS).
+	 *
+	 * The last NVM_CHANNELS channels are the NVM tier, their device (see
+	 * CHANNEL_DEVICE_INIS) gives the slow sensing (tRCD) and programming
+	 * (tWR) of the cells. The memory system lays the DRAM channels out
+	 * first and the NVM channels after them, so a frame is in the tier its
+	 * address falls in.
+	 *
+	 * Physical pages are placed in frames on their first touch, DRAM first
+	 * or NVM first (TIER_PLACEMENT). The memory system translates an
+	 * address once, when it takes the transaction, and the channel decodes
+	 * that frame even if the page moves while it waits; the completions
+	 * keep the address the transaction was made with. Pages nothing
+	 * touched yet decode as themselves.
+	 *
+	 * Every MIGRATION_EPOCH cycles the NVM pages with at least
+	 * MIGRATION_THRESHOLD accesses in the epoch are promoted, the hottest
+	 * first and at most MIGRATION_PAGES of them. A promoted page takes a
+	 * free DRAM frame, or swaps with a DRAM page that was not hot in the
+	 * epoch (a clock hand goes round the DRAM frames for one). The pages
+	 * move at once, the copies are modeled as line reads and writes that
+	 * go to the channels when they have nothing else to take. A copy names
+	 * its frame, FRAME_BIT set, and is not reported to the callbacks. An
+	 * epoch whose copies of the last epoch are still in flight is skipped.
+	 *
+	 * NVM writes are counted per frame for the wear; the lifetime assumes
+	 * the writes to a frame are spread over its lines.
+	 */
+	class TierManager
+	{
+	public:
+		static const uint64_t FRAME_BIT = 1ULL << 63;
+		static const uint64_t PAGE_BYTES = 4096;
+
+		TierManager(MemorySystem *memorySystem, uint64_t dramBytes, uint64_t nvmBytes);
+
+		// the address in the tiers, for decoding
+		uint64_t frameAddress(uint64_t address) const;
+		// gives the page of the address a frame if it has none yet
+		void place(uint64_t address);
+		// an access the memory system accepted, counts towards the page's hotness
+		void countAccess(uint64_t address);
+		// a demand transaction its channel scheduled, by the frame address it was decoded with
+		void transferScheduled(uint64_t frameAddress, bool isWrite);
+		// a migration copy that is done
+		void copyDone(uint64_t address, bool isWrite);
+		// one memory system cycle
+		void update();
+		void printStats();
+
+	private:
+		static const uint64_t NO_PAGE = ~0ULL;
+
+		enum Tier {DRAM, NVM, TIERS};
+
+		MemorySystem *memorySystem;
+		bool nvmFirst;
+		uint64_t dramFrames;
+		uint64_t nvmFrames;
+		map<uint64_t, uint64_t> pageFrames;  // page -> frame
+		vector<uint64_t> frameOwner;         // frame -> page, NO_PAGE if free
+		uint64_t nextFree[TIERS];            // frames past it were never used
+		vector<uint64_t> freed[TIERS];       // frames given back by moves
+		uint64_t victimHand;                 // next DRAM frame to look at for a victim
+
+		map<uint64_t, unsigned> epochAccesses;  // page -> accesses in this epoch
+		uint64_t cycles;
+		uint64_t copiesInFlight;
+
+		uint64_t pagesIn[TIERS];
+		uint64_t demandBytes[TIERS];
+		uint64_t copyReadBytes[TIERS];
+		uint64_t copyWriteBytes[TIERS];
+		uint64_t promotions;
+		uint64_t demotions;
+		uint64_t epochs;
+		uint64_t epochsSkipped;
+		vector<uint64_t> nvmFrameWrites;
+		uint64_t nvmWriteBytes;
+
+		Tier tierOf(uint64_t frame) const {return frame < dramFrames ? DRAM : NVM;}
+		uint64_t allocateFrame(Tier tier);  // NO_PAGE if the tier is full
+		uint64_t findVictim();              // a DRAM frame whose page was not hot, NO_PAGE if none
+		void movePage(uint64_t page, uint64_t frame);
+		void copyFrame(uint64_t from, uint64_t to);
+		void countNvmWrite(uint64_t frame);
+		void migrate();
+	};
+}
+
+#endif
@@ -44,9 +44,11 @@ namespace DRAMSim
 	using namespace std;
 
 	Transaction::Transaction(TransactionType transType, uint64_t addr, DataPacket *dat, size_t len, uint64_t time) :
-		transactionType(transType),	address(addr), data(dat), len(len), timeTraced(time)
+		transactionType(transType),	address(addr), data(dat), len(len), timeTraced(time), isPrefetch(false), coreID(0), isPageWalk(false)
 	{
+		byteOffset = address & (TRANS_DATA_BYTES - 1);
 		alignAddress();
+		mappedAddress = address;
 	}
 
 
@@ -67,7 +69,12 @@ namespace DRAMSim
 		  //added by libing
 		  timeIssued(t.timeIssued),
 		  timeReturned(t.timeReturned),
-		  timeTraced(t.timeTraced)
+		  timeTraced(t.timeTraced),
+		  isPrefetch(t.isPrefetch),
+		  coreID(t.coreID),
+		  byteOffset(t.byteOffset),
+		  isPageWalk(t.isPageWalk),
+		  mappedAddress(t.mappedAddress)
 	{
 #ifdef DATA_STORAGE
 		ERROR("Data storage is really outdated and these copies happen in an \n improper way, which will eventually cause problems. Please send an \n email to dramninjas [at] gmail [dot] com if you need data storage");
@@ -71,6 +71,16 @@ namespace DRAMSim
 		uint64_t timeTraced;
 		//add on 20121030 by libing to record cache access time 
 		uint64_t timeIssued ;
+		//set for reads generated by the LLC prefetcher, scheduled after demand requests
+		bool isPrefetch;
+		//core that made the access, selects its private caches
+		unsigned coreID;
+		//offset of the traced address inside the transaction, alignAddress clears it from address
+		unsigned byteOffset;
+		//set for the page table reads of a TLB miss (see PageMapper)
+		bool isPageWalk;
+		//the address the channels decode, the frame of a tier placed page (see MemorySystem::addTransaction)
+		uint64_t mappedAddress;
 		//functions
 		Transaction(TransactionType transType, uint64_t addr, DataPacket *data, size_t len=LEN_DEF, uint64_t time = 0);
 		Transaction(const Transaction &t);
@@ -88,11 +98,29 @@ namespace DRAMSim
 		private:
 			map<uint64_t, list<uint64_t> > pendingReadRequests;
 			map<uint64_t, list<uint64_t> > pendingWriteRequests;
+			map<uint64_t, uint64_t> readLatencies; // latencyValue -> latencyCount, binned by HISTOGRAM_BIN_SIZE
 			unsigned counter;
 
 		public:
 			TransactionReceiver():counter(0){};
 
+			// end to end load latency in cpu cycles, cache hits are recorded by the caller
+			void insertReadLatency(uint64_t latency)
+			{
+				readLatencies[(latency/HISTOGRAM_BIN_SIZE)*HISTOGRAM_BIN_SIZE]++;
+			}
+
+			void printReadLatencies()
+			{
+				PRINT( " ---  Load latency list ("<<readLatencies.size()<<")");
+				PRINT( "    [lat] : #");
+				map<uint64_t, uint64_t>::iterator it;
+				for (it=readLatencies.begin(); it!=readLatencies.end(); it++)
+				{
+					PRINT( "    ["<< it->first <<"-"<<it->first+(HISTOGRAM_BIN_SIZE-1)<<"] : "<< it->second );
+				}
+			}
+
 			void addPending(const Transaction *t, uint64_t cycle)
 			{
 				// C++ lists are ordered, so the list will always push to the back and
@@ -135,6 +163,7 @@ namespace DRAMSim
 				uint64_t latency = done_cycle - added_cycle;
 
 				pendingReadRequests[address].pop_front();
+				insertReadLatency(latency);
 				//cout << "Read Callback:  0x"<< std::hex << address << std::dec << " latency="<<latency<<"cycles ("<< done_cycle<< "->"<<added_cycle<<")"<<endl;
 				counter--;
 			}
@@ -0,0 +1,217 @@
+#include "WayPartitioner.h"
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <assert.h>
+using namespace std;
+
+BlSim::WayPartitioner::WayPartitioner(uint32_t core_count, uint32_t way_count, uint32_t block_size, uint32_t set_count,
+                                      uint64_t epoch_length)
+{
+	uint32_t c;
+
+	if(core_count < 2 || way_count < core_count || way_count > 32)
+	{
+		cerr<<"ERROR: way partitioning needs 2 or more cores and at least one way per core, up to 32 ways (got "
+			<<core_count<<" cores, "<<way_count<<" ways)"<<endl;
+		exit(-8);
+	}
+	if(set_count == 0 || (set_count & (set_count - 1)) || epoch_length == 0)
+	{
+		cerr<<"ERROR: way partitioning needs a power of two set count and a non-zero epoch"<<endl;
+		exit(-8);
+	}
+
+	m_core_count = core_count;
+	m_way_count = way_count;
+	m_block_bits = 0;
+	while((1U << m_block_bits) < block_size)
+	{
+		m_block_bits++;
+	}
+	m_set_mask = set_count - 1;
+	m_sampled_sets = set_count < SAMPLED_SETS ? set_count : (uint32_t)SAMPLED_SETS;
+	m_sample_stride = set_count / m_sampled_sets;
+	m_epoch_length = epoch_length;
+
+	m_tags.assign((size_t)core_count * m_sampled_sets * way_count, 0);
+	m_depths.assign((size_t)core_count * m_sampled_sets, 0);
+	m_hits.assign((size_t)core_count * way_count, 0);
+	m_epoch_hits.assign((size_t)core_count * way_count, 0);
+	m_epoch_accesses.assign(core_count, 0);
+	m_epoch_count = 0;
+	m_repartitions = 0;
+	m_chosen_misses.assign(core_count, 0);
+	m_even_misses.assign(core_count, 0);
+
+	//start from an even split, the first ways go to the first cores
+	m_allocation.assign(core_count, way_count / core_count);
+	for(c = 0; c < way_count % core_count; c++)
+	{
+		m_allocation[c]++;
+	}
+	m_masks.assign(core_count, 0);
+	build_masks();
+}
+
+uint32_t BlSim::WayPartitioner::even_ways()
+{
+	return m_way_count / m_core_count;
+}
+
+uint64_t BlSim::WayPartitioner::hits_with(const std::vector<uint64_t> &hits, uint32_t core, uint32_t ways)
+{
+	uint64_t sum = 0;
+	uint32_t d;
+
+	for(d = 0; d < ways; d++)
+	{
+		sum += hits[(size_t)core * m_way_count + d];
+	}
+	return sum;
+}
+
+bool BlSim::WayPartitioner::access(uint32_t core, uint64_t maddr)
+{
+	uint64_t block_num = maddr >> m_block_bits;
+	uint32_t set = (uint32_t)(block_num & m_set_mask);
+
+	assert(core < m_core_count);
+	if(set % m_sample_stride == 0)
+	{
+		size_t shadow = (size_t)core * m_sampled_sets + set / m_sample_stride;
+		uint64_t *p_stack = &m_tags[shadow * m_way_count];
+		uint32_t depth = m_depths[shadow];
+		uint32_t d;
+
+		for(d = 0; d < depth; d++)
+		{
+			if(p_stack[d] == block_num)
+			{
+				break;
+			}
+		}
+		if(d < depth)
+		{
+			m_hits[(size_t)core * m_way_count + d]++;
+			m_epoch_hits[(size_t)core * m_way_count + d]++;
+		}
+		else if(depth < m_way_count)
+		{
+			m_depths[shadow]++;
+		}
+		else
+		{
+			d = m_way_count - 1;  //the lru tag falls out
+		}
+		for(; d > 0; d--)
+		{
+			p_stack[d] = p_stack[d - 1];
+		}
+		p_stack[0] = block_num;
+		m_epoch_accesses[core]++;
+	}
+
+	if(++m_epoch_count < m_epoch_length)
+	{
+		return false;
+	}
+	return end_epoch();
+}
+
+bool BlSim::WayPartitioner::end_epoch()
+{
+	uint32_t c;
+
+	for(c = 0; c < m_core_count; c++)
+	{
+		m_chosen_misses[c] += m_epoch_accesses[c] - hits_with(m_epoch_hits, c, m_allocation[c]);
+		m_even_misses[c] += m_epoch_accesses[c] - hits_with(m_epoch_hits, c, even_ways());
+		m_epoch_accesses[c] = 0;
+	}
+	m_epoch_hits.assign(m_epoch_hits.size(), 0);
+	m_epoch_count = 0;
+
+	//lookahead: keep giving the core with the best hits per way the ways that achieve it
+	uint32_t balance = m_way_count - m_core_count;
+	m_allocation.assign(m_core_count, 1);
+	while(balance > 0)
+	{
+		uint32_t best_core = 0;
+		uint32_t best_ways = 1;
+		double best_utility = -1;
+
+		for(c = 0; c < m_core_count; c++)
+		{
+			uint64_t base = hits_with(m_hits, c, m_allocation[c]);
+			uint32_t k;
+			for(k = 1; k <= balance; k++)
+			{
+				double utility = (double)(hits_with(m_hits, c, m_allocation[c] + k) - base) / k;
+				if(utility > best_utility)
+				{
+					best_utility = utility;
+					best_core = c;
+					best_ways = k;
+				}
+			}
+		}
+		m_allocation[best_core] += best_ways;
+		balance -= best_ways;
+	}
+
+	//halve the history so the next epochs can change the picture
+	size_t i;
+	for(i = 0; i < m_hits.size(); i++)
+	{
+		m_hits[i] >>= 1;
+	}
+
+	std::vector<uint32_t> old_masks = m_masks;
+	build_masks();
+	if(m_masks == old_masks)
+	{
+		return false;
+	}
+	m_repartitions++;
+	return true;
+}
+
+void BlSim::WayPartitioner::build_masks()
+{
+	uint32_t way = 0;
+	uint32_t c;
+
+	//contiguous ways in core order, like CAT capacity bitmasks
+	for(c = 0; c < m_core_count; c++)
+	{
+		uint32_t ways = m_allocation[c];
+		uint32_t mask = ways >= 32 ? 0xffffffffU : ((1U << ways) - 1);
+		m_masks[c] = mask << way;
+		way += ways;
+	}
+	assert(way == m_way_count);
+}
+
+void BlSim::WayPartitioner::print_statistic()
+{
+	uint64_t chosen_total = 0;
+	uint64_t even_total = 0;
+	uint32_t c;
+
+	//the estimates count the sampled sets only, scale them up to the whole LLC
+	cout<<"ucp: repartitions: "<<m_repartitions<<"\t sampled sets: "<<m_sampled_sets
+		<<"\t epoch: "<<m_epoch_length<<" LLC accesses"<<endl;
+	for(c = 0; c < m_core_count; c++)
+	{
+		uint64_t chosen = m_chosen_misses[c] * m_sample_stride;
+		uint64_t even = m_even_misses[c] * m_sample_stride;
+		cout<<"    core "<<c<<": ways: "<<m_allocation[c]
+			<<"\t estimated misses: "<<chosen<<" (even split of "<<even_ways()<<" ways: "<<even<<")"<<endl;
+		chosen_total += chosen;
+		even_total += even;
+	}
+	cout<<"    estimated DRAM traffic saved over an even split: "
+		<<((int64_t)even_total - (int64_t)chosen_total) * (1L << m_block_bits)<<" bytes"<<endl;
+}
@@ -0,0 +1,71 @@
+#ifndef WAY_PARTITIONER_H_
+#define WAY_PARTITIONER_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace BlSim
+{
+    /*
+     * Utility-based way partitioning of a shared LLC (UCP).
+     *
+     * Every core has a utility monitor (UMON): shadow tags of a few sampled
+     * LLC sets with the full associativity, kept in LRU order as if the core
+     * had the whole cache to itself. A hit at depth d is a hit for every
+     * allocation of more than d ways, so the per-depth hit counters give the
+     * hits of the core as a function of its way count. At the end of every
+     * epoch the lookahead algorithm hands the ways out by the best marginal
+     * utility (every core keeps at least one), the allocations become
+     * contiguous way masks and the counters are halved so old epochs fade.
+     *
+     * The raw counters of each epoch also estimate the LLC misses of the
+     * allocation in force and of an even split; the difference is the DRAM
+     * traffic the partitioning saves.
+     */
+    class WayPartitioner
+    {
+        protected:
+            enum Umon_Config{SAMPLED_SETS=32};
+
+            uint32_t m_core_count;
+            uint32_t m_way_count;
+            uint32_t m_block_bits;
+            uint32_t m_set_mask;
+            uint32_t m_sample_stride;  //every m_sample_stride-th LLC set is sampled
+            uint32_t m_sampled_sets;
+            uint64_t m_epoch_length;   //LLC accesses per epoch
+
+            std::vector<uint64_t> m_tags;      //per core and sampled set m_way_count block numbers, MRU first
+            std::vector<uint32_t> m_depths;    //valid tags per shadow set
+            std::vector<uint64_t> m_hits;      //per core and depth, halved every epoch
+            std::vector<uint64_t> m_epoch_hits;      //per core and depth, this epoch only
+            std::vector<uint64_t> m_epoch_accesses;  //per core, this epoch only
+            uint64_t m_epoch_count;    //LLC accesses of this epoch
+
+            std::vector<uint32_t> m_allocation;  //ways of each core
+            std::vector<uint32_t> m_masks;
+            uint64_t m_repartitions;  //epochs that changed the masks
+
+            //sampled misses of whole epochs
+            std::vector<uint64_t> m_chosen_misses;  //with the allocation in force
+            std::vector<uint64_t> m_even_misses;    //with an even split of the ways
+
+            uint32_t even_ways();
+            uint64_t hits_with(const std::vector<uint64_t> &hits, uint32_t core, uint32_t ways);
+            bool end_epoch();    //returns true when the masks changed
+            void build_masks();
+
+        public:
+            WayPartitioner(uint32_t core_count, uint32_t way_count, uint32_t block_size, uint32_t set_count,
+                           uint64_t epoch_length);
+
+            //an access of the core reached the LLC, returns true when the way masks changed
+            bool access(uint32_t core, uint64_t maddr);
+            uint32_t get_way_mask(uint32_t core){return m_masks[core];}
+
+            //allocations and the estimated misses of the allocations against an even split
+            void print_statistic();
+    };
+}
+
+#endif